@@ -0,0 +1,149 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "ActorSnapshot.h"
+#include "Model.h"
+#include "MappedFile.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	static_assert(std::is_trivially_copyable_v<Actors::PositionData> && std::is_trivially_copyable_v<Actors::MovementData> &&
+		std::is_trivially_copyable_v<Actors::ActorType> && std::is_trivially_copyable_v<std::bitset<32>>,
+		"Actor arrays are saved as raw blocks");
+
+	// Bump whenever the header changes, element sizes are checked separately
+	constexpr std::uint32_t SnapshotVersion = 1;
+	constexpr char SnapshotMagic[8] = { 'A', 'C', 'T', 'O', 'R', 'S', 'N', 'P' };
+
+	struct SnapshotHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t position_size;
+		std::uint32_t movement_size;
+		std::uint32_t type_size;
+		std::uint32_t attribute_size;
+		std::uint32_t handle_size;
+		std::uint64_t count;
+		std::uint32_t next_handle;
+		std::uint32_t reserved;
+	};
+
+	constexpr std::uint64_t ActorBytes = sizeof(Actors::PositionData) + sizeof(Actors::MovementData) +
+		sizeof(Actors::ActorType) + sizeof(std::bitset<32>) + sizeof(ActorHandle);
+
+	// The mapping is page aligned, so handles can be used in place
+	static_assert(sizeof(SnapshotHeader) % alignof(ActorHandle) == 0 && (ActorBytes - sizeof(ActorHandle)) % alignof(ActorHandle) == 0,
+		"Handles must stay aligned in the snapshot");
+
+}
+
+bool ActorSnapshot::Save(const std::string& filename, const Actors& actors)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("ActorSnapshot::Save(const std::string& filename, const Actors& actors)");
+
+	const size_t count = actors.GetLength();
+	SnapshotHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+	header.version = SnapshotVersion;
+	header.position_size = sizeof(Actors::PositionData);
+	header.movement_size = sizeof(Actors::MovementData);
+	header.type_size = sizeof(Actors::ActorType);
+	header.attribute_size = sizeof(std::bitset<32>);
+	header.handle_size = sizeof(ActorHandle);
+	header.count = count;
+	header.next_handle = actors.GetNextHandle();
+
+	const auto temporary = filename + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(actors.m_pd.data()), count * sizeof(Actors::PositionData));
+		out.write(reinterpret_cast<const char*>(actors.m_md.data()), count * sizeof(Actors::MovementData));
+		out.write(reinterpret_cast<const char*>(actors.m_types.data()), count * sizeof(Actors::ActorType));
+		out.write(reinterpret_cast<const char*>(actors.m_attributes.data()), count * sizeof(std::bitset<32>));
+		out.write(reinterpret_cast<const char*>(actors.GetHandles()), count * sizeof(ActorHandle));
+		if (!out)
+		{
+			logger->error("Cannot write actor snapshot: {0}", temporary);
+			out.close();
+			std::error_code ec;
+			std::filesystem::remove(temporary, ec);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, filename, ec);
+	if (ec)
+	{
+		logger->error("Cannot replace actor snapshot {0}: {1}", filename, ec.message());
+		std::filesystem::remove(temporary, ec);
+		return false;
+	}
+
+	logger->info("{0} actors saved to {1}", count, filename);
+	return true;
+}
+
+bool ActorSnapshot::Load(const std::string& filename, Actors& actors)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("ActorSnapshot::Load(const std::string& filename, Actors& actors)");
+
+	MappedFile image;
+	try
+	{
+		image = MappedFile(filename, MappedFile::Mode::ReadOnly);
+	}
+	catch (const std::runtime_error& e)
+	{
+		logger->error("Cannot map actor snapshot {0}: {1}", filename, e.what());
+		return false;
+	}
+
+	SnapshotHeader header;
+	if (image.GetSize() < sizeof(header))
+	{
+		logger->error("Actor snapshot too short: {0}", filename);
+		return false;
+	}
+	std::memcpy(&header, image.GetData(), sizeof(header));
+	if (std::memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 || header.version != SnapshotVersion ||
+		header.position_size != sizeof(Actors::PositionData) || header.movement_size != sizeof(Actors::MovementData) ||
+		header.type_size != sizeof(Actors::ActorType) || header.attribute_size != sizeof(std::bitset<32>) ||
+		header.handle_size != sizeof(ActorHandle))
+	{
+		logger->error("Actor snapshot from another version: {0}", filename);
+		return false;
+	}
+	if (header.count > (image.GetSize() - sizeof(header)) / ActorBytes ||
+		sizeof(header) + header.count * ActorBytes != image.GetSize())
+	{
+		logger->error("Actor snapshot has the wrong size: {0}", filename);
+		return false;
+	}
+
+	const size_t count = static_cast<size_t>(header.count);
+	const char* block = image.GetData() + sizeof(header);
+	const char* handles = block + count * (ActorBytes - sizeof(ActorHandle));
+
+	actors.Restore(count, reinterpret_cast<const ActorHandle*>(handles), header.next_handle);
+	std::memcpy(actors.m_pd.data(), block, count * sizeof(Actors::PositionData));
+	block += count * sizeof(Actors::PositionData);
+	std::memcpy(actors.m_md.data(), block, count * sizeof(Actors::MovementData));
+	block += count * sizeof(Actors::MovementData);
+	std::memcpy(actors.m_types.data(), block, count * sizeof(Actors::ActorType));
+	block += count * sizeof(Actors::ActorType);
+	std::memcpy(actors.m_attributes.data(), block, count * sizeof(std::bitset<32>));
+
+	logger->info("{0} actors loaded from {1}", count, filename);
+	return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+class Actors;
+
+/// Saved state of the Actors, one contiguous block per array so saving is
+///  a handful of writes and loading a mapping and a handful of copies:
+///
+///		header, PositionData[count], MovementData[count], ActorType[count],
+///		bitset<32>[count], ActorHandle[count]
+///
+///  Everything is in native byte order and the header records the size of
+///  every element, a snapshot only loads into the build that wrote it.
+///
+class ActorSnapshot
+{
+public:
+	// Written to a temporary file and renamed, false if it can't be written
+	static bool Save(const std::string& filename, const Actors& actors);
+
+	// Replaces every actor, false (and actors untouched) if the file is
+	//  missing, damaged or from another build
+	static bool Load(const std::string& filename, Actors& actors);
+};
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+#include "AllocationStats.h"
+
+#ifndef NDEBUG
+
+namespace {
+
+	std::atomic<std::uint64_t> allocations(0);
+	std::atomic<std::uint64_t> bytes(0);
+
+	void* Allocate(std::size_t size, std::size_t alignment)
+	{
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		bytes.fetch_add(size, std::memory_order_relaxed);
+
+		if (size == 0)
+		{
+			size = 1;
+		}
+		for (;;)
+		{
+#ifdef _WIN32
+			void* p = (alignment > alignof(std::max_align_t)) ? _aligned_malloc(size, alignment) : std::malloc(size);
+#else
+			void* p = nullptr;
+			if (alignment <= alignof(std::max_align_t))
+			{
+				p = std::malloc(size);
+			}
+			else if (posix_memalign(&p, alignment, size) != 0)
+			{
+				p = nullptr;
+			}
+#endif
+			if (p != nullptr)
+			{
+				return p;
+			}
+
+			// Same as the standard operator new: let the handler free something, or give up
+			std::new_handler handler = std::get_new_handler();
+			if (handler == nullptr)
+			{
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+	}
+
+	void Free(void* p, [[maybe_unused]] std::size_t alignment) noexcept
+	{
+#ifdef _WIN32
+		if (alignment > alignof(std::max_align_t))
+		{
+			_aligned_free(p);
+			return;
+		}
+#endif
+		std::free(p);
+	}
+
+}
+
+// The array and nothrow forms default to these.  The sized deletes are
+//	what the compiler calls when it knows the size, so they are here too.
+
+void* operator new(std::size_t size)
+{
+	return Allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+	Free(p, alignof(std::max_align_t));
+}
+
+void operator delete(void* p, std::align_val_t alignment) noexcept
+{
+	Free(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	Free(p, alignof(std::max_align_t));
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+	Free(p, static_cast<std::size_t>(alignment));
+}
+
+AllocationStats::Counts AllocationStats::Get()
+{
+	return Counts{ allocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed) };
+}
+
+bool AllocationStats::IsCounting()
+{
+	return true;
+}
+
+#else
+
+AllocationStats::Counts AllocationStats::Get()
+{
+	return Counts{ 0, 0 };
+}
+
+bool AllocationStats::IsCounting()
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+/// Counts every allocation that goes through operator new, to see what a
+///  frame costs.  Only debug builds (no NDEBUG) count, release builds
+///  keep the standard operator new and always get zeros.  Counts only go
+///  up, take the difference over what is to be measured.
+///
+class AllocationStats
+{
+public:
+	struct Counts
+	{
+		std::uint64_t allocations;
+		std::uint64_t bytes;
+	};
+
+	static Counts Get();
+	static bool IsCounting();
+};
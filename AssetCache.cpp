@@ -0,0 +1,325 @@
+#include <limits>
+#include <numeric>
+
+#include "AssetCache.h"
+#include "AssetPack.h"
+#include "ImageLibrary.h"
+#include "ThreadPool.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+AssetCache::Handle::Handle(const Handle& other) : m_cache(other.m_cache), m_entry(other.m_entry)
+{
+	if (m_entry != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(m_cache->m_mutex);
+		m_cache->Pin(m_entry);
+	}
+}
+
+AssetCache::Handle::Handle(Handle&& other) noexcept : m_cache(other.m_cache), m_entry(other.m_entry)
+{
+	other.m_cache = nullptr;
+	other.m_entry = nullptr;
+}
+
+AssetCache::Handle& AssetCache::Handle::operator=(Handle other) noexcept
+{
+	std::swap(m_cache, other.m_cache);
+	std::swap(m_entry, other.m_entry);
+	return *this;
+}
+
+AssetCache::Handle::~Handle()
+{
+	if (m_entry != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(m_cache->m_mutex);
+		m_cache->Release(m_entry);
+	}
+}
+
+SDL_Surface* AssetCache::Handle::Get() const
+	// Held entries are never evicted, so no lock
+{
+	return (m_entry != nullptr) ? m_entry->surface : nullptr;
+}
+
+const std::string& AssetCache::Handle::GetName() const
+{
+	static const std::string none;
+	return (m_entry != nullptr) ? m_entry->name : none;
+}
+
+AssetCache::AssetCache(Uint32 display_format) : m_display_format(display_format), m_memory(MemorySubsystem::Images)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("AssetCache::AssetCache(Uint32 display_format)");
+
+	m_budget.fill(std::numeric_limits<size_t>::max());
+	m_resident.fill(0);
+}
+
+AssetCache::~AssetCache()
+	// Surfaces from packs point into m_packs, which goes after this
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("AssetCache destroyed with {0} assets, {1} bytes resident", m_entries.size(), this->GetResidentBytes());
+
+	for (auto& asset : m_entries)
+	{
+		if (asset.second.refs != 0)
+		{
+			logger->error("Asset still held when the cache went: {0}", asset.first);
+		}
+		SDL_FreeSurface(asset.second.surface);
+	}
+}
+
+bool AssetCache::Mount(const std::string& pack_filename)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("AssetCache::Mount(const std::string& pack_filename)");
+
+	std::unique_ptr<AssetPack> pack;
+	try
+	{
+		pack = std::make_unique<AssetPack>(pack_filename);
+	}
+	catch (const std::runtime_error& e)
+	{
+		logger->info("Asset pack not mounted: {0}", e.what());
+		return false;
+	}
+
+	if (pack->GetDisplayFormat() != m_display_format)
+	{
+		logger->warn("Asset pack {0} was built for another display format, not mounted", pack_filename);
+		return false;
+	}
+
+	m_packs.push_back(std::move(pack));
+	return true;
+}
+
+void AssetCache::SetBudget(AssetCategory category, size_t bytes)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Asset budget for category {0}: {1} bytes", static_cast<int>(category), bytes);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_budget[static_cast<size_t>(category)] = bytes;
+	this->Trim(category);
+}
+
+size_t AssetCache::GetBudget(AssetCategory category) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_budget[static_cast<size_t>(category)];
+}
+
+AssetCache::Handle AssetCache::Acquire(const std::string& filename, AssetCategory category)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto asset = m_entries.find(filename);
+		if (asset != m_entries.end())
+		{
+			this->Pin(&asset->second);
+			return Handle(this, &asset->second);
+		}
+	}
+
+	// Loaded without the lock, if another thread loads it meanwhile the
+	//	first one in wins and this copy goes
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Asset not resident, loading: {0}", filename);
+	SDL_Surface* surface = this->Load(filename);
+	if (surface == nullptr)
+	{
+		return Handle();
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Entry* entry = this->Insert(filename, category, surface);
+	return Handle(this, entry);
+}
+
+std::vector<AssetCache::Handle> AssetCache::AcquireAll(const std::vector<std::string>& filenames, AssetCategory category, ThreadPool& pool)
+{
+	std::vector<Handle> handles(filenames.size());
+	std::vector<SDL_Surface*> decoded(filenames.size(), nullptr);
+	std::vector<size_t> missing;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t k = 0; k < filenames.size(); ++k)
+		{
+			auto asset = m_entries.find(filenames[k]);
+			if (asset != m_entries.end())
+			{
+				this->Pin(&asset->second);
+				handles[k] = Handle(this, &asset->second);
+			}
+			else
+			{
+				missing.push_back(k);
+			}
+		}
+	}
+
+	pool.ParallelFor(missing.size(), [&](size_t m)
+	{
+		decoded[missing[m]] = this->Load(filenames[missing[m]]);
+	});
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t k : missing)
+	{
+		if (decoded[k] != nullptr)
+		{
+			handles[k] = Handle(this, this->Insert(filenames[k], category, decoded[k]));
+		}
+	}
+	return handles;
+}
+
+bool AssetCache::Replace(const std::string& filename, SDL_Surface* surface)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto asset = m_entries.find(filename);
+	if (asset == m_entries.end())
+	{
+		SDL_FreeSurface(surface);
+		return false;
+	}
+
+	Entry& entry = asset->second;
+	const size_t bytes = SurfaceBytes(surface);
+	auto& resident = m_resident[static_cast<size_t>(entry.category)];
+	resident = resident - entry.bytes + bytes;
+	this->Account();
+
+	SDL_FreeSurface(entry.surface);
+	entry.surface = surface;
+	entry.bytes = bytes;
+	this->Trim(entry.category);
+	return true;
+}
+
+void AssetCache::Purge()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& unused : m_unused)
+	{
+		while (!unused.empty())
+		{
+			this->Evict(unused.back());
+		}
+	}
+}
+
+size_t AssetCache::GetResidentBytes() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return std::accumulate(m_resident.begin(), m_resident.end(), size_t(0));
+}
+
+size_t AssetCache::GetResidentBytes(AssetCategory category) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_resident[static_cast<size_t>(category)];
+}
+
+size_t AssetCache::GetResidentCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+size_t AssetCache::SurfaceBytes(const SDL_Surface* surface)
+{
+	return sizeof(SDL_Surface) + static_cast<size_t>(surface->pitch) * surface->h;
+}
+
+SDL_Surface* AssetCache::Load(const std::string& filename) const
+{
+	for (auto pack = m_packs.rbegin(); pack != m_packs.rend(); ++pack)
+	{
+		SDL_Surface* surface = (*pack)->CreateSurface(filename);
+		if (surface != nullptr)
+		{
+			return surface;
+		}
+	}
+	return ImageLibrary::Decode(filename, m_display_format);
+}
+
+AssetCache::Entry* AssetCache::Insert(const std::string& filename, AssetCategory category, SDL_Surface* surface)
+	// Returns the entry with one reference taken for the caller
+{
+	auto inserted = m_entries.emplace(filename, Entry{ filename, category, surface, SurfaceBytes(surface), 0, {} });
+	Entry* entry = &inserted.first->second;
+	if (!inserted.second)
+	{
+		// Lost the race, share the one already there
+		SDL_FreeSurface(surface);
+		this->Pin(entry);
+		return entry;
+	}
+
+	m_resident[static_cast<size_t>(entry->category)] += entry->bytes;
+	this->Account();
+	entry->refs = 1;
+	this->Trim(entry->category);
+	return entry;
+}
+
+void AssetCache::Pin(Entry* entry)
+{
+	if (entry->refs++ == 0)
+	{
+		m_unused[static_cast<size_t>(entry->category)].erase(entry->unused);
+	}
+}
+
+void AssetCache::Release(Entry* entry)
+{
+	if (--entry->refs != 0)
+	{
+		return;
+	}
+	auto& unused = m_unused[static_cast<size_t>(entry->category)];
+	unused.push_front(entry);
+	entry->unused = unused.begin();
+	this->Trim(entry->category);
+}
+
+void AssetCache::Trim(AssetCategory category)
+	// Least recently used first, held assets can't go so a category can
+	//	stay over budget
+{
+	const size_t c = static_cast<size_t>(category);
+	auto& unused = m_unused[c];
+	while (m_resident[c] > m_budget[c] && !unused.empty())
+	{
+		this->Evict(unused.back());
+	}
+}
+
+void AssetCache::Evict(Entry* entry)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Asset evicted: {0} ({1} bytes)", entry->name, entry->bytes);
+
+	const size_t c = static_cast<size_t>(entry->category);
+	m_unused[c].erase(entry->unused);
+	m_resident[c] -= entry->bytes;
+	this->Account();
+	SDL_FreeSurface(entry->surface);
+	m_entries.erase(m_entries.find(entry->name));
+}
+
+void AssetCache::Account()
+{
+	m_memory.Set(std::accumulate(m_resident.begin(), m_resident.end(), static_cast<size_t>(0)));
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+
+#include "SDL.h"
+#include "MemoryTelemetry.h"
+
+class ThreadPool;
+class AssetPack;
+
+enum class AssetCategory { Tiles, Sprites, Interface, Other };
+constexpr size_t AssetCategoryCount = 4;
+
+/// Owns every surface loaded from disk.  Users hold ref-counted Handles,
+///  an asset nobody holds stays resident (on a per-category LRU list) until
+///  its category goes over budget, and is loaded again the next time it is
+///  acquired.  Budgets count the pixel memory of the surfaces.
+///
+///  Images found in a mounted AssetPack are mapped from it instead of being
+///  decoded.  Packs are only looked at when an asset isn't resident.
+///
+///  Acquire is safe from any thread.  Handles must not outlive the cache.
+///  Replace swaps pixels under existing Handles, call it from the thread
+///  that draws.  Mount packs before anything is acquired.
+///
+class AssetCache
+{
+	struct Entry;
+
+public:
+	class Handle
+	{
+	public:
+		Handle() : m_cache(nullptr), m_entry(nullptr) {}
+		Handle(const Handle& other);
+		Handle(Handle&& other) noexcept;
+		Handle& operator=(Handle other) noexcept;
+		~Handle();
+
+		SDL_Surface* Get() const;
+		const std::string& GetName() const;
+		explicit operator bool() const { return m_entry != nullptr; }
+
+	private:
+		friend class AssetCache;
+
+		// Takes over a reference already counted by the cache
+		Handle(AssetCache* cache, Entry* entry) : m_cache(cache), m_entry(entry) {}
+
+		AssetCache* m_cache;
+		Entry* m_entry;
+	};
+
+	explicit AssetCache(Uint32 display_format);
+	~AssetCache();
+
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+
+	// Maps a pack built by tools/PackAssets, false if it can't be used, e.g.
+	//  it was built for another display format.  Later packs take precedence.
+	bool Mount(const std::string& pack_filename);
+
+	// Bytes a category may keep resident, held assets included, unlimited by
+	//  default.  Only unreferenced assets are evicted to get under it, so a
+	//  category whose held assets alone exceed it keeps none of the rest.
+	void SetBudget(AssetCategory category, size_t bytes);
+	size_t GetBudget(AssetCategory category) const;
+
+	// Resident assets are shared, the rest are decoded now.  An empty
+	//  handle if the file can't be loaded.  A file keeps the category it
+	//  was first acquired with.
+	Handle Acquire(const std::string& filename, AssetCategory category);
+
+	// Same, with everything that isn't resident decoded in parallel
+	std::vector<Handle> AcquireAll(const std::vector<std::string>& filenames, AssetCategory category, ThreadPool& pool);
+
+	// New pixels for a resident asset, e.g. after the file changed.  The
+	//  cache owns surface afterwards either way, false if not resident.
+	bool Replace(const std::string& filename, SDL_Surface* surface);
+
+	// Evicts every asset nobody holds
+	void Purge();
+
+	size_t GetResidentBytes() const;
+	size_t GetResidentBytes(AssetCategory category) const;
+	size_t GetResidentCount() const;
+
+	// Pixels and header of a surface, what budgets and telemetry count
+	static size_t SurfaceBytes(const SDL_Surface* surface);
+
+private:
+	struct Entry
+	{
+		std::string name;
+		AssetCategory category;
+		SDL_Surface* surface;
+		size_t bytes;
+		unsigned int refs;
+		std::list<Entry*>::iterator unused;	// valid while refs is zero
+	};
+
+	// From a pack if one has it, decoded otherwise.  Doesn't need the lock.
+	SDL_Surface* Load(const std::string& filename) const;
+
+	// All of these expect m_mutex to be held
+	Entry* Insert(const std::string& filename, AssetCategory category, SDL_Surface* surface);
+	void Pin(Entry* entry);
+	void Release(Entry* entry);
+	void Trim(AssetCategory category);
+	void Evict(Entry* entry);
+	void Account();
+
+	Uint32 m_display_format;
+
+	// Before the entries so surfaces go before the pages under them
+	std::vector<std::unique_ptr<AssetPack>> m_packs;
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::string, Entry> m_entries;
+
+	// Unreferenced assets, most recently used at the front
+	std::array<std::list<Entry*>, AssetCategoryCount> m_unused;
+	std::array<size_t, AssetCategoryCount> m_budget;
+	std::array<size_t, AssetCategoryCount> m_resident;
+	MemoryAccount m_memory;
+};
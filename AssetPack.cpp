@@ -0,0 +1,282 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "AssetPack.h"
+#include "ImageLibrary.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	// Bump whenever the header or AssetPack::Entry changes
+	constexpr std::uint32_t PackVersion = 1;
+	constexpr char PackMagic[8] = { 'A', 'S', 'S', 'E', 'T', 'P', 'K', '\0' };
+
+	struct PackHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t entry_size;
+		std::uint32_t display_format;
+		std::uint32_t image_count;
+		std::uint64_t names_offset;
+		std::uint64_t names_size;
+	};
+
+	std::uint64_t Align(std::uint64_t offset, std::uint64_t alignment)
+	{
+		return (offset + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Size and time of a source image, both zero if it isn't there
+	std::pair<std::uint64_t, std::int64_t> GetSourceStamp(const std::string& filename)
+	{
+		std::error_code ec;
+		const auto size = std::filesystem::file_size(filename, ec);
+		if (ec)
+		{
+			return { 0, 0 };
+		}
+		const auto mtime = std::filesystem::last_write_time(filename, ec);
+		if (ec)
+		{
+			return { 0, 0 };
+		}
+		return { static_cast<std::uint64_t>(size), static_cast<std::int64_t>(mtime.time_since_epoch().count()) };
+	}
+
+}
+
+bool AssetPack::Write(const std::string& pack_filename, const std::vector<std::string>& image_files, Uint32 display_format)
+	// Written to a temporary file and renamed over the old pack, so a
+	//	crash half way never leaves a truncated pack behind
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("AssetPack::Write(const std::string& pack_filename, const std::vector<std::string>& image_files, Uint32 display_format)");
+
+	std::vector<SDL_Surface*> surfaces;
+	auto free_surfaces = [&surfaces]()
+	{
+		for (auto surface : surfaces)
+		{
+			SDL_FreeSurface(surface);
+		}
+	};
+
+	PackHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, PackMagic, sizeof(PackMagic));
+	header.version = PackVersion;
+	header.entry_size = sizeof(Entry);
+	header.display_format = display_format;
+	header.image_count = static_cast<std::uint32_t>(image_files.size());
+	header.names_offset = sizeof(PackHeader) + image_files.size() * sizeof(Entry);
+
+	std::vector<Entry> entries(image_files.size());
+	std::string names;
+	for (size_t k = 0; k < image_files.size(); ++k)
+	{
+		SDL_Surface* surface = ImageLibrary::Decode(image_files[k], display_format);
+		if (surface == nullptr)
+		{
+			free_surfaces();
+			return false;
+		}
+		surfaces.push_back(surface);
+
+		// Wrapping a palette would need the palette stored as well
+		if (surface->format->palette != nullptr)
+		{
+			logger->error("Cannot pack {0}, paletted formats aren't supported", image_files[k]);
+			free_surfaces();
+			return false;
+		}
+
+		Entry& entry = entries[k];
+		std::memset(&entry, 0, sizeof(entry));
+		entry.name_offset = static_cast<std::uint32_t>(names.size());
+		entry.name_length = static_cast<std::uint32_t>(image_files[k].size());
+		entry.format = surface->format->format;
+		entry.width = static_cast<std::uint32_t>(surface->w);
+		entry.height = static_cast<std::uint32_t>(surface->h);
+		entry.pitch = static_cast<std::uint32_t>(surface->pitch);
+		if (SDL_GetColorKey(surface, &entry.color_key) == 0)
+		{
+			entry.flags |= HasColorKey;
+		}
+		const auto stamp = GetSourceStamp(image_files[k]);
+		entry.source_size = stamp.first;
+		entry.source_mtime = stamp.second;
+		entry.pixel_size = static_cast<std::uint64_t>(surface->pitch) * surface->h;
+		names += image_files[k];
+	}
+	header.names_size = names.size();
+
+	std::uint64_t offset = header.names_offset + header.names_size;
+	for (auto& entry : entries)
+	{
+		entry.pixel_offset = Align(offset, PackAlignment);
+		offset = entry.pixel_offset + entry.pixel_size;
+	}
+
+	const char zeros[PackAlignment] = { 0 };
+	const auto temporary = pack_filename + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+		out.write(names.data(), names.size());
+
+		std::uint64_t written = header.names_offset + header.names_size;
+		for (size_t k = 0; k < entries.size() && out; ++k)
+		{
+			out.write(zeros, entries[k].pixel_offset - written);
+
+			// RLE surfaces only have plain pixels while locked
+			SDL_LockSurface(surfaces[k]);
+			out.write(static_cast<const char*>(surfaces[k]->pixels), entries[k].pixel_size);
+			SDL_UnlockSurface(surfaces[k]);
+			written = entries[k].pixel_offset + entries[k].pixel_size;
+		}
+		if (!out)
+		{
+			logger->error("Cannot write asset pack: {0}", temporary);
+			out.close();
+			std::error_code ec;
+			std::filesystem::remove(temporary, ec);
+			free_surfaces();
+			return false;
+		}
+	}
+	free_surfaces();
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, pack_filename, ec);
+	if (ec)
+	{
+		logger->error("Cannot replace asset pack {0}: {1}", pack_filename, ec.message());
+		std::filesystem::remove(temporary, ec);
+		return false;
+	}
+
+	logger->info("Asset pack written: {0} ({1} images, {2} bytes)", pack_filename, entries.size(), offset);
+	return true;
+}
+
+AssetPack::AssetPack(const std::string& filename) :
+	m_filename(filename),
+	m_file(filename, MappedFile::Mode::ReadOnly),
+	m_display_format(0)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("AssetPack::AssetPack(const std::string& filename)");
+
+	const std::uint64_t size = m_file.GetSize();
+	if (size < sizeof(PackHeader))
+	{
+		throw std::runtime_error("Asset pack too short: " + filename);
+	}
+
+	PackHeader header;
+	std::memcpy(&header, m_file.GetData(), sizeof(header));
+	if (std::memcmp(header.magic, PackMagic, sizeof(PackMagic)) != 0 || header.version != PackVersion ||
+		header.entry_size != sizeof(Entry))
+	{
+		throw std::runtime_error("Not an asset pack of this version: " + filename);
+	}
+
+	// Counts are checked one at a time so the sizes can't overflow
+	if (header.image_count > size / sizeof(Entry) || header.names_offset != sizeof(PackHeader) + header.image_count * sizeof(Entry) ||
+		header.names_offset > size || header.names_size > size - header.names_offset)
+	{
+		throw std::runtime_error("Asset pack header is damaged: " + filename);
+	}
+	m_display_format = header.display_format;
+
+	const char* names = m_file.GetData() + header.names_offset;
+	const auto* entries = reinterpret_cast<const Entry*>(m_file.GetData() + sizeof(PackHeader));
+	for (std::uint32_t k = 0; k < header.image_count; ++k)
+	{
+		const Entry& entry = entries[k];
+		const int bytes_per_pixel = SDL_BYTESPERPIXEL(entry.format);
+		if (entry.name_offset > header.names_size || entry.name_length > header.names_size - entry.name_offset ||
+			entry.pixel_offset % PackAlignment != 0 || entry.pixel_offset > size || entry.pixel_size > size - entry.pixel_offset ||
+			bytes_per_pixel == 0 || entry.width > entry.pitch / bytes_per_pixel || entry.pitch % 4 != 0 ||
+			static_cast<std::uint64_t>(entry.pitch) * entry.height != entry.pixel_size)
+		{
+			throw std::runtime_error("Asset pack index is damaged: " + filename);
+		}
+		m_index[std::string_view(names + entry.name_offset, entry.name_length)] = &entry;
+	}
+
+	logger->info("Asset pack mapped: {0} ({1} images)", filename, m_index.size());
+}
+
+bool AssetPack::Contains(const std::string& name) const
+{
+	const Entry* entry = this->Find(name);
+	return entry != nullptr && !this->IsStale(name, *entry);
+}
+
+SDL_Surface* AssetPack::CreateSurface(const std::string& name) const
+{
+	auto logger = spdlog::get("EngineLogger");
+
+	const Entry* entry = this->Find(name);
+	if (entry == nullptr)
+	{
+		return nullptr;
+	}
+	if (this->IsStale(name, *entry))
+	{
+		logger->info("Packed copy of {0} is stale, not used", name);
+		return nullptr;
+	}
+
+	int depth;
+	Uint32 rmask, gmask, bmask, amask;
+	if (!SDL_PixelFormatEnumToMasks(entry->format, &depth, &rmask, &gmask, &bmask, &amask))
+	{
+		logger->error("Packed image {0} has an unknown format: {1}", name, SDL_GetError());
+		return nullptr;
+	}
+
+	// SDL never writes to a surface that is only blitted from, so the read
+	//	only pages are safe to hand over
+	void* pixels = const_cast<char*>(m_file.GetData() + entry->pixel_offset);
+	SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(pixels, static_cast<int>(entry->width), static_cast<int>(entry->height),
+		depth, static_cast<int>(entry->pitch), rmask, gmask, bmask, amask);
+	if (surface == nullptr)
+	{
+		logger->error("Cannot wrap packed image {0}: {1}", name, SDL_GetError());
+		return nullptr;
+	}
+
+	// Without RLE, encoding it would mean a private copy of the pixels
+	if ((entry->flags & HasColorKey) != 0)
+	{
+		SDL_SetColorKey(surface, SDL_TRUE, entry->color_key);
+	}
+
+	logger->trace("Image mapped from pack: {0}", name);
+	return surface;
+}
+
+const AssetPack::Entry* AssetPack::Find(const std::string& name) const
+{
+	auto entry = m_index.find(name);
+	return (entry == m_index.end()) ? nullptr : entry->second;
+}
+
+bool AssetPack::IsStale(const std::string& name, const Entry& entry) const
+	// A pack shipped without its sources is always current
+{
+	const auto stamp = GetSourceStamp(name);
+	if (stamp.first == 0)
+	{
+		return false;
+	}
+	return stamp.first != entry.source_size || stamp.second != entry.source_mtime;
+}
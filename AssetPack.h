@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "SDL.h"
+#include "MappedFile.h"
+
+/// Images decoded and converted ahead of time by tools/PackAssets, so
+///  loading one costs nothing: the pack is mapped read only and surfaces
+///  are wrapped around the mapped pixels with SDL_CreateRGBSurfaceFrom.
+///  Pages are only read from disk the first time an image is drawn.
+///
+///  A pack is built for one display format and holds exactly what
+///  ImageLibrary::Decode would produce for it.  Images whose source file
+///  changed since the pack was built are reported as missing, so callers
+///  decode them the slow way instead.
+///
+///  Layout: header, index, names, then the pixels of every image starting
+///  on a PackAlignment boundary.  Everything is in native byte order.
+///
+class AssetPack
+{
+public:
+	static constexpr std::uint64_t PackAlignment = 64;
+
+	// Decodes every file and writes the pack, false if any file can't be
+	//  loaded or the pack can't be written.  Names are stored as given.
+	static bool Write(const std::string& pack_filename, const std::vector<std::string>& image_files, Uint32 display_format);
+
+	// Throws std::runtime_error if the file is not a usable pack
+	explicit AssetPack(const std::string& filename);
+
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	const std::string& GetFilename() const { return m_filename; }
+	Uint32 GetDisplayFormat() const { return m_display_format; }
+	size_t GetCount() const { return m_index.size(); }
+
+	// True if the pack has a current copy of the image
+	bool Contains(const std::string& name) const;
+
+	// Surface over the mapped pixels, nullptr if the image isn't in the pack
+	//  or is stale.  The caller frees it, the pack has to outlive it.  Don't
+	//  write to it or turn on RLE, both would touch read only pages.
+	SDL_Surface* CreateSurface(const std::string& name) const;
+
+private:
+	struct Entry
+	{
+		std::uint32_t name_offset;
+		std::uint32_t name_length;
+		std::uint32_t format;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t pitch;
+		std::uint32_t color_key;
+		std::uint32_t flags;
+		std::int64_t source_mtime;
+		std::uint64_t source_size;
+		std::uint64_t pixel_offset;
+		std::uint64_t pixel_size;
+	};
+
+	static constexpr std::uint32_t HasColorKey = 1;
+
+	const Entry* Find(const std::string& name) const;
+	bool IsStale(const std::string& name, const Entry& entry) const;
+
+	std::string m_filename;
+	MappedFile m_file;
+	Uint32 m_display_format;
+
+	// Keys point into the mapping
+	std::unordered_map<std::string_view, const Entry*> m_index;
+};
@@ -0,0 +1,134 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "BehaviorScheduler.h"
+#include "Controller.h"
+#include "SimulationLod.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+BehaviorScheduler::BehaviorScheduler() : m_tick(0), m_forcing(false)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("BehaviorScheduler::BehaviorScheduler()");
+}
+
+void BehaviorScheduler::SetBehavior(Actors::ActorType type, std::shared_ptr<Behavior> behavior)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Behavior for actor type {0} {1}", static_cast<int>(type), behavior ? "set" : "removed");
+
+	m_types[type].behavior = std::move(behavior);
+}
+
+void BehaviorScheduler::SetBudget(Actors::ActorType type, const Budget& budget)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Behavior budget for actor type {0}: {1} us per tick, every actor within {2} ticks",
+		static_cast<int>(type), budget.per_tick.count(), budget.max_interval);
+
+	if (budget.max_interval == 0)
+	{
+		throw std::invalid_argument("Behavior interval must be at least one tick");
+	}
+	m_types[type].budget = budget;
+}
+
+BehaviorScheduler::Budget BehaviorScheduler::GetBudget(Actors::ActorType type) const
+{
+	auto state = m_types.find(type);
+	return (state == m_types.end()) ? DefaultBudget : state->second.budget;
+}
+
+void BehaviorScheduler::ForceDecisions(const Decisions& decisions)
+{
+	m_forced = decisions;
+	m_forcing = true;
+}
+
+void BehaviorScheduler::Run(const Actors& actors, ActionList& actions, const SimulationLod* lod)
+{
+	using Clock = std::chrono::steady_clock;
+
+	for (auto& state : m_types)
+	{
+		state.second.members.clear();
+	}
+	for (size_t index = 0; index < actors.m_types.size(); ++index)
+	{
+		auto state = m_types.find(actors.m_types[index]);
+		if (state != m_types.end() && state->second.behavior && (lod == nullptr || lod->GetTier(index) != LodTier::Coarse))
+		{
+			state->second.members.emplace_back(actors.GetHandle(index), index);
+		}
+	}
+
+	m_decisions.assign(m_types.empty() ? 0 : static_cast<size_t>(m_types.rbegin()->first) + 1, 0);
+	for (auto& entry : m_types)
+	{
+		TypeState& state = entry.second;
+		auto& members = state.members;
+		state.stats.actors = members.size();
+		state.stats.decided = 0;
+		state.stats.used = std::chrono::microseconds(0);
+		if (members.empty())
+		{
+			continue;
+		}
+
+		for (const auto& member : members)
+		{
+			const unsigned int ticks = (lod == nullptr) ? 1 : lod->GetTicks(member.second);
+			if (ticks > 0)
+			{
+				state.behavior->Update(actors, member.second, ticks, actions);
+			}
+		}
+
+		// Handles are in index order until removals swap actors about
+		if (!std::is_sorted(members.begin(), members.end()))
+		{
+			std::sort(members.begin(), members.end());
+		}
+
+		// The guaranteed bucket is decided regardless of the clock, and a
+		//	replay decides what the recording did
+		const size_t count = members.size();
+		const size_t bucket = (count + state.budget.max_interval - 1) / state.budget.max_interval;
+		const size_t type = static_cast<size_t>(entry.first);
+		const size_t forced = !m_forcing ? 0 : (type < m_forced.size()) ? std::min<size_t>(m_forced[type], count) : 0;
+		const auto start = Clock::now();
+		const auto deadline = start + state.budget.per_tick;
+		size_t position = std::lower_bound(members.begin(), members.end(), std::make_pair(state.next, size_t(0))) - members.begin();
+		size_t decided = 0;
+		while (m_forcing ? (decided < forced) : (decided < count && (decided < bucket || Clock::now() < deadline)))
+		{
+			if (position == count)
+			{
+				position = 0;
+			}
+			state.behavior->Decide(actors, members[position].second, actions);
+			position++;
+			decided++;
+		}
+		state.next = (position < count) ? members[position].first : members[0].first;
+
+		const auto end = Clock::now();
+		state.stats.decided = decided;
+		state.stats.used = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+		if (!m_forcing && decided == bucket && end > deadline)
+		{
+			state.stats.overruns++;
+		}
+		m_decisions[type] = static_cast<std::uint32_t>(decided);
+	}
+
+	m_forcing = false;
+	m_tick++;
+}
+
+BehaviorScheduler::Stats BehaviorScheduler::GetStats(Actors::ActorType type) const
+{
+	auto state = m_types.find(type);
+	return (state == m_types.end()) ? Stats{ 0, 0, std::chrono::microseconds(0), 0 } : state->second.stats;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include "Model.h"
+
+class ActionList;
+class SimulationLod;
+
+/// What one ActorType does.  Update is for cheap reactions and runs for
+///  every actor every tick, or every few ticks for actors a SimulationLod
+///  simulates at a reduced rate, with ticks saying how many it covers.
+///  Decide is for the expensive part (picking a target, requesting a
+///  path) and only runs when the scheduler gets round to the actor.  Both
+///  only read the actors, changes go out as Actions.
+///
+class Behavior
+{
+public:
+	virtual ~Behavior() = default;
+
+	virtual void Update(const Actors&, size_t, unsigned int, ActionList&) {}
+	virtual void Decide(const Actors& actors, size_t index, ActionList& actions) = 0;
+};
+
+/// Spreads Behavior::Decide calls over ticks so AI cost stays flat.
+///  Each ActorType has a time budget per tick and a longest interval:
+///  its actors are split into max_interval round-robin buckets and at
+///  least one bucket is decided every tick, whatever the budget says, so
+///  no actor waits more than max_interval ticks.  Time left in the budget
+///  after that goes to the next actors in line.
+///
+///  How many actors the clock allowed depends on the machine, so a tick's
+///  counts (GetDecisions) go into recordings, and a replay hands them back
+///  with ForceDecisions to decide the same actors without the clock.
+///
+///  Actors are taken in order of their handles, starting after the last
+///  one decided, so actors coming and going don't make the others skip
+///  or repeat a turn.  With a SimulationLod, Coarse actors are left out
+///  altogether and the others are only updated when due.
+///
+class BehaviorScheduler
+{
+public:
+	struct Budget
+	{
+		std::chrono::microseconds per_tick;
+		unsigned int max_interval;
+	};
+
+	// Decide calls per ActorType, indexed by the type
+	using Decisions = std::vector<std::uint32_t>;
+
+	struct Stats
+	{
+		size_t actors;			// with this type, last tick
+		size_t decided;			// last tick
+		std::chrono::microseconds used;	// last tick, Decide only
+		std::uint64_t overruns;	// ticks where the guaranteed bucket alone went over budget
+	};
+
+	BehaviorScheduler();
+
+	// nullptr removes the behavior, actors of that type are left alone
+	void SetBehavior(Actors::ActorType type, std::shared_ptr<Behavior> behavior);
+
+	// Throws std::invalid_argument for a zero max_interval
+	void SetBudget(Actors::ActorType type, const Budget& budget);
+	Budget GetBudget(Actors::ActorType type) const;
+
+	// One tick, actions are appended.  lod is optional, as of this tick.
+	void Run(const Actors& actors, ActionList& actions, const SimulationLod* lod = nullptr);
+
+	// What the last Run decided.  The next Run decides exactly what is
+	//  forced instead of watching the clock, types left out decide none.
+	const Decisions& GetDecisions() const { return m_decisions; }
+	void ForceDecisions(const Decisions& decisions);
+
+	Stats GetStats(Actors::ActorType type) const;
+	std::uint64_t GetTick() const { return m_tick; }
+
+	static constexpr Budget DefaultBudget = { std::chrono::microseconds(250), 8 };
+
+private:
+	struct TypeState
+	{
+		std::shared_ptr<Behavior> behavior;
+		Budget budget = DefaultBudget;
+		ActorHandle next = 0;		// Decided next, or the first handle after it
+		Stats stats = { 0, 0, std::chrono::microseconds(0), 0 };
+		std::vector<std::pair<ActorHandle, size_t>> members;	// Handle and index, by handle
+	};
+
+	std::map<Actors::ActorType, TypeState> m_types;
+	std::uint64_t m_tick;
+
+	Decisions m_decisions;
+	Decisions m_forced;
+	bool m_forcing;
+};
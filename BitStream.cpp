@@ -0,0 +1,111 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "BitStream.h"
+
+namespace {
+
+	constexpr unsigned int GroupBits = 5;
+
+}
+
+BitWriter::BitWriter(std::vector<std::uint8_t>& buffer) : m_buffer(buffer), m_start(buffer.size()), m_bits(0)
+{}
+
+void BitWriter::Write(std::uint32_t value, unsigned int bits)
+	// Lowest bits first, filling each byte from its lowest bit up
+{
+	while (bits > 0)
+	{
+		const size_t used = m_bits % 8;
+		if (used == 0)
+		{
+			m_buffer.push_back(0);
+		}
+		const unsigned int take = std::min<unsigned int>(bits, 8 - static_cast<unsigned int>(used));
+		const std::uint32_t part = value & ((1u << take) - 1);
+		m_buffer[m_start + m_bits / 8] |= static_cast<std::uint8_t>(part << used);
+
+		value = (take < 32) ? value >> take : 0;
+		bits -= take;
+		m_bits += take;
+	}
+}
+
+void BitWriter::WriteUnsigned(std::uint64_t value)
+{
+	while (value >= (1u << GroupBits))
+	{
+		this->Write(1, 1);
+		this->Write(static_cast<std::uint32_t>(value & ((1u << GroupBits) - 1)), GroupBits);
+		value >>= GroupBits;
+	}
+	this->Write(0, 1);
+	this->Write(static_cast<std::uint32_t>(value), GroupBits);
+}
+
+void BitWriter::WriteSigned(std::int64_t value)
+{
+	this->WriteUnsigned((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+void BitWriter::Truncate(size_t bits)
+{
+	if (bits > m_bits)
+	{
+		throw std::out_of_range("Can't truncate past the end of a bit stream");
+	}
+	m_bits = bits;
+	m_buffer.resize(m_start + this->GetByteCount());
+	if (m_bits % 8 != 0)
+	{
+		// Later writes OR into the last byte, its spare bits must be clear
+		m_buffer.back() &= static_cast<std::uint8_t>((1u << (m_bits % 8)) - 1);
+	}
+}
+
+BitReader::BitReader(const std::uint8_t* data, size_t size) : m_data(data), m_size_bits(size * 8), m_bits(0)
+{}
+
+std::uint32_t BitReader::Read(unsigned int bits)
+{
+	if (bits > m_size_bits - m_bits)
+	{
+		throw std::runtime_error("Read past the end of a bit stream");
+	}
+
+	std::uint32_t value = 0;
+	unsigned int done = 0;
+	while (done < bits)
+	{
+		const size_t used = m_bits % 8;
+		const unsigned int take = std::min<unsigned int>(bits - done, 8 - static_cast<unsigned int>(used));
+		const std::uint32_t part = (m_data[m_bits / 8] >> used) & ((1u << take) - 1);
+		value |= part << done;
+
+		done += take;
+		m_bits += take;
+	}
+	return value;
+}
+
+std::uint64_t BitReader::ReadUnsigned()
+{
+	std::uint64_t value = 0;
+	for (unsigned int shift = 0; shift < 64; shift += GroupBits)
+	{
+		const bool more = this->Read(1) != 0;
+		value |= static_cast<std::uint64_t>(this->Read(GroupBits)) << shift;
+		if (!more)
+		{
+			return value;
+		}
+	}
+	throw std::runtime_error("Unsigned value too long in bit stream");
+}
+
+std::int64_t BitReader::ReadSigned()
+{
+	const std::uint64_t value = this->ReadUnsigned();
+	return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+/// Packs values into as few bits as they need.  Fixed width fields are
+///  written as is, unsigned values in groups of five bits with a bit in
+///  front of each group saying whether another follows, so anything below
+///  32 costs six bits.  Signed values are zigzagged first, small negative
+///  numbers stay small.
+///
+class BitWriter
+{
+public:
+	// Appends to buffer, whatever is in it already stays
+	explicit BitWriter(std::vector<std::uint8_t>& buffer);
+
+	void Write(std::uint32_t value, unsigned int bits);
+	void WriteUnsigned(std::uint64_t value);
+	void WriteSigned(std::int64_t value);
+
+	// Bits written so far, and going back to an earlier count, e.g. to
+	//  take back something that turned out not to fit
+	size_t GetBitCount() const { return m_bits; }
+	void Truncate(size_t bits);
+
+	// Bytes the bits take up, the last one padded with zeros
+	size_t GetByteCount() const { return (m_bits + 7) / 8; }
+
+private:
+	std::vector<std::uint8_t>& m_buffer;
+	size_t m_start;
+	size_t m_bits;
+};
+
+/// Reads what a BitWriter wrote.  Throws std::runtime_error when reading
+///  past the end.
+///
+class BitReader
+{
+public:
+	BitReader(const std::uint8_t* data, size_t size);
+
+	std::uint32_t Read(unsigned int bits);
+	std::uint64_t ReadUnsigned();
+	std::int64_t ReadSigned();
+
+private:
+	const std::uint8_t* m_data;
+	size_t m_size_bits;
+	size_t m_bits;
+};
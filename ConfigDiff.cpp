@@ -0,0 +1,86 @@
+#include "ConfigDiff.h"
+#include <map>
+
+namespace ConfigFile {
+
+	namespace {
+
+		bool SameContents(const ConfigObject& before, const ConfigObject& after)
+			// Node itself, children not included
+		{
+			if (before.GetName() != after.GetName() || before.GetData() != after.GetData() ||
+				before.GetAttributeCount() != after.GetAttributeCount())
+			{
+				return false;
+			}
+			for (size_t k = 0; k < before.GetAttributeCount(); ++k)
+			{
+				auto name = before.GetAttributeName(k);
+				if (!after.HasAttribute(name) || after.GetAttribute(name) != before.GetAttribute(name))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void DiffChildren(const ConfigObject& before, const ConfigObject& after, const std::string& path, std::vector<ConfigChange>& changes)
+			// Children pair up as the n-th of their name on both sides
+		{
+			auto step = [&path](std::string_view name, size_t position)
+			{
+				return (path.empty() ? "" : path + "/") + std::string(name) + "[" + std::to_string(position) + "]";
+			};
+
+			std::map<std::string_view, std::vector<ConfigObject>> old_children;
+			for (auto child : before.GetChildren())
+			{
+				old_children[child.GetName()].push_back(child);
+			}
+
+			std::map<std::string_view, size_t> seen;
+			for (auto child : after.GetChildren())
+			{
+				const size_t position = ++seen[child.GetName()];
+				auto& olds = old_children[child.GetName()];
+				const auto child_path = step(child.GetName(), position);
+				if (position > olds.size())
+				{
+					changes.push_back({ ConfigChange::Kind::Added, child_path, ConfigObject(), child });
+				}
+				else if (!SameContents(olds[position - 1], child))
+				{
+					changes.push_back({ ConfigChange::Kind::Changed, child_path, olds[position - 1], child });
+				}
+				else
+				{
+					DiffChildren(olds[position - 1], child, child_path, changes);
+				}
+			}
+
+			for (const auto& olds : old_children)
+			{
+				for (size_t k = seen[olds.first]; k < olds.second.size(); ++k)
+				{
+					changes.push_back({ ConfigChange::Kind::Removed, step(olds.first, k + 1), olds.second[k], ConfigObject() });
+				}
+			}
+		}
+
+	}
+
+	std::vector<ConfigChange> DiffConfig(const ConfigObject& before, const ConfigObject& after)
+	{
+		std::vector<ConfigChange> changes;
+		if (!SameContents(before, after))
+		{
+			changes.push_back({ ConfigChange::Kind::Changed, "", before, after });
+		}
+		else
+		{
+			DiffChildren(before, after, "", changes);
+		}
+		return changes;
+	}
+
+} // end namespace ConfigFile
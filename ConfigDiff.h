@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ConfigFileInterface.h"
+
+namespace ConfigFile {
+
+	struct ConfigChange
+		// One subtree that differs between two versions of a config file.
+		//	path works with ConfigPath, each step carries its position among
+		//	siblings of the same name, e.g. "map[1]/layer[2]".
+	{
+		enum class Kind { Added, Removed, Changed };
+
+		Kind kind;
+		std::string path;
+		ConfigObject before;	// invalid when Added
+		ConfigObject after;		// invalid when Removed
+
+		// True if the change is at path or somewhere below it
+		bool Within(std::string_view prefix) const
+		{
+			return this->path.size() >= prefix.size() && this->path.compare(0, prefix.size(), prefix) == 0 &&
+				(this->path.size() == prefix.size() || this->path[prefix.size()] == '/');
+		}
+	};
+
+	// Smallest subtrees that differ.  A node whose name, text or attributes
+	//	changed is reported as a whole, otherwise its children are matched up
+	//	by name and position and compared in turn.  Attribute order doesn't count.
+	std::vector<ConfigChange> DiffConfig(const ConfigObject& before, const ConfigObject& after);
+
+} // end namespace ConfigFile
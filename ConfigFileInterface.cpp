@@ -1,23 +1,64 @@
 #include "ConfigFileInterface.h"
+#include "ConfigPath.h"
+#include "ConfigSnapshot.h"
 #include <fstream>
+#include <stdexcept>
+#include <cstring>
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 typedef std::pair<std::string, int>			sti_pair;
 typedef std::pair<std::string, std::string> sts_pair;
 
+namespace {
+
+	// A cached object and its key in a map node, without the key text
+	constexpr size_t CacheEntryBytes = sizeof(std::string) + sizeof(ConfigFile::ConfigObject) + 4 * sizeof(void*);
+
+}
+
 namespace ConfigFile {
 
-	ConfigFileInterface::ConfigFileInterface(const std::string& filename) : filename(filename), text(nullptr), modified(false), root_node(nullptr)
+	ConfigFileInterface::ConfigFileInterface(const std::string& filename, LoadMode mode) : filename(filename), mode(mode), text(nullptr), modified(false), root_node(nullptr), frozen(false),
+		memory(MemorySubsystem::Config)
 	{
-		auto logger = spdlog::get("EngineLogger");
-		logger->trace("ConfigFileInterface::ConfigFileInterface(std::string filename)");
+		this->logger = spdlog::get("EngineLogger");
+		logger->trace("ConfigFileInterface::ConfigFileInterface(std::string filename, LoadMode mode)");
 		logger->info("ConfigFileInterface created: {0}", filename);
 
-		// Will either return text or throw an exception
-		this->LoadXMLConfigFile(filename);
-		// Then parse it into a tree
-		this->ParseXML();
+		if (mode == LoadMode::Mapped)
+		{
+			// Will either map the file or throw an exception
+			this->MapXMLConfigFile(filename);
+			this->ParseMapped();
+		}
+		else if (mode == LoadMode::Snapshot)
+		{
+			this->tree = ConfigSnapshot::Load(filename);
+			if (this->tree == nullptr)
+			{
+				// Stamp before mapping, a file changing under us must not get a fresh looking snapshot
+				auto stamp = ConfigSnapshot::GetStamp(filename);
+				this->MapXMLConfigFile(filename);
+				stamp.hash = ConfigSnapshot::HashContents(this->mapped.GetData(), this->mapped.GetSize());
+				const bool unchanged = (stamp.size == this->mapped.GetSize());
+
+				// Hashed first, rapidxml writes into the text
+				this->ParseMapped();
+				if (unchanged)
+				{
+					ConfigSnapshot::Save(filename, *this->tree, stamp);
+				}
+			}
+		}
+		else
+		{
+			// Will either return text or throw an exception
+			this->LoadXMLConfigFile(filename);
+			// Then parse it into a tree
+			this->ParseXML(this->text.get());
+		}
+		this->memory.Add(this->tree->GetByteCount());
 	}
 
 	ConfigFileInterface::~ConfigFileInterface()
@@ -27,37 +68,156 @@ namespace ConfigFile {
 		logger->info("ConfigFileInterface destroyed");
 	}
 
-	ConfigObject* ConfigFileInterface::GetConfigObject(const std::string& key) const
-		// Returns non-owning raw pointer to ConfigObject
+	template <typename T>
+	ConfigFileInterface::CacheShard<T>& ConfigFileInterface::ShardFor(std::array<CacheShard<T>, CacheShards>& shards, std::string_view key)
+	{
+		return shards[ConfigTree::Hash(key) & (CacheShards - 1)];
+	}
+
+	const ConfigObject* ConfigFileInterface::GetConfigObject(const std::string& key) const
+		// Returns non-owning raw pointer to ConfigObject, or nullptr if there
+		//   is no top level node with that name.
 		//   Lifetime managed by ConfigFileInterface
 	{
-		auto logger = spdlog::get("EngineLogger");
-		logger->trace("ConfigFileInterface::GetConfigObject(const std::string& key)");
-		logger->debug("Retrieve ConfigObject: \"{0}\"", key);
+		this->logger->trace("ConfigFileInterface::GetConfigObject(const std::string& key)");
+		this->logger->debug("Retrieve ConfigObject: \"{0}\"", key);
 
-		// Check cache, as ConfigObjects are expensive to construct
-		auto coit = this->cache.find(key);
-		
-		if (coit != this->cache.end())
+		auto& shard = ShardFor(this->cache, key);
+
+		// Frozen caches hold every top level object and never change
+		if (this->IsFrozen())
 		{
-			logger->debug("Cache hit! Return stored ConfigObject*");
-			// Return raw pointer to ConfigObject
-			return coit->second.get();
+			auto coit = shard.entries.find(key);
+			return (coit != shard.entries.end()) ? &coit->second : nullptr;
 		}
-		else
+
+		// Check cache, saves scanning the top level nodes again
+		{
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			auto coit = shard.entries.find(key);
+			if (coit != shard.entries.end())
+			{
+				this->logger->debug("Cache hit! Return stored ConfigObject*");
+				// Return raw pointer to ConfigObject
+				return &coit->second;
+			}
+		}
+
+		this->logger->debug("Cache miss. Look up ConfigObject");
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+		// Another thread may have got here first, or frozen the cache
+		auto coit = shard.entries.find(key);
+		if (coit != shard.entries.end())
+		{
+			return &coit->second;
+		}
+		if (this->IsFrozen())
+		{
+			return nullptr;
+		}
+
+		// The tree is already built, this is just a handle on it
+		auto co = this->tree->GetRoot().GetChild(key);
+		this->logger->trace("Node {0} returned when looking for node \"{1}\"", co.GetIndex(), key);
+
+		if (!co)
+		{
+			return nullptr;
+		}
+		this->memory.Add(CacheEntryBytes + key.size());
+		return &shard.entries.emplace(key, co).first->second;
+	}
+
+	const ConfigPath& ConfigFileInterface::CompilePath(const std::string& path) const
+	{
+		auto& shard = ShardFor(this->paths, path);
+		if (this->IsFrozen())
+		{
+			auto pit = shard.entries.find(path);
+			if (pit != shard.entries.end())
+			{
+				return *pit->second;
+			}
+
+			// Too late for the shards, lock-free readers are in there
+			std::lock_guard<std::mutex> lock(this->late_paths_mutex);
+			auto lit = this->late_paths.find(path);
+			if (lit == this->late_paths.end())
+			{
+				this->logger->debug("Config path compiled after freeze: \"{0}\"", path);
+				lit = this->late_paths.emplace(path, std::make_unique<ConfigPath>(path)).first;
+			}
+			return *lit->second;
+		}
+
+		{
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			auto pit = shard.entries.find(path);
+			if (pit != shard.entries.end())
+			{
+				return *pit->second;
+			}
+		}
+
+		// Compiled outside the lock, if another thread wins the race its copy is kept
+		//	Throws on a bad path, in which case nothing is cached
+		auto compiled = std::make_unique<ConfigPath>(path);
+
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		if (this->IsFrozen())
 		{
-			logger->debug("Cache miss. Construct new ConfigObject");
-			// Get the requested config_data from the XML doc
-			auto config_data = this->xmlcf.first_node(key.c_str());
-			logger->trace("Pointer \"{0}\" returned when looking for node \"{1}\"", static_cast<void*>(config_data), key);
+			lock.unlock();
+			return this->CompilePath(path);
+		}
+		return *shard.entries.emplace(path, std::move(compiled)).first->second;
+	}
 
-			// Expensive construction (this is when the text parsing happens,
-			//  very lazy!)
-			auto cop = new ConfigObject(config_data);
-			this->cache.emplace(std::make_pair(key, cop));
+	void ConfigFileInterface::Freeze()
+		// Holds every shard lock while filling the caches, so a miss that was
+		//	already under way either finishes first or sees the flag afterwards
+	{
+		this->logger->trace("ConfigFileInterface::Freeze()");
+		if (this->IsFrozen())
+		{
+			return;
+		}
 
-			return cop;
+		std::vector<std::unique_lock<std::shared_mutex>> locks;
+		locks.reserve(2 * CacheShards);
+		for (auto& shard : this->cache)
+		{
+			locks.emplace_back(shard.mutex);
+		}
+		for (auto& shard : this->paths)
+		{
+			locks.emplace_back(shard.mutex);
 		}
+
+		// First node with a name wins, same as GetChild
+		size_t count = 0;
+		for (auto co : this->tree->GetRoot().GetChildren())
+		{
+			auto name = co.GetName();
+			if (ShardFor(this->cache, name).entries.emplace(std::string(name), co).second)
+			{
+				this->memory.Add(CacheEntryBytes + name.size());
+				count++;
+			}
+		}
+		this->frozen.store(true, std::memory_order_release);
+
+		this->logger->info("ConfigFileInterface frozen: {0} ({1} objects cached)", this->filename, count);
+	}
+
+	std::vector<ConfigObject> ConfigFileInterface::Query(const std::string& path) const
+	{
+		return this->CompilePath(path).Select(this->tree->GetRoot());
+	}
+
+	ConfigObject ConfigFileInterface::QueryFirst(const std::string& path) const
+	{
+		return this->CompilePath(path).SelectFirst(this->tree->GetRoot());
 	}
 
 	const config_node* ConfigFileInterface::GetConfigNode(const std::string& key) const
@@ -66,6 +226,11 @@ namespace ConfigFile {
 		logger->trace("ConfigFileInterface::GetConfigNode(std::string key)");
 		logger->debug("ConfigObject configvalue retrieved: {0}", key);
 
+		if (this->mode != LoadMode::Buffered)
+		{
+			logger->warn("No XML nodes kept for mapped config file: {0}", this->filename);
+			return nullptr;
+		}
 		return this->xmlcf.first_node(key.c_str());
 	}
 
@@ -105,7 +270,7 @@ namespace ConfigFile {
 		auto logger = spdlog::get("EngineLogger");
 		logger->trace("ConfigFileInterface::LoadXMLConfigFile(std::string filename)");
 
-		std::fstream cf(filename);
+		std::ifstream cf(filename, std::ios::binary);
 
 		if (cf.is_open())
 		{
@@ -115,16 +280,17 @@ namespace ConfigFile {
 			// How long is the file? (in chars)
 			// TODO what happens if these are wide chars?
 			cf.seekg(0, cf.end);
-			int length = cf.tellg();
+			const auto length = static_cast<size_t>(cf.tellg());
 			cf.seekg(0, cf.beg);
 
 			// Make buffer to handle config data, RapidXML requires the text to persist
 			// Also "read" does not zero terminate, so add that at the end
 			this->text = std::make_unique<char[]>(length + 1);
+			this->memory.Add(length + 1);
 			cf.read(text.get(), length);
 			text[length] = '\0';
 
-			if (cf.eof())
+			if (static_cast<size_t>(cf.gcount()) == length)
 			{
 				logger->debug("All {0} characters read successfully!", length);
 				//std::cout << text.get() << std::endl;
@@ -145,10 +311,45 @@ namespace ConfigFile {
 		return;
 	}
 
-	void ConfigFileInterface::ParseXML()
+	void ConfigFileInterface::MapXMLConfigFile(std::string filename)
+		// Maps the file copy-on-write, rapidxml writes into the pages but the
+		//	file itself is never touched
 	{
-		// therefore no need to check for null "text" pointer
-		this->xmlcf.parse<0>(this->text.get());
+		auto logger = spdlog::get("EngineLogger");
+		logger->trace("ConfigFileInterface::MapXMLConfigFile(std::string filename)");
+
+		try
+		{
+			this->mapped = MappedFile(filename, MappedFile::Mode::CopyOnWrite);
+		}
+		catch (const std::runtime_error& e)
+		{
+			logger->error("Cannot map file: {0} ({1})", filename, e.what());
+			throw ConfigFileException("Cannot find or open config file.", "", filename);
+		}
+
+		logger->info("File mapped successfully: {0}", filename);
+		logger->debug("{0} characters mapped", this->mapped.GetSize());
+	}
+
+	void ConfigFileInterface::ParseMapped()
+		// Strings move into the tree, so neither rapidxml nor the pages are needed after
+	{
+		this->ParseXML(this->mapped.GetData());
+
+		this->tree->OwnStrings();
+		this->xmlcf.clear();
+		this->root_node = nullptr;
+		this->mapped.Release();
+
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Mapped file released: {0}", this->filename);
+	}
+
+	void ConfigFileInterface::ParseXML(char* buffer)
+	{
+		// therefore no need to check for null buffer pointer
+		this->xmlcf.parse<0>(buffer);
 
 		// Get root node
 		//this->root_node = this->xmlcf.first_node("root");
@@ -159,42 +360,340 @@ namespace ConfigFile {
 			logger->error("Config file format error - no root node");
 			throw ConfigFileException("Config file format error - no root node", "", filename);
 		}
+
+		// Flatten the whole document once, lookups never touch rapidxml again
+		this->tree = std::make_unique<ConfigTree>(this->xmlcf, buffer);
+
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("ConfigTree built with {0} nodes and {1} attributes", this->tree->GetNodeCount(), this->tree->GetAttributeCount());
 	}
 
-	ConfigObject::ConfigObject(config_node* config_data)
+	ConfigTree::ConfigTree(const config_node& document, const char* text) :
+		strings_size(0), nodes(nullptr), attributes(nullptr), slots(nullptr),
+		node_count(0), attribute_count(0), slot_count(0), text(text)
 	{
-		auto logger = spdlog::get("EngineLogger");
-		logger->trace("ConfigObject::ConfigObject(config_node*)");
+		// Counting pass, so everything fits in a single block
+		std::vector<const config_node*> order;
+		{
+			std::vector<const config_node*> stack;
+			stack.push_back(&document);
+			while (!stack.empty())
+			{
+				const config_node* cn = stack.back();
+				stack.pop_back();
+				++this->node_count;
 
-		this->name = config_data->name();
-		this->data = config_data->value();
-		logger->debug("ConfigObject name \"{0}\" with data \"{1}\"", this->name, this->data);
+				std::uint32_t num_attributes = 0;
+				for (auto attr = cn->first_attribute(); attr != nullptr; attr = attr->next_attribute())
+				{
+					++num_attributes;
+				}
+				this->attribute_count += num_attributes;
+				if (num_attributes > 0)
+				{
+					std::uint32_t slots_needed = 1;
+					while (slots_needed < 2 * num_attributes)
+					{
+						slots_needed *= 2;
+					}
+					this->slot_count += slots_needed;
+				}
 
-		for (auto attr = config_data->first_attribute(); attr != nullptr; attr = attr->next_attribute())
+				for (auto child = cn->first_node(); child != nullptr; child = child->next_sibling())
+				{
+					if (child->type() == rapidxml::node_element)
+					{
+						stack.push_back(child);
+					}
+				}
+			}
+		}
+
+		const size_t node_bytes = this->node_count * sizeof(Node);
+		const size_t attribute_bytes = this->attribute_count * sizeof(Attribute);
+		const size_t slot_bytes = this->slot_count * sizeof(std::uint32_t);
+		this->block = std::make_unique<std::uint64_t[]>((node_bytes + attribute_bytes + slot_bytes + 7) / 8);
+
+		auto base = reinterpret_cast<char*>(this->block.get());
+		Node* node_out = reinterpret_cast<Node*>(base);
+		Attribute* attribute_out = reinterpret_cast<Attribute*>(base + node_bytes);
+		std::uint32_t* slot_out = reinterpret_cast<std::uint32_t*>(base + node_bytes + attribute_bytes);
+
+		// Strings of length zero may point anywhere (rapidxml uses a static "")
+		auto offset_of = [text](const char* p, size_t length) -> std::uint64_t
+		{
+			return (length == 0) ? 0 : static_cast<std::uint64_t>(p - text);
+		};
+
+		// Breadth first, the nodes array doubles as the queue
+		order.reserve(this->node_count);
+		order.push_back(&document);
+		std::uint32_t next_attribute = 0;
+		std::uint32_t next_slot = 0;
+		for (size_t k = 0; k < order.size(); ++k)
+		{
+			const config_node* cn = order[k];
+			Node& node = node_out[k];
+
+			node.name_offset = offset_of(cn->name(), cn->name_size());
+			node.name_length = static_cast<std::uint32_t>(cn->name_size());
+			node.name_hash = Hash(std::string_view(cn->name(), cn->name_size()));
+			node.data_offset = offset_of(cn->value(), cn->value_size());
+			node.data_length = static_cast<std::uint32_t>(cn->value_size());
+			node.padding = 0;
+
+			node.first_attribute = next_attribute;
+			node.attribute_count = 0;
+			for (auto attr = cn->first_attribute(); attr != nullptr; attr = attr->next_attribute())
+			{
+				Attribute& a = attribute_out[next_attribute++];
+				a.name_offset = offset_of(attr->name(), attr->name_size());
+				a.name_length = static_cast<std::uint32_t>(attr->name_size());
+				a.name_hash = Hash(std::string_view(attr->name(), attr->name_size()));
+				a.value_offset = offset_of(attr->value(), attr->value_size());
+				a.value_length = static_cast<std::uint32_t>(attr->value_size());
+				a.padding = 0;
+				++node.attribute_count;
+			}
+
+			node.first_slot = next_slot;
+			node.slot_count = 0;
+			if (node.attribute_count > 0)
+			{
+				node.slot_count = 1;
+				while (node.slot_count < 2 * node.attribute_count)
+				{
+					node.slot_count *= 2;
+				}
+				std::memset(slot_out + next_slot, 0, node.slot_count * sizeof(std::uint32_t));
+
+				// Linear probing, slots hold attribute index + 1 so zero means empty.
+				//	Only the first of several equal names is reachable, like the old map.
+				for (std::uint32_t a = node.first_attribute; a < node.first_attribute + node.attribute_count; ++a)
+				{
+					std::uint32_t mask = node.slot_count - 1;
+					std::uint32_t s = attribute_out[a].name_hash & mask;
+					while (slot_out[next_slot + s] != 0)
+					{
+						s = (s + 1) & mask;
+					}
+					slot_out[next_slot + s] = a + 1;
+				}
+				next_slot += node.slot_count;
+			}
+
+			node.first_child = static_cast<std::uint32_t>(order.size());
+			node.child_count = 0;
+			for (auto child = cn->first_node(); child != nullptr; child = child->next_sibling())
+			{
+				if (child->type() == rapidxml::node_element)
+				{
+					order.push_back(child);
+					++node.child_count;
+				}
+			}
+		}
+
+		this->nodes = node_out;
+		this->attributes = attribute_out;
+		this->slots = slot_out;
+	}
+
+	ConfigTree::ConfigTree(MappedFile&& image, const char* block, size_t node_count, size_t attribute_count, size_t slot_count, const char* text) :
+		strings_size(0), image(std::move(image)),
+		node_count(node_count), attribute_count(attribute_count), slot_count(slot_count), text(text)
+	{
+		this->nodes = reinterpret_cast<const Node*>(block);
+		this->attributes = reinterpret_cast<const Attribute*>(block + node_count * sizeof(Node));
+		this->slots = reinterpret_cast<const std::uint32_t*>(block + node_count * sizeof(Node) + attribute_count * sizeof(Attribute));
+	}
+
+	size_t ConfigTree::GetBlockSize() const
+	{
+		return this->node_count * sizeof(Node) + this->attribute_count * sizeof(Attribute) + this->slot_count * sizeof(std::uint32_t);
+	}
+
+	size_t ConfigTree::GetByteCount() const
+		// Mapped from a snapshot, the whole image is the tree
+	{
+		return this->image.IsOpen() ? this->image.GetSize() : this->GetBlockSize() + this->strings_size;
+	}
+
+	void ConfigTree::OwnStrings()
+		// Trees mapped from a snapshot own their strings already
+	{
+		if (this->strings || this->image.IsOpen())
 		{
-			this->attrib_map[attr->name()] = attr->value();
-			logger->debug("ConfigObject attribute \"{0}\" with value \"{1}\"", attr->name(), attr->value());
+			return;
 		}
 
-		auto cn = config_data->first_node();
-		while (cn != nullptr)
+		Node* node_out = reinterpret_cast<Node*>(this->block.get());
+		Attribute* attribute_out = reinterpret_cast<Attribute*>(reinterpret_cast<char*>(this->block.get()) + this->node_count * sizeof(Node));
+
+		size_t total = 1;
+		for (size_t k = 0; k < this->node_count; ++k)
 		{
-			// Use pointer to child config_data to create a ConfigObject in this->children vector
-			this->children.emplace_back(cn);
-			// Also store a map from name to index
-			this->children_byname.emplace(std::make_pair<std::string, int>(std::string(cn->name()), this->children.size()-1));
-			cn = cn->next_sibling();
+			total += node_out[k].name_length + node_out[k].data_length;
 		}
+		for (size_t k = 0; k < this->attribute_count; ++k)
+		{
+			total += attribute_out[k].name_length + attribute_out[k].value_length;
+		}
+
+		auto owned = std::make_unique<char[]>(total);
+		std::uint64_t next = 1;	// offset zero stays the empty string
+		owned[0] = '\0';
+		auto move_string = [&](std::uint64_t& offset, std::uint32_t length)
+		{
+			if (length == 0)
+			{
+				offset = 0;
+				return;
+			}
+			std::memcpy(owned.get() + next, this->text + offset, length);
+			offset = next;
+			next += length;
+		};
+
+		for (size_t k = 0; k < this->node_count; ++k)
+		{
+			move_string(node_out[k].name_offset, node_out[k].name_length);
+			move_string(node_out[k].data_offset, node_out[k].data_length);
+		}
+		for (size_t k = 0; k < this->attribute_count; ++k)
+		{
+			move_string(attribute_out[k].name_offset, attribute_out[k].name_length);
+			move_string(attribute_out[k].value_offset, attribute_out[k].value_length);
+		}
+
+		this->strings = std::move(owned);
+		this->strings_size = total;
+		this->text = this->strings.get();
 	}
 
-	const std::string& ConfigObject::GetAttribute(const std::string& key) const
+	ConfigObject ConfigTree::GetRoot() const
 	{
-		return this->attrib_map.at(key);
+		return ConfigObject(this, 0);
 	}
 
-	void ConfigObject::SetAttribute(const std::string& key, const std::string& val)
+	const ConfigTree::Attribute* ConfigTree::FindAttribute(std::uint32_t index, std::string_view key) const
 	{
-		this->attrib_map.emplace(std::make_pair(key, val));
+		const Node& node = this->nodes[index];
+		if (node.slot_count == 0)
+		{
+			return nullptr;
+		}
+
+		const std::uint32_t hash = Hash(key);
+		const std::uint32_t mask = node.slot_count - 1;
+		for (std::uint32_t s = hash & mask; ; s = (s + 1) & mask)
+		{
+			const std::uint32_t slot = this->slots[node.first_slot + s];
+			if (slot == 0)
+			{
+				return nullptr;
+			}
+			const Attribute& attr = this->attributes[slot - 1];
+			if (attr.name_hash == hash && this->GetString(attr.name_offset, attr.name_length) == key)
+			{
+				return &attr;
+			}
+		}
+	}
+
+	std::uint32_t ConfigTree::Hash(std::string_view key)
+		// FNV-1a, short keys and no allocation
+	{
+		std::uint32_t h = 2166136261u;
+		for (char c : key)
+		{
+			h ^= static_cast<unsigned char>(c);
+			h *= 16777619u;
+		}
+		return h;
+	}
+
+	std::string_view ConfigObject::GetName() const
+	{
+		if (this->tree == nullptr)
+		{
+			return std::string_view();
+		}
+		const auto& node = this->tree->GetNode(this->index);
+		return this->tree->GetString(node.name_offset, node.name_length);
+	}
+
+	std::string_view ConfigObject::GetAttribute(std::string_view key) const
+		// Throws std::out_of_range for a missing attribute
+	{
+		auto attr = this->tree ? this->tree->FindAttribute(this->index, key) : nullptr;
+		if (attr == nullptr)
+		{
+			throw std::out_of_range("ConfigObject has no attribute: " + std::string(key));
+		}
+		return this->tree->GetString(attr->value_offset, attr->value_length);
+	}
+
+	bool ConfigObject::HasAttribute(std::string_view key) const
+	{
+		return this->tree && this->tree->FindAttribute(this->index, key) != nullptr;
+	}
+
+	size_t ConfigObject::GetAttributeCount() const
+	{
+		return this->tree ? this->tree->GetNode(this->index).attribute_count : 0;
+	}
+
+	std::string_view ConfigObject::GetAttributeName(size_t k) const
+		// Throws std::out_of_range past the last attribute
+	{
+		if (k >= this->GetAttributeCount())
+		{
+			throw std::out_of_range("ConfigObject has no attribute number: " + std::to_string(k));
+		}
+		const auto& node = this->tree->GetNode(this->index);
+		const auto& attribute = this->tree->GetAttribute(node.first_attribute + static_cast<std::uint32_t>(k));
+		return this->tree->GetString(attribute.name_offset, attribute.name_length);
+	}
+
+	std::string_view ConfigObject::GetData() const
+	{
+		if (this->tree == nullptr)
+		{
+			return std::string_view();
+		}
+		const auto& node = this->tree->GetNode(this->index);
+		return this->tree->GetString(node.data_offset, node.data_length);
+	}
+
+	ConfigRange ConfigObject::GetChildren() const
+	{
+		if (this->tree == nullptr)
+		{
+			return ConfigRange();
+		}
+		const auto& node = this->tree->GetNode(this->index);
+		return ConfigRange(this->tree, node.first_child, node.child_count);
+	}
+
+	ConfigObject ConfigObject::GetChild(std::string_view name) const
+	{
+		if (this->tree == nullptr)
+		{
+			return ConfigObject();
+		}
+		const auto& node = this->tree->GetNode(this->index);
+		const std::uint32_t hash = ConfigTree::Hash(name);
+
+		for (std::uint32_t k = node.first_child; k < node.first_child + node.child_count; ++k)
+		{
+			const auto& child = this->tree->GetNode(k);
+			if (child.name_hash == hash && this->tree->GetString(child.name_offset, child.name_length) == name)
+			{
+				return ConfigObject(this->tree, k);
+			}
+		}
+		return ConfigObject();
 	}
 	
 } // end namespace ConfigFile
\ No newline at end of file
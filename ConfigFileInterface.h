@@ -2,83 +2,276 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
 #include <memory>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
 #include "rapidxml-1.13\rapidxml.hpp"
+#include "MappedFile.h"
+#include "MemoryTelemetry.h"
+
+namespace spdlog { class logger; }
 
 namespace ConfigFile {
 
 	using config_node = rapidxml::xml_node<char>;
 	using config_attribute = rapidxml::xml_attribute<char>;
 	class ConfigObject;
+	class ConfigTree;
+	class ConfigPath;
+	class ConfigSnapshot;
 
 	class ConfigFileInterface
 		// Converts an XML configuration file into ConfigObjects
 		// TODO enable writing configuration files!
 		// Set and insert functions work on in-memory objects, but currently nothing writes to files.
+		//
+		// Lookups are safe from any number of threads.  The object and path
+		//	caches are split into shards with a reader/writer lock each, so hits
+		//	only ever share a lock and racing misses build an entry once.  After
+		//	Freeze the caches never change again and hits take no lock at all.
 	{
 	public:
-		ConfigFileInterface(const std::string& filename);
+		// Buffered reads the file into memory and keeps the rapidxml document.
+		//	Mapped parses a private file mapping in place, then keeps only the
+		//	ConfigTree (with its own copy of the strings) and unmaps the file.
+		//	Snapshot is Mapped, plus the tree is written to a binary snapshot
+		//	next to the file and later loads map that instead of parsing.
+		//	GetConfigNode is not available for Mapped or Snapshot files.
+		enum class LoadMode { Buffered, Mapped, Snapshot };
+
+		ConfigFileInterface(const std::string& filename, LoadMode mode = LoadMode::Buffered);
 		~ConfigFileInterface();
 
-		ConfigObject* GetConfigObject(const std::string& key) const;
+		const ConfigObject* GetConfigObject(const std::string& key) const;
 		const config_node* GetConfigNode(const std::string& key) const;
-		
+		const ConfigTree& GetTree() const { return *this->tree; }
+
+		// Path queries from the document root, see ConfigPath for the syntax.
+		//	Paths are compiled on first use and kept for the next lookup.
+		const ConfigPath& CompilePath(const std::string& path) const;
+		std::vector<ConfigObject> Query(const std::string& path) const;
+		ConfigObject QueryFirst(const std::string& path) const;
+
 		const std::string& GetFilename() const;
-		
+
+		// Caches every top level object and stops changing the caches, call
+		//	once startup is done.  Paths first compiled after this still work
+		//	but go through a lock.
+		void Freeze();
+		bool IsFrozen() const { return this->frozen.load(std::memory_order_acquire); }
+
 		void SetConfigValue(std::string key, std::string value);
 		void InsertConfigValue(config_node* data);
 
 	private:
 
 		void LoadXMLConfigFile(std::string filename);
-		void ParseXML();
+		void MapXMLConfigFile(std::string filename);
+		void ParseXML(char* buffer);
+		void ParseMapped();
 
 		std::string filename;
+		LoadMode mode;
 		std::unique_ptr<char[]> text;
+		MappedFile mapped;
 
 		rapidxml::xml_document<char> xmlcf;
 		config_node* root_node;
 
-		mutable std::map<std::string, std::unique_ptr<ConfigObject>> cache;
+		static constexpr size_t CacheShards = 16;
+
+		template <typename T>
+		struct CacheShard
+		{
+			std::shared_mutex mutex;
+			std::map<std::string, T, std::less<>> entries;
+		};
+
+		template <typename T>
+		static CacheShard<T>& ShardFor(std::array<CacheShard<T>, CacheShards>& shards, std::string_view key);
+
+		std::unique_ptr<ConfigTree> tree;
+		mutable std::array<CacheShard<ConfigObject>, CacheShards> cache;
+		mutable std::array<CacheShard<std::unique_ptr<ConfigPath>>, CacheShards> paths;
+		mutable std::mutex late_paths_mutex;
+		mutable std::map<std::string, std::unique_ptr<ConfigPath>, std::less<>> late_paths;
+		std::atomic<bool> frozen;
+
+		// Kept so lookups don't go through the spdlog registry lock
+		std::shared_ptr<spdlog::logger> logger;
 
 		bool modified;
+
+		// Text, tree and cached objects
+		mutable MemoryAccount memory;
 	};
 
+	class ConfigTree
+		// Flat, read only copy of a parsed XML document.  Nodes are stored
+		//	breadth first so the children of a node are one contiguous index
+		//	range.  Attributes of a node sit in a small open addressing table
+		//	keyed by name hash.  Strings are offsets into the text rapidxml
+		//	parsed in place, nothing is copied unless OwnStrings is called.
+		//
+		//	Nodes, attributes and hash slots share a single block sized by a
+		//	counting pass, so building a tree is one allocation whatever the
+		//	size of the file.  Everything is offsets, so ConfigSnapshot can
+		//	write the block and strings out as they are and map them back.
+	{
+	public:
+		struct Node
+		{
+			std::uint64_t name_offset;
+			std::uint64_t data_offset;
+			std::uint32_t name_length;
+			std::uint32_t data_length;
+			std::uint32_t name_hash;
+			std::uint32_t first_child;
+			std::uint32_t child_count;
+			std::uint32_t first_attribute;
+			std::uint32_t attribute_count;
+			std::uint32_t first_slot;
+			std::uint32_t slot_count;	// zero or a power of two
+			std::uint32_t padding;
+		};
+
+		struct Attribute
+		{
+			std::uint64_t name_offset;
+			std::uint64_t value_offset;
+			std::uint32_t name_length;
+			std::uint32_t value_length;
+			std::uint32_t name_hash;
+			std::uint32_t padding;
+		};
+
+		ConfigTree(const config_node& document, const char* text);
+		~ConfigTree() = default;
+
+		ConfigTree(const ConfigTree&) = delete;
+		ConfigTree& operator=(const ConfigTree&) = delete;
+
+		// The document node, top level elements are its children
+		ConfigObject GetRoot() const;
+
+		// Copy every string into a buffer owned by the tree, after which the
+		//	parsed text can go away
+		void OwnStrings();
+
+		size_t GetNodeCount() const { return this->node_count; }
+		size_t GetByteCount() const;
+		size_t GetAttributeCount() const { return this->attribute_count; }
+
+		const Node& GetNode(std::uint32_t index) const { return this->nodes[index]; }
+		const Attribute& GetAttribute(std::uint32_t index) const { return this->attributes[index]; }
+		const Attribute* FindAttribute(std::uint32_t index, std::string_view key) const;
+		std::string_view GetString(std::uint64_t offset, std::uint32_t length) const
+		{
+			return std::string_view(this->text + offset, length);
+		}
+
+		static std::uint32_t Hash(std::string_view key);
+
+	private:
+		friend class ConfigSnapshot;
+
+		// Tree living inside a mapped snapshot, see ConfigSnapshot
+		ConfigTree(MappedFile&& image, const char* block, size_t node_count, size_t attribute_count, size_t slot_count, const char* text);
+
+		size_t GetBlockSize() const;
+
+		std::unique_ptr<std::uint64_t[]> block;
+		std::unique_ptr<char[]> strings;
+		size_t strings_size;
+		MappedFile image;
+
+		const Node* nodes;
+		const Attribute* attributes;
+		const std::uint32_t* slots;
+		size_t node_count;
+		size_t attribute_count;
+		size_t slot_count;
+
+		const char* text;
+	};
+
+	class ConfigRange;
+
 	class ConfigObject
-		// Converts an XML node structure into a set of maps.
-		//	Actual values are retrieved from the maps using string based keywords.
-		//	This is basically a crude Python Dict that is type-aware...
+		// Handle on one node of a ConfigTree, two words, cheap to copy around.
+		//	Valid for as long as the ConfigFileInterface that made the tree.
+		//	Invalid objects (from a failed GetChild) look empty and have no attributes.
 		//
 		// TODO enable serializing a configuration back into an XML node structure.
+		//	Setting values needs owned strings, the tree only views the file text.
 	{
 	public:
-		ConfigObject(config_node* config_data);
+		ConfigObject() : tree(nullptr), index(0) {}
+		ConfigObject(const ConfigTree* tree, std::uint32_t index) : tree(tree), index(index) {}
 		~ConfigObject() = default;
 
-		virtual config_node* Serialize() { return nullptr; }
+		config_node* Serialize() const { return nullptr; }
+
+		std::string_view GetName() const;
+		std::string_view GetAttribute(std::string_view key) const;
+		bool HasAttribute(std::string_view key) const;
+		std::string_view GetData() const;
 
-		const std::string& GetName() const { return this->name; }
-		const std::string& GetAttribute(const std::string& key) const;
-		const std::string& GetData() const { return this->data; }
-		const std::vector<ConfigObject>& GetChildren() const { return this->children; }
+		// Attributes in document order, for walking all of them
+		size_t GetAttributeCount() const;
+		std::string_view GetAttributeName(size_t k) const;
+		ConfigRange GetChildren() const;
 
-	protected:
-		// May make these public once we enable setting/saving configurations
-		// TODO make these public
-		void SetAttribute(const std::string& key, const std::string& val);
-		void AddChild(ConfigObject co);
+		// First child with the given name, an invalid object if there is none
+		ConfigObject GetChild(std::string_view name) const;
+
+		std::uint32_t GetIndex() const { return this->index; }
+		const ConfigTree* GetTree() const { return this->tree; }
+		explicit operator bool() const { return this->tree != nullptr; }
 
 	private:
-		// Contains conversion maps per type
-		// Right now you have to know the type you are expecting
-		std::string name;
+		const ConfigTree* tree;
+		std::uint32_t index;
+	};
+
+	class ConfigRange
+		// Children of a ConfigObject, iterates by value
+	{
+	public:
+		class iterator
+		{
+		public:
+			iterator(const ConfigTree* tree, std::uint32_t index) : tree(tree), index(index) {}
 
-		std::map<std::string, std::string> attrib_map;
-		std::string data;
-		std::vector<ConfigObject> children;
-		std::multimap<std::string, int> children_byname;
+			ConfigObject operator*() const { return ConfigObject(this->tree, this->index); }
+			iterator& operator++() { ++this->index; return *this; }
+			bool operator==(const iterator& other) const { return this->index == other.index; }
+			bool operator!=(const iterator& other) const { return this->index != other.index; }
+
+		private:
+			const ConfigTree* tree;
+			std::uint32_t index;
+		};
+
+		ConfigRange() : tree(nullptr), first(0), count(0) {}
+		ConfigRange(const ConfigTree* tree, std::uint32_t first, std::uint32_t count) : tree(tree), first(first), count(count) {}
+
+		iterator begin() const { return iterator(this->tree, this->first); }
+		iterator end() const { return iterator(this->tree, this->first + this->count); }
+		size_t size() const { return this->count; }
+		bool empty() const { return this->count == 0; }
+		ConfigObject operator[](size_t k) const { return ConfigObject(this->tree, this->first + static_cast<std::uint32_t>(k)); }
+
+	private:
+		const ConfigTree* tree;
+		std::uint32_t first;
+		std::uint32_t count;
 	};
 
 	struct ConfigFileException
@@ -0,0 +1,238 @@
+#include "ConfigPath.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace ConfigFile {
+
+	ConfigPath::ConfigPath(std::string_view path) : path(path)
+		// Throws ConfigFileException if the path can't be parsed
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->trace("ConfigPath::ConfigPath(std::string_view path)");
+		logger->debug("Compiling config path: \"{0}\"", this->path);
+
+		auto fail = [this](const char* why)
+		{
+			spdlog::get("EngineLogger")->error("Bad config path \"{0}\": {1}", this->path, why);
+			return ConfigFileException(why, this->path, "");
+		};
+
+		size_t pos = 0;
+		if (!path.empty() && path[0] == '/')
+		{
+			++pos;
+		}
+
+		while (pos < path.size())
+		{
+			Step step;
+
+			size_t name_end = path.find_first_of("/[", pos);
+			if (name_end == std::string_view::npos)
+			{
+				name_end = path.size();
+			}
+			step.name = std::string(path.substr(pos, name_end - pos));
+			if (step.name.empty())
+			{
+				throw fail("Empty step");
+			}
+			step.any_name = (step.name == "*");
+			step.name_hash = ConfigTree::Hash(step.name);
+			pos = name_end;
+
+			while (pos < path.size() && path[pos] == '[')
+			{
+				const size_t close = path.find(']', pos);
+				if (close == std::string_view::npos)
+				{
+					throw fail("Missing ']'");
+				}
+				std::string_view body = path.substr(pos + 1, close - pos - 1);
+				pos = close + 1;
+
+				if (body == "*")
+				{
+					continue;
+				}
+
+				Predicate pred;
+				pred.position = 0;
+				if (!body.empty() && body[0] == '@')
+				{
+					const size_t eq = body.find('=');
+					pred.attribute = std::string(body.substr(1, eq == std::string_view::npos ? std::string_view::npos : eq - 1));
+					if (pred.attribute.empty())
+					{
+						throw fail("Empty attribute name");
+					}
+					if (eq == std::string_view::npos)
+					{
+						pred.kind = Predicate::Kind::HasAttribute;
+					}
+					else
+					{
+						std::string_view value = body.substr(eq + 1);
+						if (value.size() < 2 || (value.front() != '\'' && value.front() != '"') || value.back() != value.front())
+						{
+							throw fail("Attribute value must be quoted");
+						}
+						pred.kind = Predicate::Kind::AttributeEquals;
+						pred.value = std::string(value.substr(1, value.size() - 2));
+					}
+				}
+				else
+				{
+					std::uint32_t n = 0;
+					for (char c : body)
+					{
+						if (c < '0' || c > '9')
+						{
+							throw fail("Expected @attribute, * or a position");
+						}
+						n = n * 10 + (c - '0');
+					}
+					if (body.empty() || n == 0)
+					{
+						throw fail("Positions count from 1");
+					}
+					pred.kind = Predicate::Kind::Position;
+					pred.position = n;
+				}
+				if (step.predicates.size() == MaxPredicates)
+				{
+					throw fail("Too many predicates on one step");
+				}
+				step.predicates.push_back(std::move(pred));
+			}
+
+			if (pos < path.size())
+			{
+				if (path[pos] != '/')
+				{
+					throw fail("Expected '/' after predicate");
+				}
+				++pos;
+			}
+			this->steps.push_back(std::move(step));
+		}
+	}
+
+	std::vector<ConfigObject> ConfigPath::Select(const ConfigObject& context) const
+	{
+		std::vector<ConfigObject> out;
+		this->Select(context, out);
+		return out;
+	}
+
+	void ConfigPath::Select(const ConfigObject& context, std::vector<ConfigObject>& out) const
+		// Breadth first, one frontier per step
+	{
+		out.clear();
+		if (!context)
+		{
+			return;
+		}
+		out.push_back(context);
+
+		std::vector<ConfigObject> next;
+		for (const auto& step : this->steps)
+		{
+			next.clear();
+			for (const auto& parent : out)
+			{
+				// Position predicates count per parent
+				std::uint32_t counts[MaxPredicates] = { 0 };
+				for (auto child : parent.GetChildren())
+				{
+					if (this->Accept(step, child, counts))
+					{
+						next.push_back(child);
+					}
+				}
+			}
+			out.swap(next);
+			if (out.empty())
+			{
+				break;
+			}
+		}
+	}
+
+	ConfigObject ConfigPath::SelectFirst(const ConfigObject& context) const
+	{
+		if (!context)
+		{
+			return ConfigObject();
+		}
+		return this->SelectFirst(context, 0);
+	}
+
+	ConfigObject ConfigPath::SelectFirst(const ConfigObject& context, size_t step_index) const
+		// Depth first with early exit, no allocation
+	{
+		if (step_index == this->steps.size())
+		{
+			return context;
+		}
+
+		const auto& step = this->steps[step_index];
+		std::uint32_t counts[MaxPredicates] = { 0 };
+		for (auto child : context.GetChildren())
+		{
+			if (!this->Accept(step, child, counts))
+			{
+				continue;
+			}
+
+			auto found = this->SelectFirst(child, step_index + 1);
+			if (found)
+			{
+				return found;
+			}
+		}
+		return ConfigObject();
+	}
+
+	bool ConfigPath::Accept(const Step& step, const ConfigObject& co, std::uint32_t* counts) const
+		// Name test, then predicates in order.  Position predicates only
+		//	count candidates that got past everything before them.
+	{
+		if (!step.any_name)
+		{
+			const auto& node = co.GetTree()->GetNode(co.GetIndex());
+			if (node.name_hash != step.name_hash || co.GetName() != step.name)
+			{
+				return false;
+			}
+		}
+
+		for (size_t k = 0; k < step.predicates.size(); ++k)
+		{
+			const auto& pred = step.predicates[k];
+			switch (pred.kind)
+			{
+			case Predicate::Kind::HasAttribute:
+				if (!co.HasAttribute(pred.attribute))
+				{
+					return false;
+				}
+				break;
+			case Predicate::Kind::AttributeEquals:
+				if (!co.HasAttribute(pred.attribute) || co.GetAttribute(pred.attribute) != pred.value)
+				{
+					return false;
+				}
+				break;
+			case Predicate::Kind::Position:
+				if (++counts[k] != pred.position)
+				{
+					return false;
+				}
+				break;
+			}
+		}
+		return true;
+	}
+
+} // end namespace ConfigFile
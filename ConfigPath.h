@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "ConfigFileInterface.h"
+
+namespace ConfigFile {
+
+	class ConfigPath
+		// A path query compiled once and matched straight against a ConfigTree.
+		//	Steps are separated by '/', each is a node name or '*' followed by
+		//	any number of predicates:
+		//		[@name='value']	attribute equals value
+		//		[@name]			attribute is present
+		//		[n]				n-th match among its siblings, counting from 1
+		//		[*]				any, same as no predicate
+		//	e.g. "map/layer[@name='ground']/data" or "tileset[*]".
+		//	Names are compared by hash first, so a step rarely touches a string.
+	{
+	public:
+		explicit ConfigPath(std::string_view path);
+		~ConfigPath() = default;
+
+		// All matches below context, in document order per step
+		std::vector<ConfigObject> Select(const ConfigObject& context) const;
+		void Select(const ConfigObject& context, std::vector<ConfigObject>& out) const;
+
+		// First match below context, invalid ConfigObject if there is none
+		ConfigObject SelectFirst(const ConfigObject& context) const;
+
+		const std::string& GetPath() const { return this->path; }
+
+	private:
+		struct Predicate
+		{
+			enum class Kind { HasAttribute, AttributeEquals, Position };
+
+			Kind kind;
+			std::string attribute;
+			std::string value;
+			std::uint32_t position;
+		};
+
+		struct Step
+		{
+			bool any_name;
+			std::string name;
+			std::uint32_t name_hash;
+			std::vector<Predicate> predicates;
+		};
+
+		static constexpr size_t MaxPredicates = 8;
+
+		bool Accept(const Step& step, const ConfigObject& co, std::uint32_t* counts) const;
+		ConfigObject SelectFirst(const ConfigObject& context, size_t step) const;
+
+		std::string path;
+		std::vector<Step> steps;
+	};
+
+} // end namespace ConfigFile
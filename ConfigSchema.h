@@ -0,0 +1,234 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <limits>
+#include <charconv>
+#include <type_traits>
+
+#include "ConfigFileInterface.h"
+
+namespace ConfigFile {
+
+	struct ConfigError
+		// One problem found while binding a ConfigObject
+	{
+		std::string node;
+		std::string field;
+		std::string message;
+
+		std::string ToString() const
+		{
+			return this->field.empty() ? this->node + ": " + this->message
+				: this->node + "/" + this->field + ": " + this->message;
+		}
+	};
+
+	template <typename S, typename T>
+	struct Field
+		// One attribute bound to a member of S.  Numbers are checked against
+		//	[min, max], strings have their length checked instead.  Optional
+		//	fields take the fallback when the attribute is missing.
+	{
+		static_assert(std::is_arithmetic_v<T> || std::is_same_v<T, std::string>,
+			"Config fields must be bool, a number or std::string");
+
+		using Limit = std::conditional_t<std::is_arithmetic_v<T>, T, size_t>;
+		using Default = std::conditional_t<std::is_arithmetic_v<T>, T, std::string_view>;
+
+		std::string_view name;
+		T S::* member;
+		bool required;
+		Default fallback;
+		Limit min;
+		Limit max;
+	};
+
+	template <typename S, typename T>
+	constexpr Field<S, T> Required(std::string_view name, T S::* member,
+		typename Field<S, T>::Limit min = std::numeric_limits<typename Field<S, T>::Limit>::lowest(),
+		typename Field<S, T>::Limit max = std::numeric_limits<typename Field<S, T>::Limit>::max())
+	{
+		return Field<S, T>{ name, member, true, typename Field<S, T>::Default{}, min, max };
+	}
+
+	template <typename S, typename T>
+	constexpr Field<S, T> Optional(std::string_view name, T S::* member, typename Field<S, T>::Default fallback,
+		typename Field<S, T>::Limit min = std::numeric_limits<typename Field<S, T>::Limit>::lowest(),
+		typename Field<S, T>::Limit max = std::numeric_limits<typename Field<S, T>::Limit>::max())
+	{
+		return Field<S, T>{ name, member, false, fallback, min, max };
+	}
+
+	template <typename S, typename... Fields>
+	class ConfigSchema
+		// Describes how the attributes of one config node map onto struct S,
+		//	meant to be built at compile time:
+		//
+		//		constexpr auto schema = MakeSchema<Window>("rootwindow",
+		//			Required("width", &Window::width, 1, 16384),
+		//			Optional("title", &Window::title, "Untitled")).Strict();
+		//
+		//	Binding goes through every field even after a failure, so one run
+		//	reports everything that is wrong with the node.  Strict schemas also
+		//	reject attributes they don't know, which catches typos in optional
+		//	field names.
+	{
+	public:
+		constexpr ConfigSchema(std::string_view node, bool strict, Fields... fields) :
+			node(node), strict(strict), fields(fields...)
+		{}
+
+		constexpr ConfigSchema Strict() const
+		{
+			return std::apply([this](const Fields&... f) { return ConfigSchema(this->node, true, f...); }, this->fields);
+		}
+
+		std::string_view GetNodeName() const { return this->node; }
+
+		// Returns false if anything was wrong, with one entry per problem
+		//	appended to errors.  Fields that fail keep whatever out had.
+		bool Bind(const ConfigObject& co, S& out, std::vector<ConfigError>& errors) const
+		{
+			const size_t first_error = errors.size();
+			if (!co)
+			{
+				errors.push_back({ std::string(this->node), "", "node not found" });
+				return false;
+			}
+			if (co.GetName() != this->node)
+			{
+				errors.push_back({ std::string(this->node), "", "expected this node, found \"" + std::string(co.GetName()) + "\"" });
+			}
+
+			std::apply([&](const Fields&... f) { (this->BindField(co, f, out, errors), ...); }, this->fields);
+
+			if (this->strict)
+			{
+				for (size_t k = 0; k < co.GetAttributeCount(); ++k)
+				{
+					auto name = co.GetAttributeName(k);
+					const bool known = std::apply([name](const Fields&... f) { return ((f.name == name) || ...); }, this->fields);
+					if (!known)
+					{
+						errors.push_back({ std::string(this->node), std::string(name), "unknown attribute" });
+					}
+				}
+			}
+			return errors.size() == first_error;
+		}
+
+		// Throws ConfigFileException listing every problem
+		void BindOrThrow(const ConfigObject& co, S& out) const
+		{
+			std::vector<ConfigError> errors;
+			if (this->Bind(co, out, errors))
+			{
+				return;
+			}
+
+			std::string message;
+			for (const auto& error : errors)
+			{
+				message += (message.empty() ? "" : "\n") + error.ToString();
+			}
+			throw ConfigFileException(message, std::string(this->node), "");
+		}
+
+	private:
+		template <typename T>
+		void BindField(const ConfigObject& co, const Field<S, T>& field, S& out, std::vector<ConfigError>& errors) const
+		{
+			if (!co.HasAttribute(field.name))
+			{
+				if (field.required)
+				{
+					errors.push_back({ std::string(this->node), std::string(field.name), "missing required attribute" });
+				}
+				else
+				{
+					out.*field.member = T(field.fallback);
+				}
+				return;
+			}
+
+			auto text = co.GetAttribute(field.name);
+			T value{};
+			if (const char* problem = Parse(text, value))
+			{
+				errors.push_back({ std::string(this->node), std::string(field.name), "\"" + std::string(text) + "\" " + problem });
+				return;
+			}
+			if (!InRange(value, field.min, field.max))
+			{
+				errors.push_back({ std::string(this->node), std::string(field.name), "\"" + std::string(text) + "\" " +
+					(std::is_same_v<T, std::string> ? "length" : "is") + " not in [" + std::to_string(field.min) + ", " + std::to_string(field.max) + "]" });
+				return;
+			}
+			out.*field.member = std::move(value);
+		}
+
+		static const char* Parse(std::string_view text, bool& value)
+		{
+			if (text == "true" || text == "yes" || text == "1")
+			{
+				value = true;
+				return nullptr;
+			}
+			if (text == "false" || text == "no" || text == "0")
+			{
+				value = false;
+				return nullptr;
+			}
+			return "is not true or false";
+		}
+
+		static const char* Parse(std::string_view text, std::string& value)
+		{
+			value.assign(text.data(), text.size());
+			return nullptr;
+		}
+
+		template <typename T>
+		static const char* Parse(std::string_view text, T& value)
+		{
+			const char* end = text.data() + text.size();
+			auto result = std::from_chars(text.data(), end, value);
+			if (result.ec == std::errc::result_out_of_range)
+			{
+				return "does not fit the field";
+			}
+			if (result.ec != std::errc() || result.ptr != end)
+			{
+				return std::is_integral_v<T> ? "is not an integer" : "is not a number";
+			}
+			return nullptr;
+		}
+
+		template <typename T, typename L>
+		static bool InRange(const T& value, L min, L max)
+		{
+			if constexpr (std::is_same_v<T, std::string>)
+			{
+				return value.size() >= min && value.size() <= max;
+			}
+			else
+			{
+				return value >= min && value <= max;
+			}
+		}
+
+		std::string_view node;
+		bool strict;
+		std::tuple<Fields...> fields;
+	};
+
+	template <typename S, typename... Fields>
+	constexpr ConfigSchema<S, Fields...> MakeSchema(std::string_view node, Fields... fields)
+	{
+		return ConfigSchema<S, Fields...>(node, false, fields...);
+	}
+
+} // end namespace ConfigFile
@@ -0,0 +1,316 @@
+#include "ConfigSnapshot.h"
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace ConfigFile {
+
+	namespace {
+
+		// Bump whenever ConfigTree::Node, Attribute or the slot layout changes
+		constexpr std::uint32_t SnapshotVersion = 1;
+		constexpr char SnapshotMagic[8] = { 'C', 'F', 'G', 'T', 'R', 'E', 'E', '\0' };
+
+		struct SnapshotHeader
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t node_size;
+			std::uint32_t attribute_size;
+			std::uint32_t path_length;
+			std::uint64_t source_size;
+			std::int64_t source_mtime;
+			std::uint64_t source_hash;
+			std::uint64_t node_count;
+			std::uint64_t attribute_count;
+			std::uint64_t slot_count;
+			std::uint64_t text_size;
+		};
+
+		// Path is padded so the block after it stays 8 byte aligned
+		std::uint64_t PaddedPathLength(std::uint64_t length)
+		{
+			return (length + 7) & ~std::uint64_t(7);
+		}
+
+	}
+
+	std::string ConfigSnapshot::GetSnapshotName(const std::string& source)
+	{
+		return source + ".snapshot";
+	}
+
+	ConfigSnapshot::Stamp ConfigSnapshot::GetStamp(const std::string& source)
+	{
+		Stamp stamp = { 0, 0, 0 };
+		std::error_code ec;
+		const auto size = std::filesystem::file_size(source, ec);
+		if (ec)
+		{
+			return stamp;
+		}
+		const auto mtime = std::filesystem::last_write_time(source, ec);
+		if (ec)
+		{
+			return stamp;
+		}
+		stamp.size = static_cast<std::uint64_t>(size);
+		stamp.mtime = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+		return stamp;
+	}
+
+	std::unique_ptr<ConfigTree> ConfigSnapshot::Load(const std::string& source)
+		// Every failure here just means parsing the source the slow way
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->trace("ConfigSnapshot::Load(const std::string& source)");
+
+		const auto snapshot = GetSnapshotName(source);
+		std::error_code ec;
+		if (!std::filesystem::exists(snapshot, ec))
+		{
+			logger->debug("No snapshot for {0}", source);
+			return nullptr;
+		}
+
+		const Stamp stamp = GetStamp(source);
+		MappedFile image;
+		try
+		{
+			image = MappedFile(snapshot, MappedFile::Mode::ReadOnly);
+		}
+		catch (const std::runtime_error& e)
+		{
+			logger->warn("Cannot map snapshot {0}: {1}", snapshot, e.what());
+			return nullptr;
+		}
+
+		if (image.GetSize() < sizeof(SnapshotHeader))
+		{
+			logger->warn("Snapshot too short: {0}", snapshot);
+			return nullptr;
+		}
+
+		SnapshotHeader header;
+		std::memcpy(&header, image.GetData(), sizeof(header));
+		if (std::memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 || header.version != SnapshotVersion ||
+			header.node_size != sizeof(ConfigTree::Node) || header.attribute_size != sizeof(ConfigTree::Attribute))
+		{
+			logger->info("Snapshot from another version, ignored: {0}", snapshot);
+			return nullptr;
+		}
+
+		// Counts are checked one at a time so the sizes can't overflow
+		const std::uint64_t limit = image.GetSize();
+		if (header.path_length > limit || header.node_count == 0 || header.node_count > limit / sizeof(ConfigTree::Node) ||
+			header.attribute_count > limit / sizeof(ConfigTree::Attribute) || header.slot_count > limit / sizeof(std::uint32_t) ||
+			header.text_size > limit)
+		{
+			logger->warn("Snapshot header is damaged: {0}", snapshot);
+			return nullptr;
+		}
+
+		const std::uint64_t path_offset = sizeof(SnapshotHeader);
+		const std::uint64_t block_offset = path_offset + PaddedPathLength(header.path_length);
+		const std::uint64_t block_size = header.node_count * sizeof(ConfigTree::Node) +
+			header.attribute_count * sizeof(ConfigTree::Attribute) + header.slot_count * sizeof(std::uint32_t);
+		const std::uint64_t text_offset = block_offset + PaddedPathLength(block_size);
+		if (text_offset + header.text_size != image.GetSize())
+		{
+			logger->warn("Snapshot has the wrong size: {0}", snapshot);
+			return nullptr;
+		}
+
+		// Same source?
+		if (std::string_view(image.GetData() + path_offset, header.path_length) != source ||
+			header.source_size != stamp.size || stamp.size == 0)
+		{
+			logger->info("Snapshot is stale: {0}", snapshot);
+			return nullptr;
+		}
+		if (header.source_mtime != stamp.mtime)
+		{
+			// Touched, maybe not changed
+			std::uint64_t hash = 0;
+			try
+			{
+				MappedFile contents(source, MappedFile::Mode::ReadOnly);
+				hash = HashContents(contents.GetData(), contents.GetSize());
+			}
+			catch (const std::runtime_error& e)
+			{
+				logger->warn("Cannot map {0} to check its snapshot: {1}", source, e.what());
+				return nullptr;
+			}
+			if (hash != header.source_hash)
+			{
+				logger->info("Snapshot is stale: {0}", snapshot);
+				return nullptr;
+			}
+			logger->debug("{0} is newer than its snapshot but has the same contents", source);
+		}
+
+		const char* block = image.GetData() + block_offset;
+		const char* text = image.GetData() + text_offset;
+		std::unique_ptr<ConfigTree> tree(new ConfigTree(std::move(image), block,
+			static_cast<size_t>(header.node_count), static_cast<size_t>(header.attribute_count),
+			static_cast<size_t>(header.slot_count), text));
+
+		if (!Validate(*tree, header.text_size))
+		{
+			logger->warn("Snapshot contents are damaged: {0}", snapshot);
+			return nullptr;
+		}
+
+		logger->info("Config loaded from snapshot: {0}", snapshot);
+		logger->debug("ConfigTree mapped with {0} nodes and {1} attributes", tree->GetNodeCount(), tree->GetAttributeCount());
+		return tree;
+	}
+
+	bool ConfigSnapshot::Save(const std::string& source, const ConfigTree& tree, const Stamp& stamp)
+		// Written to a temporary file and renamed over the old snapshot, so a
+		//	crash half way never leaves a truncated snapshot behind
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->trace("ConfigSnapshot::Save(const std::string& source, const ConfigTree& tree, const Stamp& stamp)");
+
+		if (!tree.strings || stamp.size == 0)
+		{
+			logger->warn("Snapshot of {0} skipped, tree doesn't own its strings", source);
+			return false;
+		}
+
+		SnapshotHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+		header.version = SnapshotVersion;
+		header.node_size = sizeof(ConfigTree::Node);
+		header.attribute_size = sizeof(ConfigTree::Attribute);
+		header.path_length = static_cast<std::uint32_t>(source.size());
+		header.source_size = stamp.size;
+		header.source_mtime = stamp.mtime;
+		header.source_hash = stamp.hash;
+		header.node_count = tree.node_count;
+		header.attribute_count = tree.attribute_count;
+		header.slot_count = tree.slot_count;
+		header.text_size = tree.strings_size;
+
+		const char zeros[8] = { 0 };
+		const size_t block_size = tree.GetBlockSize();
+
+		const auto snapshot = GetSnapshotName(source);
+		const auto temporary = snapshot + ".tmp";
+		{
+			std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(source.data(), source.size());
+			out.write(zeros, PaddedPathLength(source.size()) - source.size());
+			out.write(reinterpret_cast<const char*>(tree.block.get()), block_size);
+			out.write(zeros, PaddedPathLength(block_size) - block_size);
+			out.write(tree.strings.get(), tree.strings_size);
+			if (!out)
+			{
+				logger->warn("Cannot write snapshot: {0}", temporary);
+				out.close();
+				std::error_code ec;
+				std::filesystem::remove(temporary, ec);
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(temporary, snapshot, ec);
+		if (ec)
+		{
+			logger->warn("Cannot replace snapshot {0}: {1}", snapshot, ec.message());
+			std::filesystem::remove(temporary, ec);
+			return false;
+		}
+
+		logger->info("Config snapshot written: {0}", snapshot);
+		return true;
+	}
+
+	std::uint64_t ConfigSnapshot::HashContents(const char* data, std::uint64_t size)
+		// FNV-1a over 8 byte words, a word at a time is plenty for change detection
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		std::uint64_t k = 0;
+		for (; k + 8 <= size; k += 8)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, data + k, sizeof(word));
+			hash = (hash ^ word) * 1099511628211ull;
+		}
+		for (; k < size; ++k)
+		{
+			hash = (hash ^ static_cast<unsigned char>(data[k])) * 1099511628211ull;
+		}
+		return (hash ^ size) * 1099511628211ull;
+	}
+
+	bool ConfigSnapshot::Validate(const ConfigTree& tree, std::uint64_t text_size)
+		// Cheap bounds checks so a damaged snapshot can't send lookups outside
+		//	the mapping or loop forever.  Children always come after their parent
+		//	(breadth first), which also rules out cycles.
+	{
+		auto in_text = [text_size](std::uint64_t offset, std::uint32_t length)
+		{
+			return offset <= text_size && length <= text_size - offset;
+		};
+
+		for (size_t k = 0; k < tree.node_count; ++k)
+		{
+			const auto& node = tree.nodes[k];
+			if (!in_text(node.name_offset, node.name_length) || !in_text(node.data_offset, node.data_length))
+			{
+				return false;
+			}
+			if (node.child_count > 0 && (node.first_child <= k || node.first_child > tree.node_count - node.child_count))
+			{
+				return false;
+			}
+			if (node.attribute_count > tree.attribute_count || node.first_attribute > tree.attribute_count - node.attribute_count)
+			{
+				return false;
+			}
+			if ((node.slot_count & (node.slot_count - 1)) != 0 || node.slot_count > tree.slot_count ||
+				node.first_slot > tree.slot_count - node.slot_count)
+			{
+				return false;
+			}
+
+			// Lookups probe until an empty slot, there has to be one
+			std::uint32_t used = 0;
+			for (std::uint32_t s = 0; s < node.slot_count; ++s)
+			{
+				used += (tree.slots[node.first_slot + s] != 0);
+			}
+			if (used != node.attribute_count || (node.slot_count > 0 && used == node.slot_count))
+			{
+				return false;
+			}
+		}
+
+		for (size_t k = 0; k < tree.attribute_count; ++k)
+		{
+			const auto& attribute = tree.attributes[k];
+			if (!in_text(attribute.name_offset, attribute.name_length) || !in_text(attribute.value_offset, attribute.value_length))
+			{
+				return false;
+			}
+		}
+
+		for (size_t k = 0; k < tree.slot_count; ++k)
+		{
+			if (tree.slots[k] > tree.attribute_count)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+} // end namespace ConfigFile
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "ConfigFileInterface.h"
+
+namespace ConfigFile {
+
+	class ConfigSnapshot
+		// Binary image of a parsed ConfigTree, kept next to its source as
+		//	"<file>.snapshot".  The block and strings of the tree are written
+		//	out as they are, so loading is one mapping and a bounds check, no
+		//	parsing and no copying.
+		//
+		//	A snapshot remembers the path, size, modification time and a hash
+		//	of the source.  It is used when path and size match and either the
+		//	time or the content hash does (a checkout touches times but not
+		//	contents), otherwise it is stale and gets rebuilt.
+	{
+	public:
+		struct Stamp
+		{
+			std::uint64_t size;
+			std::int64_t mtime;
+			std::uint64_t hash;
+		};
+
+		static std::string GetSnapshotName(const std::string& source);
+
+		// Size and time of source, zero hash.  All zero if it can't be read.
+		static Stamp GetStamp(const std::string& source);
+
+		// Tree mapped from the snapshot of source, nullptr if there is no
+		//	usable snapshot
+		static std::unique_ptr<ConfigTree> Load(const std::string& source);
+
+		// Writes the snapshot, tree must own its strings (ConfigTree::OwnStrings).
+		//	stamp must describe the text the tree was parsed from.
+		static bool Save(const std::string& source, const ConfigTree& tree, const Stamp& stamp);
+
+		static std::uint64_t HashContents(const char* data, std::uint64_t size);
+
+	private:
+		static bool Validate(const ConfigTree& tree, std::uint64_t text_size);
+	};
+
+} // end namespace ConfigFile
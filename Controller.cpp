@@ -0,0 +1,52 @@
+#include "Controller.h"
+#include "Model.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+Action::Action() : index(0) {}
+
+Action::~Action() {}
+
+void Action::Execute(Actors&) const
+{
+	// Nothing to do for the base action
+}
+
+ActionList::ActionList(std::pmr::memory_resource* resource) : m_resource(resource)
+{}
+
+ActionList::~ActionList()
+{
+	this->Clear();
+}
+
+void ActionList::Clear()
+{
+	for (size_t k = 0; k < m_actions.size(); ++k)
+	{
+		m_actions[k]->~Action();
+		m_resource->deallocate(m_actions[k], m_layouts[k].size, m_layouts[k].alignment);
+	}
+	m_actions.clear();
+	m_layouts.clear();
+}
+
+Controller::Controller() : m_pool(ActionBlockSize, ActionsPerChunk), m_actions(&m_pool)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("Controller::Controller()");
+}
+
+Controller::Controller(const Controller& cpy) :
+	m_pool(ActionBlockSize, ActionsPerChunk), m_actions(&m_pool), m_scheduler(cpy.m_scheduler)
+	// Behaviors are shared, actions of the last tick are not copied
+{
+}
+
+Controller::~Controller() {}
+
+void Controller::Control(const Actors& a, const SimulationLod* lod)
+{
+	m_actions.Clear();
+	m_scheduler.Run(a, m_actions, lod);
+}
@@ -2,8 +2,17 @@
 
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <new>
+
+#include "BehaviorScheduler.h"
+#include "FixedPool.h"
 
 class Actors;
+class SimulationLod;
 
 class Action
 {
@@ -11,6 +20,7 @@ public:
 	Action();
 	virtual ~Action();
 
+	// Whatever this changes has to be marked with Actors::MarkChanged
 	virtual void Execute(Actors& a) const;
 
 private:
@@ -18,9 +28,70 @@ private:
 
 };
 
+/// The actions of one tick, made in memory from a resource instead of
+///  one heap allocation each.  Clear destroys them and gives the memory
+///  back, the list itself keeps its capacity, so with a pool behind it a
+///  tick that makes as many actions as the last allocates nothing.
+///
+class ActionList
+{
+public:
+	explicit ActionList(std::pmr::memory_resource* resource);
+	~ActionList();
+
+	ActionList(const ActionList&) = delete;
+	ActionList& operator=(const ActionList&) = delete;
+
+	template <typename T, typename... Args>
+	T& Emplace(Args&&... args)
+	{
+		static_assert(std::is_base_of<Action, T>::value, "Only actions go in an ActionList");
+
+		// Room first, so nothing can throw once the action exists
+		if (m_actions.size() == m_actions.capacity())
+		{
+			m_actions.reserve(std::max<size_t>(16, m_actions.capacity() * 2));
+			m_layouts.reserve(m_actions.capacity());
+		}
+
+		void* p = m_resource->allocate(sizeof(T), alignof(T));
+		T* action = nullptr;
+		try
+		{
+			action = new (p) T(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			m_resource->deallocate(p, sizeof(T), alignof(T));
+			throw;
+		}
+		m_actions.push_back(action);
+		m_layouts.push_back({ sizeof(T), alignof(T) });
+		return *action;
+	}
+
+	void Clear();
+
+	size_t size() const { return m_actions.size(); }
+	bool empty() const { return m_actions.empty(); }
+	std::vector<Action*>::const_iterator begin() const { return m_actions.begin(); }
+	std::vector<Action*>::const_iterator end() const { return m_actions.end(); }
+
+private:
+	struct Layout
+	{
+		size_t size;
+		size_t alignment;
+	};
+
+	std::pmr::memory_resource* m_resource;
+	std::vector<Action*> m_actions;
+	std::vector<Layout> m_layouts;
+};
+
 /// Control base class.  Recieves events and reacts appropriately by updating
 ///  the model.  Intended to be implemented by adding behaviors (logic)
-///
+///  to the scheduler, which keeps their cost within a budget per tick.
 ///
 class Controller
 {
@@ -30,9 +101,19 @@ public:
 	virtual ~Controller();
 	//void HandleEvent(const SDL_Event& e, Model& dm) const;
 
-	void Control(const Actors& a);
+	// Replaces the actions of the last tick with those of this one
+	void Control(const Actors& a, const SimulationLod* lod = nullptr);
+	const ActionList& GetActions() const { return m_actions; }
+
+	BehaviorScheduler& GetScheduler() { return m_scheduler; }
 
 private:
-	std::vector<std::unique_ptr<Action>> m_actions;
+	// Most actions fit a block, bigger ones go to the heap
+	static constexpr size_t ActionBlockSize = 64;
+	static constexpr size_t ActionsPerChunk = 256;
+
+	FixedPool m_pool;
+	ActionList m_actions;
+	BehaviorScheduler m_scheduler;
 
 };
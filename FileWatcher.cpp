@@ -0,0 +1,219 @@
+#include "FileWatcher.h"
+#include <filesystem>
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+FileWatcher::FileWatcher(std::chrono::milliseconds poll_interval) :
+	m_notify_fd(-1), m_poll_interval(poll_interval), m_next_poll(std::chrono::steady_clock::now())
+{
+	auto logger = spdlog::get("EngineLogger");
+#ifdef __linux__
+	m_notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_notify_fd < 0)
+	{
+		logger->warn("inotify unavailable, polling watched files every {0} ms", m_poll_interval.count());
+	}
+#else
+	logger->debug("Polling watched files every {0} ms", m_poll_interval.count());
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (m_notify_fd >= 0)
+	{
+		close(m_notify_fd);
+	}
+#endif
+}
+
+void FileWatcher::Watch(const std::string& filename)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Watching file: {0}", filename);
+
+	const std::filesystem::path path(filename);
+	std::string directory = path.parent_path().string();
+	if (directory.empty())
+	{
+		directory = ".";
+	}
+	m_files[directory][path.filename().string()] = filename;
+	m_stamps[filename] = GetStamp(filename);
+
+#ifdef __linux__
+	if (m_notify_fd >= 0 && m_watch_by_directory.count(directory) == 0)
+	{
+		// Whole directory, a save through rename replaces the file's inode
+		int wd = inotify_add_watch(m_notify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0)
+		{
+			logger->warn("Cannot watch directory {0}, polling it instead", directory);
+			return;
+		}
+		m_directory_by_watch[wd] = directory;
+		m_watch_by_directory[directory] = wd;
+	}
+#endif
+}
+
+void FileWatcher::Unwatch(const std::string& filename)
+{
+	const std::filesystem::path path(filename);
+	std::string directory = path.parent_path().string();
+	if (directory.empty())
+	{
+		directory = ".";
+	}
+
+	auto dit = m_files.find(directory);
+	if (dit == m_files.end())
+	{
+		return;
+	}
+	dit->second.erase(path.filename().string());
+	m_stamps.erase(filename);
+	if (!dit->second.empty())
+	{
+		return;
+	}
+	m_files.erase(dit);
+
+#ifdef __linux__
+	auto wit = m_watch_by_directory.find(directory);
+	if (wit != m_watch_by_directory.end())
+	{
+		inotify_rm_watch(m_notify_fd, wit->second);
+		m_directory_by_watch.erase(wit->second);
+		m_watch_by_directory.erase(wit);
+	}
+#endif
+}
+
+void FileWatcher::Poll(std::vector<std::string>& changed)
+{
+	std::set<std::string> files;
+	this->PollNotify(files);
+
+	// Directories without a watch, all of them without inotify
+	auto now = std::chrono::steady_clock::now();
+	if (now >= m_next_poll)
+	{
+		m_next_poll = now + m_poll_interval;
+		this->PollStamps(files);
+	}
+
+	changed.assign(files.begin(), files.end());
+}
+
+void FileWatcher::PollNotify(std::set<std::string>& changed)
+{
+#ifdef __linux__
+	if (m_notify_fd < 0)
+	{
+		return;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		ssize_t length = read(m_notify_fd, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			// EAGAIN, nothing more queued
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < length; )
+		{
+			auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				// Lost track, assume everything watched changed
+				for (const auto& dir : m_watch_by_directory)
+				{
+					for (const auto& file : m_files[dir.first])
+					{
+						changed.insert(file.second);
+					}
+				}
+				continue;
+			}
+
+			auto dit = m_directory_by_watch.find(event->wd);
+			if (dit == m_directory_by_watch.end())
+			{
+				continue;
+			}
+			if (event->mask & IN_IGNORED)
+			{
+				// Directory went away, stat polling takes over
+				m_watch_by_directory.erase(dit->second);
+				m_directory_by_watch.erase(dit);
+				continue;
+			}
+			if (event->len == 0)
+			{
+				continue;
+			}
+
+			const auto& files = m_files[dit->second];
+			auto fit = files.find(event->name);
+			if (fit != files.end())
+			{
+				changed.insert(fit->second);
+			}
+		}
+	}
+#endif
+}
+
+void FileWatcher::PollStamps(std::set<std::string>& changed)
+{
+	for (const auto& dir : m_files)
+	{
+		if (m_watch_by_directory.count(dir.first) != 0)
+		{
+			continue;
+		}
+		for (const auto& file : dir.second)
+		{
+			auto stamp = GetStamp(file.second);
+			auto& last = m_stamps[file.second];
+			if (stamp.size != last.size || stamp.mtime != last.mtime)
+			{
+				last = stamp;
+				changed.insert(file.second);
+			}
+		}
+	}
+}
+
+FileWatcher::Stamp FileWatcher::GetStamp(const std::string& filename)
+	// Missing files read as all zeros, so they show up again once they come back
+{
+	Stamp stamp = { 0, 0 };
+	std::error_code ec;
+	const auto size = std::filesystem::file_size(filename, ec);
+	if (ec)
+	{
+		return stamp;
+	}
+	const auto mtime = std::filesystem::last_write_time(filename, ec);
+	if (ec)
+	{
+		return stamp;
+	}
+	stamp.size = static_cast<std::uint64_t>(size);
+	stamp.mtime = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+	return stamp;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include <cstdint>
+
+/// Reports files that were written since the last Poll.  On Linux the
+///  directories holding the files are watched with inotify, so Poll is one
+///  non-blocking read.  Elsewhere, or if inotify is unavailable, the files
+///  are stat'ed at most every poll interval instead.  Editors that save
+///  through a temporary file and a rename are caught either way.
+///
+class FileWatcher
+{
+public:
+	explicit FileWatcher(std::chrono::milliseconds poll_interval = std::chrono::milliseconds(250));
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	void Watch(const std::string& filename);
+	void Unwatch(const std::string& filename);
+
+	// Never blocks.  Each changed file is reported once, however many
+	//  times it was written in between.
+	void Poll(std::vector<std::string>& changed);
+
+	bool IsUsingNotify() const { return m_notify_fd >= 0; }
+
+private:
+	struct Stamp
+	{
+		std::uint64_t size;
+		std::int64_t mtime;
+	};
+
+	static Stamp GetStamp(const std::string& filename);
+	void PollNotify(std::set<std::string>& changed);
+	void PollStamps(std::set<std::string>& changed);
+
+	// File as given to Watch, by directory and name
+	std::map<std::string, std::map<std::string, std::string>> m_files;
+	std::map<std::string, Stamp> m_stamps;
+
+	int m_notify_fd;
+	std::map<int, std::string> m_directory_by_watch;
+	std::map<std::string, int> m_watch_by_directory;
+
+	std::chrono::milliseconds m_poll_interval;
+	std::chrono::steady_clock::time_point m_next_poll;
+};
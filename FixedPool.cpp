@@ -0,0 +1,89 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "FixedPool.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	constexpr size_t BlockAlignment = alignof(std::max_align_t);
+
+}
+
+FixedPool::FixedPool(size_t block_size, size_t blocks_per_chunk, std::pmr::memory_resource* upstream) :
+	m_upstream(upstream), m_block_size(0), m_blocks_per_chunk(blocks_per_chunk), m_free(nullptr), m_stats{ 0, 0, 0, 0 }
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("FixedPool::FixedPool(size_t block_size, size_t blocks_per_chunk, std::pmr::memory_resource* upstream)");
+
+	if (block_size == 0 || blocks_per_chunk == 0)
+	{
+		throw std::invalid_argument("Pool blocks and chunks can't be empty");
+	}
+
+	// Every block has to hold the free list link and stay aligned
+	m_block_size = (std::max(block_size, sizeof(FreeBlock)) + BlockAlignment - 1) & ~(BlockAlignment - 1);
+}
+
+FixedPool::~FixedPool()
+{
+	for (void* chunk : m_chunks)
+	{
+		m_upstream->deallocate(chunk, m_block_size * m_blocks_per_chunk, BlockAlignment);
+	}
+}
+
+void FixedPool::Grow()
+{
+	char* chunk = static_cast<char*>(m_upstream->allocate(m_block_size * m_blocks_per_chunk, BlockAlignment));
+	m_chunks.push_back(chunk);
+	m_stats.chunks++;
+
+	// Linked back to front, so blocks are handed out in address order
+	for (size_t k = m_blocks_per_chunk; k > 0; --k)
+	{
+		FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + (k - 1) * m_block_size);
+		block->next = m_free;
+		m_free = block;
+	}
+}
+
+void* FixedPool::do_allocate(size_t bytes, size_t alignment)
+{
+	if (bytes > m_block_size || alignment > BlockAlignment)
+	{
+		m_stats.upstream_allocations++;
+		return m_upstream->allocate(bytes, alignment);
+	}
+
+	if (m_free == nullptr)
+	{
+		this->Grow();
+	}
+	FreeBlock* block = m_free;
+	m_free = block->next;
+
+	m_stats.in_use++;
+	m_stats.high_water = std::max(m_stats.high_water, m_stats.in_use);
+	return block;
+}
+
+void FixedPool::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+	if (bytes > m_block_size || alignment > BlockAlignment)
+	{
+		m_upstream->deallocate(p, bytes, alignment);
+		return;
+	}
+
+	FreeBlock* block = static_cast<FreeBlock*>(p);
+	block->next = m_free;
+	m_free = block;
+	m_stats.in_use--;
+}
+
+bool FixedPool::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
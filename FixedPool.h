@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+
+/// Hands out blocks of one size from chunks it keeps, for objects made
+///  and destroyed over and over.  Freed blocks go on a free list and are
+///  handed out again, chunks are only returned when the pool goes, so
+///  once the pool has grown to what a tick needs it stops touching the
+///  heap.  Anything bigger than a block, or aligned more strictly, goes
+///  to upstream.
+///
+class FixedPool : public std::pmr::memory_resource
+{
+public:
+	struct Stats
+	{
+		size_t in_use;			// Blocks handed out and not yet returned
+		size_t high_water;		// Most blocks ever in use at once
+		size_t chunks;
+		size_t upstream_allocations;	// Requests the blocks didn't fit
+	};
+
+	// Throws std::invalid_argument for zero block_size or blocks_per_chunk
+	FixedPool(size_t block_size, size_t blocks_per_chunk, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+	~FixedPool();
+
+	FixedPool(const FixedPool&) = delete;
+	FixedPool& operator=(const FixedPool&) = delete;
+
+	size_t GetBlockSize() const { return m_block_size; }
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+	void Grow();
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	std::pmr::memory_resource* m_upstream;
+	size_t m_block_size;
+	size_t m_blocks_per_chunk;
+	FreeBlock* m_free;
+	std::vector<void*> m_chunks;
+
+	Stats m_stats;
+};
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "FlowField.h"
+
+namespace {
+
+	// Offsets per Direction, index 0 is Direction::None
+	const int step_x[] = { 0,  0,  1, 1, 1, 0, -1, -1, -1 };
+	const int step_y[] = { 0, -1, -1, 0, 1, 1,  1,  0, -1 };
+
+	// Straight steps cost 10, diagonals 14 (roughly 10 * sqrt(2))
+	const std::uint32_t step_weight[] = { 0, 10, 14, 10, 14, 10, 14, 10, 14 };
+
+	bool IsDiagonal(int dir) { return (dir % 2) == 0; }
+
+}
+
+FlowField::FlowField(int width, int height, int goal_x, int goal_y) :
+	m_width(width), m_height(height), m_goalx(goal_x), m_goaly(goal_y),
+	m_integration(static_cast<size_t>(width) * height, Unreachable),
+	m_direction(static_cast<size_t>(width) * height, Direction::None),
+	m_mark(static_cast<size_t>(width) * height, 0)
+{
+	if (goal_x < 0 || goal_y < 0 || goal_x >= width || goal_y >= height)
+	{
+		throw std::out_of_range("Flow field goal outside of map!");
+	}
+}
+
+void FlowField::Build(const std::vector<Cost>& costs)
+{
+	std::fill(m_integration.begin(), m_integration.end(), Unreachable);
+	std::fill(m_direction.begin(), m_direction.end(), Direction::None);
+	m_open.clear();
+
+	const int goal = m_goalx + m_goaly * m_width;
+	m_integration[goal] = 0;
+	Push(0, goal);
+
+	Propagate(costs);
+
+	// Every tile can now pick its cheapest neighbour
+	for (int cell = 0; cell < m_width * m_height; ++cell)
+	{
+		UpdateDirection(costs, cell);
+	}
+	m_touched.clear();
+}
+
+void FlowField::Update(const std::vector<Cost>& costs, int x, int y)
+{
+	this->Update(costs, x, y, 1, 1);
+}
+
+void FlowField::Update(const std::vector<Cost>& costs, int x, int y, int width, int height)
+	// Only the tiles whose route went through the rectangle can get worse, so
+	//	those are invalidated and refilled from their still valid neighbours.
+	//	If tiles got cheaper the same refill lowers everything downstream.
+{
+	const int x0 = std::max(x, 0);
+	const int y0 = std::max(y, 0);
+	const int x1 = std::min(x + width, m_width);
+	const int y1 = std::min(y + height, m_height);
+	if (x0 >= x1 || y0 >= y1)
+	{
+		return;
+	}
+	auto inside = [x0, y0, x1, y1](int px, int py) { return px >= x0 && py >= y0 && px < x1 && py < y1; };
+
+	m_open.clear();
+	m_touched.clear();
+
+	// Collect the subtree of tiles that flow into the changed tiles, or that
+	//	step diagonally past a corner of one
+	std::vector<int>& subtree = m_touched;
+	for (int cy = y0; cy < y1; ++cy)
+	{
+		for (int cx = x0; cx < x1; ++cx)
+		{
+			subtree.push_back(cx + cy * m_width);
+			m_mark[cx + cy * m_width] = 1;
+		}
+	}
+	for (int ny = y0 - 1; ny <= y1; ++ny)
+	{
+		for (int nx = x0 - 1; nx <= x1; ++nx)
+		{
+			if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height || inside(nx, ny))
+			{
+				continue;
+			}
+			const int n = nx + ny * m_width;
+			const int ndir = static_cast<int>(m_direction[n]);
+			if (ndir != 0 && IsDiagonal(ndir) && (inside(nx + step_x[ndir], ny) || inside(nx, ny + step_y[ndir])))
+			{
+				m_mark[n] = 1;
+				subtree.push_back(n);
+			}
+		}
+	}
+	for (size_t k = 0; k < subtree.size(); ++k)
+	{
+		const int cell = subtree[k];
+		const int cx = cell % m_width;
+		const int cy = cell / m_width;
+		for (int dir = 1; dir <= 8; ++dir)
+		{
+			const int nx = cx - step_x[dir];
+			const int ny = cy - step_y[dir];
+			if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height)
+			{
+				continue;
+			}
+			const int n = nx + ny * m_width;
+			if (!m_mark[n] && m_direction[n] == static_cast<Direction>(dir))
+			{
+				m_mark[n] = 1;
+				subtree.push_back(n);
+			}
+		}
+	}
+
+	const int goal = m_goalx + m_goaly * m_width;
+	for (int cell : subtree)
+	{
+		if (cell != goal)
+		{
+			m_integration[cell] = Unreachable;
+		}
+	}
+
+	// Seed the refill from the boundary of the invalidated region
+	for (int cell : subtree)
+	{
+		const int cx = cell % m_width;
+		const int cy = cell / m_width;
+		for (int dir = 1; dir <= 8; ++dir)
+		{
+			const int nx = cx + step_x[dir];
+			const int ny = cy + step_y[dir];
+			if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height)
+			{
+				continue;
+			}
+			const int n = nx + ny * m_width;
+			if (!m_mark[n] && m_integration[n] != Unreachable)
+			{
+				Push(m_integration[n], n);
+			}
+		}
+	}
+	if (inside(m_goalx, m_goaly))
+	{
+		Push(0, goal);
+	}
+
+	for (int cell : subtree)
+	{
+		m_mark[cell] = 0;
+	}
+
+	// The invalidated tiles stay in m_touched, Propagate adds every tile it lowers
+	Propagate(costs);
+
+	// Directions change for touched tiles and for anything next to them
+	const size_t num_touched = m_touched.size();
+	for (size_t k = 0; k < num_touched; ++k)
+	{
+		const int cell = m_touched[k];
+		const int cx = cell % m_width;
+		const int cy = cell / m_width;
+		for (int dir = 0; dir <= 8; ++dir)
+		{
+			const int nx = cx + step_x[dir];
+			const int ny = cy + step_y[dir];
+			if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height)
+			{
+				continue;
+			}
+			const int n = nx + ny * m_width;
+			if (!m_mark[n])
+			{
+				m_mark[n] = 1;
+				UpdateDirection(costs, n);
+			}
+		}
+	}
+	for (size_t k = 0; k < num_touched; ++k)
+	{
+		const int cell = m_touched[k];
+		const int cx = cell % m_width;
+		const int cy = cell / m_width;
+		for (int dir = 0; dir <= 8; ++dir)
+		{
+			const int nx = cx + step_x[dir];
+			const int ny = cy + step_y[dir];
+			if (nx >= 0 && ny >= 0 && nx < m_width && ny < m_height)
+			{
+				m_mark[nx + ny * m_width] = 0;
+			}
+		}
+	}
+	m_touched.clear();
+}
+
+FlowField::Direction FlowField::DirectionAt(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return Direction::None;
+	}
+	return m_direction[x + y * m_width];
+}
+
+std::tuple<int, int> FlowField::StepAt(int x, int y) const
+{
+	const int dir = static_cast<int>(DirectionAt(x, y));
+	return std::make_tuple(step_x[dir], step_y[dir]);
+}
+
+std::uint32_t FlowField::IntegrationAt(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return Unreachable;
+	}
+	return m_integration[x + y * m_width];
+}
+
+bool FlowField::IsReachable(int x, int y) const
+{
+	return IntegrationAt(x, y) != Unreachable;
+}
+
+void FlowField::Push(std::uint32_t value, int cell)
+{
+	m_open.emplace_back(value, cell);
+	std::push_heap(m_open.begin(), m_open.end(), std::greater<OpenEntry>());
+}
+
+void FlowField::Propagate(const std::vector<Cost>& costs)
+	// Dijkstra over the open list, only ever lowers integration values
+{
+	while (!m_open.empty())
+	{
+		std::pop_heap(m_open.begin(), m_open.end(), std::greater<OpenEntry>());
+		const auto [value, cell] = m_open.back();
+		m_open.pop_back();
+
+		// Stale entry, the tile was lowered again after this was pushed
+		if (value != m_integration[cell])
+		{
+			continue;
+		}
+
+		const int cx = cell % m_width;
+		const int cy = cell / m_width;
+		for (int dir = 1; dir <= 8; ++dir)
+		{
+			// Moving from the neighbour into this cell, so check it in reverse
+			const int nx = cx + step_x[dir];
+			const int ny = cy + step_y[dir];
+			if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height)
+			{
+				continue;
+			}
+			const int n = nx + ny * m_width;
+			if (costs[n] == Impassable || !CanStep(costs, cell, dir))
+			{
+				continue;
+			}
+
+			const std::uint32_t candidate = value + step_weight[dir] * costs[n];
+			if (candidate < m_integration[n])
+			{
+				m_integration[n] = candidate;
+				m_touched.push_back(n);
+				Push(candidate, n);
+			}
+		}
+	}
+}
+
+void FlowField::UpdateDirection(const std::vector<Cost>& costs, int cell)
+{
+	// Point at the neighbour the integration value actually came from, so the
+	//	direction field doubles as the dependency tree used by Update
+	Direction best = Direction::None;
+	std::uint32_t best_value = Unreachable;
+
+	if (m_integration[cell] != 0 && m_integration[cell] != Unreachable && costs[cell] != Impassable)
+	{
+		for (int dir = 1; dir <= 8; ++dir)
+		{
+			if (!CanStep(costs, cell, dir))
+			{
+				continue;
+			}
+			const int n = cell + step_x[dir] + step_y[dir] * m_width;
+			if (m_integration[n] == Unreachable)
+			{
+				continue;
+			}
+			const std::uint32_t value = m_integration[n] + step_weight[dir] * costs[cell];
+			if (value < best_value)
+			{
+				best_value = value;
+				best = static_cast<Direction>(dir);
+			}
+		}
+	}
+	m_direction[cell] = best;
+}
+
+bool FlowField::CanStep(const std::vector<Cost>& costs, int cell, int dir) const
+	// Is the step from cell in direction dir inside the map, and does a
+	//	diagonal step avoid cutting the corner of an impassable tile?
+{
+	const int cx = cell % m_width;
+	const int cy = cell / m_width;
+	const int nx = cx + step_x[dir];
+	const int ny = cy + step_y[dir];
+	if (nx < 0 || ny < 0 || nx >= m_width || ny >= m_height)
+	{
+		return false;
+	}
+	if (IsDiagonal(dir))
+	{
+		if (costs[nx + cy * m_width] == Impassable || costs[cx + ny * m_width] == Impassable)
+		{
+			return false;
+		}
+	}
+	return true;
+}
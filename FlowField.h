@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <cstdint>
+
+/// Navigation field towards a single goal tile.  The integration field
+///  holds the accumulated cost of reaching the goal from every tile, the
+///  direction field holds the neighbour to step to next.  One field is
+///  built per goal and shared by every actor heading there; an actor
+///  just looks up its (bx, by) block to find where to go.
+///
+class FlowField
+{
+public:
+	// Per-tile cost of entering a tile, Impassable tiles are never entered
+	using Cost = std::uint8_t;
+	static constexpr Cost Impassable = 255;
+
+	// Integration value of tiles that cannot reach the goal
+	static constexpr std::uint32_t Unreachable = 0xFFFFFFFF;
+
+	enum class Direction : std::uint8_t { None, N, NE, E, SE, S, SW, W, NW };
+
+	FlowField(int width, int height, int goal_x, int goal_y);
+	~FlowField() = default;
+
+	// Full rebuild, costs is a width*height grid in row major order
+	void Build(const std::vector<Cost>& costs);
+	// Incremental repair after the cost of tile (x, y) changed, or of every
+	//  tile in a rectangle
+	void Update(const std::vector<Cost>& costs, int x, int y);
+	void Update(const std::vector<Cost>& costs, int x, int y, int width, int height);
+
+	Direction DirectionAt(int x, int y) const;
+	std::tuple<int, int> StepAt(int x, int y) const;
+	std::uint32_t IntegrationAt(int x, int y) const;
+	bool IsReachable(int x, int y) const;
+
+	std::tuple<int, int> GetGoal() const { return std::make_tuple(m_goalx, m_goaly); }
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+
+private:
+	using OpenEntry = std::tuple<std::uint32_t, int>;
+
+	void Push(std::uint32_t value, int cell);
+	void Propagate(const std::vector<Cost>& costs);
+	void UpdateDirection(const std::vector<Cost>& costs, int cell);
+	bool CanStep(const std::vector<Cost>& costs, int cell, int dir) const;
+
+	int m_width;
+	int m_height;
+	int m_goalx;
+	int m_goaly;
+
+	std::vector<std::uint32_t>	m_integration;
+	std::vector<Direction>		m_direction;
+
+	// Scratch space reused between updates, so repairs don't allocate
+	std::vector<OpenEntry>		m_open;
+	std::vector<int>			m_touched;
+	std::vector<std::uint8_t>	m_mark;
+};
@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "FrameArena.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	// The block itself is allocated with this, enough for anything
+	constexpr size_t BlockAlignment = alignof(std::max_align_t);
+
+}
+
+FrameArena::FrameArena(size_t capacity, std::pmr::memory_resource* upstream) :
+	m_upstream(upstream), m_block(nullptr), m_offset(0), m_stats{ 0, 0, 0, 0, capacity, 0 },
+	m_memory(MemorySubsystem::Frame)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("FrameArena::FrameArena(size_t capacity, std::pmr::memory_resource* upstream)");
+
+	if (capacity > 0)
+	{
+		m_block = static_cast<char*>(m_upstream->allocate(capacity, BlockAlignment));
+	}
+	m_overflow.reserve(16);
+	m_memory.Set(capacity);
+}
+
+FrameArena::~FrameArena()
+{
+	this->Reset();
+	if (m_block != nullptr)
+	{
+		m_upstream->deallocate(m_block, m_stats.capacity, BlockAlignment);
+	}
+}
+
+void FrameArena::Reset()
+{
+	for (const auto& overflow : m_overflow)
+	{
+		m_upstream->deallocate(overflow.p, overflow.bytes, overflow.alignment);
+	}
+	m_overflow.clear();
+
+	// Grow between frames, never during one
+	if (m_stats.high_water > m_stats.capacity)
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Frame arena grows from {0} to {1} bytes", m_stats.capacity, m_stats.high_water);
+
+		if (m_block != nullptr)
+		{
+			m_upstream->deallocate(m_block, m_stats.capacity, BlockAlignment);
+			m_block = nullptr;
+		}
+		m_stats.capacity = m_stats.high_water;
+		m_block = static_cast<char*>(m_upstream->allocate(m_stats.capacity, BlockAlignment));
+	}
+	m_memory.Set(m_stats.capacity);
+
+	m_offset = 0;
+	m_stats.used = 0;
+	m_stats.allocations = 0;
+	m_stats.overflow_allocations = 0;
+	m_stats.overflow_bytes = 0;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+	m_stats.allocations++;
+
+	const size_t start = (m_offset + alignment - 1) & ~(alignment - 1);
+	if (m_block != nullptr && alignment <= BlockAlignment && start + bytes <= m_stats.capacity)
+	{
+		m_offset = start + bytes;
+		m_stats.used = m_offset + m_stats.overflow_bytes;
+		m_stats.high_water = std::max(m_stats.high_water, m_stats.used);
+		return m_block + start;
+	}
+
+	// Counted with room for its alignment, so the grown block takes it next time
+	void* p = m_upstream->allocate(bytes, alignment);
+	m_overflow.push_back(Overflow{ p, bytes, alignment });
+	m_stats.overflow_allocations++;
+	m_stats.overflow_bytes += bytes + alignment;
+	m_memory.Add(bytes);
+	m_stats.used = m_offset + m_stats.overflow_bytes;
+	m_stats.high_water = std::max(m_stats.high_water, m_stats.used);
+	return p;
+}
+
+void FrameArena::do_deallocate(void*, size_t, size_t)
+	// Everything goes at Reset
+{
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+
+#include "MemoryTelemetry.h"
+
+/// Bump allocator for data that only lives until the end of the frame,
+///  usable by any std::pmr container.  Deallocating does nothing, Reset
+///  takes back everything at once.
+///
+///  A frame that needs more than the block gets the rest from upstream,
+///  and the next Reset grows the block to what that frame needed, so a
+///  steady state frame never goes to the heap.
+///
+class FrameArena : public std::pmr::memory_resource
+{
+public:
+	struct Stats
+	{
+		size_t used;					// Bytes handed out this frame
+		size_t allocations;
+		size_t overflow_allocations;	// Of them, the ones that didn't fit the block
+		size_t overflow_bytes;
+		size_t capacity;
+		size_t high_water;				// Most bytes any frame needed
+	};
+
+	explicit FrameArena(size_t capacity, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// End of frame, nothing allocated since the last Reset may be used after
+	void Reset();
+
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+	struct Overflow
+	{
+		void* p;
+		size_t bytes;
+		size_t alignment;
+	};
+
+	std::pmr::memory_resource* m_upstream;
+	char* m_block;
+	size_t m_offset;
+	std::vector<Overflow> m_overflow;
+
+	Stats m_stats;
+	MemoryAccount m_memory;
+};
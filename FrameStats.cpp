@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "FrameStats.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	const char* const Names[FramePhaseCount] = { "events", "simulate", "apply", "move", "view_update", "map_draw", "effects", "present" };
+
+	unsigned int HighestBit(std::uint64_t value)
+	{
+		unsigned int bit = 0;
+		while (value >>= 1)
+		{
+			bit++;
+		}
+		return bit;
+	}
+
+}
+
+LatencyHistogram::LatencyHistogram() : m_count(0), m_max(0)
+{
+	m_counts.fill(0);
+}
+
+size_t LatencyHistogram::IndexOf(std::uint64_t value)
+	// Values below 2 * SubBuckets have a bucket each, above that every
+	//  power of two is split into SubBuckets
+{
+	value = std::min<std::uint64_t>(value, 0xffffffffu);
+	if (value < 2 * SubBuckets)
+	{
+		return static_cast<size_t>(value);
+	}
+	const unsigned int shift = HighestBit(value) - SubBucketBits;
+	const size_t sub = static_cast<size_t>(value >> shift) - SubBuckets;
+	return 2 * SubBuckets + (shift - 1) * SubBuckets + sub;
+}
+
+std::uint64_t LatencyHistogram::HighestOf(size_t index)
+{
+	if (index < 2 * SubBuckets)
+	{
+		return index;
+	}
+	const unsigned int shift = static_cast<unsigned int>((index - 2 * SubBuckets) / SubBuckets) + 1;
+	const std::uint64_t sub = (index - 2 * SubBuckets) % SubBuckets + SubBuckets;
+	return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(std::uint64_t value)
+{
+	m_counts[IndexOf(value)]++;
+	m_count++;
+	m_max = std::max(m_max, value);
+}
+
+void LatencyHistogram::Clear()
+{
+	m_counts.fill(0);
+	m_count = 0;
+	m_max = 0;
+}
+
+std::uint64_t LatencyHistogram::GetPercentile(double p) const
+{
+	if (m_count == 0)
+	{
+		return 0;
+	}
+
+	// The rank of the value wanted, counting from one
+	const double wanted = std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(m_count);
+	const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(wanted + 0.5));
+	std::uint64_t seen = 0;
+	for (size_t index = 0; index < BucketCount; ++index)
+	{
+		seen += m_counts[index];
+		if (seen >= rank)
+		{
+			return std::min(HighestOf(index), m_max);
+		}
+	}
+	return m_max;
+}
+
+void FrameStats::Track::Record(std::chrono::microseconds elapsed)
+{
+	histogram.Record(static_cast<std::uint64_t>(std::max<std::int64_t>(0, elapsed.count())));
+	if (elapsed > spike_threshold)
+	{
+		spikes++;
+	}
+}
+
+void FrameStats::Track::Roll()
+{
+	summary.count = histogram.GetCount();
+	summary.p50 = std::chrono::microseconds(histogram.GetPercentile(50.0));
+	summary.p95 = std::chrono::microseconds(histogram.GetPercentile(95.0));
+	summary.p99 = std::chrono::microseconds(histogram.GetPercentile(99.0));
+	summary.max = std::chrono::microseconds(histogram.GetMax());
+	summary.spikes = spikes;
+
+	spike_threshold = std::max(2 * summary.p50, SpikeFloor);
+	spikes = 0;
+	histogram.Clear();
+}
+
+FrameStats::FrameStats(std::chrono::milliseconds window) :
+	m_window(window), m_window_start(Clock::now()), m_frame_start(m_window_start), m_windows(0)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("FrameStats::FrameStats(std::chrono::milliseconds window)");
+}
+
+void FrameStats::BeginFrame()
+{
+	m_frame_start = Clock::now();
+	for (auto& phase : m_phases)
+	{
+		phase.this_frame = std::chrono::microseconds(0);
+	}
+}
+
+void FrameStats::Add(FramePhase phase, std::chrono::microseconds elapsed)
+{
+	m_phases[static_cast<size_t>(phase)].this_frame += elapsed;
+}
+
+bool FrameStats::EndFrame()
+{
+	const auto now = Clock::now();
+	for (auto& phase : m_phases)
+	{
+		phase.Record(phase.this_frame);
+	}
+	m_frame.Record(std::chrono::duration_cast<std::chrono::microseconds>(now - m_frame_start));
+
+	if (now - m_window_start < m_window)
+	{
+		return false;
+	}
+	for (auto& phase : m_phases)
+	{
+		phase.Roll();
+	}
+	m_frame.Roll();
+	m_window_start = now;
+	m_windows++;
+	return true;
+}
+
+const char* FrameStats::GetName(FramePhase phase)
+{
+	return Names[static_cast<size_t>(phase)];
+}
+
+const char* FrameStats::GetCsvHeader()
+{
+	return "window,phase,count,p50_us,p95_us,p99_us,max_us,spikes";
+}
+
+std::string FrameStats::ToCsv() const
+{
+	std::ostringstream csv;
+	auto row = [&](const char* name, const Summary& s)
+	{
+		csv << m_windows << ',' << name << ',' << s.count << ',' << s.p50.count() << ',' << s.p95.count() << ','
+			<< s.p99.count() << ',' << s.max.count() << ',' << s.spikes << '\n';
+	};
+	for (size_t k = 0; k < FramePhaseCount; ++k)
+	{
+		row(Names[k], m_phases[k].summary);
+	}
+	row("frame", m_frame.summary);
+	return csv.str();
+}
+
+std::string FrameStats::ToJson() const
+{
+	std::ostringstream json;
+	auto object = [&](const char* name, const Summary& s)
+	{
+		json << "\"" << name << "\":{\"count\":" << s.count << ",\"p50_us\":" << s.p50.count() << ",\"p95_us\":" << s.p95.count()
+			<< ",\"p99_us\":" << s.p99.count() << ",\"max_us\":" << s.max.count() << ",\"spikes\":" << s.spikes << "}";
+	};
+	json << "{\"window\":" << m_windows << ",\"window_ms\":" << m_window.count() << ",";
+	object("frame", m_frame.summary);
+	json << ",\"phases\":{";
+	for (size_t k = 0; k < FramePhaseCount; ++k)
+	{
+		json << ((k > 0) ? "," : "");
+		object(Names[k], m_phases[k].summary);
+	}
+	json << "}}";
+	return json.str();
+}
+
+bool FrameStats::Export(const std::string& csv_filename, const std::string& json_filename) const
+{
+	auto logger = spdlog::get("EngineLogger");
+	bool written = true;
+
+	if (!csv_filename.empty())
+	{
+		std::ofstream csv(csv_filename, std::ios::binary | std::ios::app | std::ios::ate);
+		// Opened at the end, nothing before it means a new file
+		if (csv.tellp() == 0)
+		{
+			csv << GetCsvHeader() << '\n';
+		}
+		csv << this->ToCsv();
+		if (!csv)
+		{
+			logger->error("Cannot write frame stats to {0}", csv_filename);
+			written = false;
+		}
+	}
+
+	if (!json_filename.empty())
+	{
+		std::ofstream json(json_filename, std::ios::binary | std::ios::trunc);
+		json << this->ToJson() << '\n';
+		if (!json)
+		{
+			logger->error("Cannot write frame stats to {0}", json_filename);
+			written = false;
+		}
+	}
+	return written;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+enum class FramePhase { Events, Simulate, Apply, Move, ViewUpdate, MapDraw, Effects, Present };
+constexpr size_t FramePhaseCount = 8;
+
+/// Counts of durations in microseconds, in buckets that are exact below 64
+///  and within 1/32 of the value above, like an HDR histogram.  Fixed size,
+///  recording never allocates, and anything from a microsecond to over an
+///  hour fits.
+///
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void Record(std::uint64_t value);
+	void Clear();
+
+	// Highest value of the bucket the pth percentile (0 to 100) falls in,
+	//  never more than the largest value recorded.  Zero when empty.
+	std::uint64_t GetPercentile(double p) const;
+	std::uint64_t GetMax() const { return m_max; }
+	std::uint64_t GetCount() const { return m_count; }
+
+private:
+	static constexpr unsigned int SubBucketBits = 5;
+	static constexpr size_t SubBuckets = size_t(1) << SubBucketBits;
+	static constexpr size_t BucketCount = 2 * SubBuckets + (32 - SubBucketBits - 1) * SubBuckets;
+
+	static size_t IndexOf(std::uint64_t value);
+	static std::uint64_t HighestOf(size_t index);
+
+	std::array<std::uint32_t, BucketCount> m_counts;
+	std::uint64_t m_count;
+	std::uint64_t m_max;
+};
+
+/// How long each phase of a frame takes, and the frame as a whole, over a
+///  rolling window.  Phases add up within a frame (a frame that runs two
+///  ticks simulates twice), EndFrame records the sums.  When a window is
+///  over its percentiles become the summary and it starts again, so the
+///  summary is never older than one window.
+///
+///  A spike is a sample over twice the previous window's median, and over
+///  SpikeFloor so the noise of phases that take next to nothing isn't
+///  counted.  The first window has nothing to compare with and counts none.
+///
+class FrameStats
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Summary
+	{
+		std::uint64_t count;
+		std::chrono::microseconds p50;
+		std::chrono::microseconds p95;
+		std::chrono::microseconds p99;
+		std::chrono::microseconds max;
+		std::uint64_t spikes;
+	};
+
+	// Adds the time from construction to destruction to a phase
+	class Timer
+	{
+	public:
+		Timer(FrameStats& stats, FramePhase phase) : m_stats(stats), m_phase(phase), m_start(Clock::now()) {}
+		~Timer() { m_stats.Add(m_phase, std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_start)); }
+
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+
+	private:
+		FrameStats& m_stats;
+		FramePhase m_phase;
+		Clock::time_point m_start;
+	};
+
+	static constexpr std::chrono::microseconds SpikeFloor = std::chrono::microseconds(250);
+
+	explicit FrameStats(std::chrono::milliseconds window);
+
+	void BeginFrame();
+	void Add(FramePhase phase, std::chrono::microseconds elapsed);
+
+	// True if this frame finished a window, and the summaries changed
+	bool EndFrame();
+
+	// Of the last finished window, all zeros before the first
+	const Summary& Get(FramePhase phase) const { return m_phases[static_cast<size_t>(phase)].summary; }
+	const Summary& GetFrame() const { return m_frame.summary; }
+	std::uint64_t GetWindowCount() const { return m_windows; }
+
+	static const char* GetName(FramePhase phase);
+
+	// Phase then frame, a row per phase: window,phase,count,p50_us,...
+	static const char* GetCsvHeader();
+	std::string ToCsv() const;
+	std::string ToJson() const;
+
+	// Appends to csv_filename (with a header if it is new) and replaces
+	//  json_filename, either may be empty.  False if a file can't be written.
+	bool Export(const std::string& csv_filename, const std::string& json_filename) const;
+
+private:
+	struct Track
+	{
+		LatencyHistogram histogram;
+		std::chrono::microseconds this_frame{ 0 };
+		std::chrono::microseconds spike_threshold = std::chrono::microseconds::max();
+		std::uint64_t spikes = 0;
+		Summary summary = { 0, std::chrono::microseconds(0), std::chrono::microseconds(0), std::chrono::microseconds(0), std::chrono::microseconds(0), 0 };
+
+		void Record(std::chrono::microseconds elapsed);
+		void Roll();
+	};
+
+	std::chrono::milliseconds m_window;
+	Clock::time_point m_window_start;
+	Clock::time_point m_frame_start;
+	std::uint64_t m_windows;
+
+	std::array<Track, FramePhaseCount> m_phases;
+	Track m_frame;
+};
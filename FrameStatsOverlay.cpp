@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "FrameStatsOverlay.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	struct Glyph
+	{
+		char c;
+		std::uint8_t rows[7];	// top to bottom, bit 4 is the leftmost pixel
+	};
+
+	constexpr Glyph Font[] = {
+		{ '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+		{ '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+		{ '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+		{ '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+		{ '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+		{ '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+		{ '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+		{ '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+		{ '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+		{ '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+		{ 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+		{ 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+		{ 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+		{ 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+		{ 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+		{ 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+		{ 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+		{ 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+		{ 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+		{ 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+		{ 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+		{ 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+		{ 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+		{ 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+		{ 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+		{ 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+		{ 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+		{ 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+		{ 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+		{ 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+		{ 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+		{ 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+		{ 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+		{ 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+		{ 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+		{ 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+		{ '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+		{ ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+		{ '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+		{ '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+		{ '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+	};
+	constexpr int GlyphCount = static_cast<int>(sizeof(Font) / sizeof(Font[0]));
+
+	// Text, the background behind it, and the colour key of the atlas
+	constexpr Uint32 TextColour = 0xffffffffu;
+	constexpr Uint8 Background[3] = { 0x10, 0x10, 0x10 };
+	constexpr Uint32 KeyColour = 0xffff00ffu;
+
+	double Milliseconds(std::chrono::microseconds us)
+	{
+		return us.count() / 1000.0;
+	}
+
+}
+
+FrameStatsOverlay::FrameStatsOverlay(int scale) :
+	m_scale(std::max(scale, 1)), m_atlas(nullptr), m_atlas_format(SDL_PIXELFORMAT_UNKNOWN), m_window(0)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("FrameStatsOverlay::FrameStatsOverlay(int scale)");
+
+	m_cells.fill(-1);
+	for (int k = 0; k < GlyphCount; ++k)
+	{
+		m_cells[static_cast<unsigned char>(Font[k].c)] = k;
+	}
+
+	// Nothing is known until the first window is over
+	for (auto& line : m_lines)
+	{
+		line.reserve(80);
+	}
+	m_lines[0] = "FRAME STATS - WAITING";
+}
+
+FrameStatsOverlay::~FrameStatsOverlay()
+{
+	SDL_FreeSurface(m_atlas);
+}
+
+bool FrameStatsOverlay::BuildAtlas(Uint32 format)
+	// Drawn in ARGB8888, where the pixels are easy to write, then converted
+	//  once to the format of the target
+{
+	auto logger = spdlog::get("EngineLogger");
+
+	const int cell_width = GlyphWidth * m_scale;
+	const int cell_height = GlyphHeight * m_scale;
+	SDL_Surface* drawn = SDL_CreateRGBSurfaceWithFormat(0, cell_width * GlyphCount, cell_height, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (drawn == nullptr)
+	{
+		logger->error("Cannot make the glyph atlas: {0}", SDL_GetError());
+		return false;
+	}
+
+	SDL_LockSurface(drawn);
+	for (int k = 0; k < GlyphCount; ++k)
+	{
+		for (int y = 0; y < cell_height; ++y)
+		{
+			Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(drawn->pixels) + y * drawn->pitch) + k * cell_width;
+			const std::uint8_t bits = Font[k].rows[y / m_scale];
+			for (int x = 0; x < cell_width; ++x)
+			{
+				const bool set = (bits & (0x10 >> (x / m_scale))) != 0;
+				row[x] = set ? TextColour : KeyColour;
+			}
+		}
+	}
+	SDL_UnlockSurface(drawn);
+
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat(drawn, format, 0);
+	SDL_FreeSurface(drawn);
+	if (converted == nullptr)
+	{
+		logger->error("Cannot convert the glyph atlas: {0}", SDL_GetError());
+		return false;
+	}
+	SDL_SetColorKey(converted, SDL_TRUE, SDL_MapRGB(converted->format, 0xff, 0x00, 0xff));
+	SDL_SetSurfaceRLE(converted, 1);
+
+	SDL_FreeSurface(m_atlas);
+	m_atlas = converted;
+	m_atlas_format = format;
+	logger->debug("Glyph atlas made: {0} glyphs, {1}x{2}", GlyphCount, converted->w, converted->h);
+	return true;
+}
+
+void FrameStatsOverlay::Format(const FrameStats& stats)
+	// Fixed width columns, in milliseconds
+{
+	char buffer[96];
+	std::snprintf(buffer, sizeof(buffer), "WINDOW %-6llu   P50     P95     P99     MAX  SPIKES",
+		static_cast<unsigned long long>(stats.GetWindowCount()));
+	m_lines[0] = buffer;
+
+	auto line = [&](std::string& out, const char* name, const FrameStats::Summary& s)
+	{
+		std::snprintf(buffer, sizeof(buffer), "%-12s %7.2f %7.2f %7.2f %7.2f %7llu", name, Milliseconds(s.p50), Milliseconds(s.p95),
+			Milliseconds(s.p99), Milliseconds(s.max), static_cast<unsigned long long>(s.spikes));
+		out = buffer;
+
+		// The font only has capitals
+		std::transform(out.begin(), out.end(), out.begin(), [](char c) { return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c; });
+	};
+	for (size_t k = 0; k < FramePhaseCount; ++k)
+	{
+		const auto phase = static_cast<FramePhase>(k);
+		line(m_lines[k + 1], FrameStats::GetName(phase), stats.Get(phase));
+	}
+	line(m_lines[LineCount - 1], "frame", stats.GetFrame());
+	m_window = stats.GetWindowCount();
+}
+
+void FrameStatsOverlay::DrawText(SDL_Surface* target, const std::string& text, int x, int y)
+{
+	SDL_Rect source = { 0, 0, GlyphWidth * m_scale, GlyphHeight * m_scale };
+	SDL_Rect dest = { x, y, source.w, source.h };
+	for (char c : text)
+	{
+		const int cell = (static_cast<unsigned char>(c) < m_cells.size()) ? m_cells[static_cast<unsigned char>(c)] : -1;
+		if (cell >= 0)
+		{
+			source.x = cell * source.w;
+			dest.w = source.w;
+			dest.h = source.h;
+			SDL_BlitSurface(m_atlas, &source, target, &dest);
+		}
+		dest.x += (GlyphWidth + 1) * m_scale;
+	}
+}
+
+void FrameStatsOverlay::Draw(SDL_Surface* target, const FrameStats& stats, int x, int y)
+{
+	if (target == nullptr)
+	{
+		return;
+	}
+	if ((m_atlas == nullptr || m_atlas_format != target->format->format) && !this->BuildAtlas(target->format->format))
+	{
+		return;
+	}
+	if (stats.GetWindowCount() != m_window)
+	{
+		this->Format(stats);
+	}
+
+	size_t columns = 0;
+	for (const auto& line : m_lines)
+	{
+		columns = std::max(columns, line.size());
+	}
+	const int line_height = (GlyphHeight + 2) * m_scale;
+	SDL_Rect box = { x, y, static_cast<int>(columns) * (GlyphWidth + 1) * m_scale + 2 * m_scale, static_cast<int>(LineCount) * line_height + m_scale };
+	SDL_FillRect(target, &box, SDL_MapRGB(target->format, Background[0], Background[1], Background[2]));
+
+	for (size_t k = 0; k < LineCount; ++k)
+	{
+		this->DrawText(target, m_lines[k], x + m_scale, y + m_scale + static_cast<int>(k) * line_height);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstdint>
+
+#include "SDL.h"
+#include "FrameStats.h"
+
+/// Draws the FrameStats summaries onto a surface, a line per phase.  Text
+///  comes from a built in 5 by 7 pixel font, rendered once into an atlas
+///  in the format of the surface drawn on, so every glyph is a plain
+///  colour keyed blit.  The lines are only formatted again when a window
+///  of stats is over, drawing a frame allocates nothing.
+///
+class FrameStatsOverlay
+{
+public:
+	// Glyphs are scaled up by whole pixels
+	explicit FrameStatsOverlay(int scale = 2);
+	~FrameStatsOverlay();
+
+	FrameStatsOverlay(const FrameStatsOverlay&) = delete;
+	FrameStatsOverlay& operator=(const FrameStatsOverlay&) = delete;
+
+	// Top left corner at (x, y)
+	void Draw(SDL_Surface* target, const FrameStats& stats, int x, int y);
+
+private:
+	static constexpr int GlyphWidth = 5;
+	static constexpr int GlyphHeight = 7;
+	static constexpr size_t LineCount = FramePhaseCount + 2;
+
+	// Atlas in format, made again only if the format changes
+	bool BuildAtlas(Uint32 format);
+	void Format(const FrameStats& stats);
+	void DrawText(SDL_Surface* target, const std::string& text, int x, int y);
+
+	int m_scale;
+	SDL_Surface* m_atlas;
+	Uint32 m_atlas_format;
+
+	// Atlas cell of every ASCII character, -1 for those the font lacks
+	std::array<int, 128> m_cells;
+
+	std::array<std::string, LineCount> m_lines;
+	std::uint64_t m_window;
+};
@@ -1,7 +1,8 @@
 #include <iostream>
 #include <exception>
-#include <sstream>
 #include <memory>
+#include <algorithm>
+#include <filesystem>
 
 #include "rapidxml-1.13\rapidxml_print.hpp"
 #include "SDL_image.h"
@@ -11,6 +12,15 @@
 #include "Game.h"
 #include "ImageLibrary.h"
 #include "ConfigFileInterface.h"
+#include "ConfigSchema.h"
+#include "ConfigDiff.h"
+#include "ThreadPool.h"
+#include "HotReload.h"
+#include "AssetCache.h"
+#include "InputRecorder.h"
+#include "RewindBuffer.h"
+#include "Replication.h"
+#include "MemoryTelemetry.h"
 
 class RootWindow
 {
@@ -25,37 +35,47 @@ public:
 	std::string title;
 };
 
+// Strict, so a misspelled attribute is an error rather than silently ignored
+constexpr auto RootWindowSchema = ConfigFile::MakeSchema<RootWindow>("rootwindow",
+	ConfigFile::Required("width", &RootWindow::width, 1, 16384),
+	ConfigFile::Required("height", &RootWindow::height, 1, 16384),
+	ConfigFile::Required("xpos", &RootWindow::xpos),
+	ConfigFile::Required("ypos", &RootWindow::ypos),
+	ConfigFile::Optional("title", &RootWindow::title, "")).Strict();
+
 RootWindow::RootWindow(const ConfigFile::ConfigObject& co)
 {
 	auto logger = spdlog::get("EngineLogger");
 
-	std::stringstream stream;
-	stream << co.GetAttribute("width");
-	stream >> width;
-
-	// After the extraction, "stream" state will be "eof" which is an error condition
-	// so clear it for reuse
-	stream.clear();
-	stream << co.GetAttribute("height");
-	stream >> height;
-
-	stream.clear();
-	stream << co.GetAttribute("xpos");
-	stream >> xpos;
-
-	stream.clear();
-	stream << co.GetAttribute("ypos");
-	stream >> ypos;
-
-	this->title = co.GetAttribute("title");
+	// Every problem with the node is in the one exception
+	try
+	{
+		RootWindowSchema.BindOrThrow(co, *this);
+	}
+	catch (const ConfigFile::ConfigFileException& e)
+	{
+		logger->error("Bad root window configuration:\n{0}", e.message);
+		throw;
+	}
 }
 
-Game::Game(const std::string& configfilename, bool boxymode) : cfi(configfilename), window(nullptr), running(true)
+Game::Game(const std::string& configfilename, bool boxymode, bool headless) : cfi(configfilename), window(nullptr), running(true),
+	m_particles(ParticleCapacity), m_last_update(0), m_tick(0),
+	m_frame(FrameArenaBytes), m_frame_start(AllocationStats::Get()), m_stats(FrameStatsWindow), m_show_stats(false)
 {
 	// create color multi threaded logger
 	auto logger = spdlog::get("EngineLogger");
 	logger->info("Game created with configfile: {0}", configfilename);
 
+	if (headless)
+	{
+		// Windows and surfaces still work, they just never reach a screen
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+	}
+
+	// kill -USR1 writes memory.json at the end of the next frame
+	MemoryTelemetry::InstallDumpSignal();
+
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
 	{
 		logger->error("Could not initialize SDL2! SDL_Error: {0}", SDL_GetError());
@@ -65,6 +85,22 @@ Game::Game(const std::string& configfilename, bool boxymode) : cfi(configfilenam
 	// 
 	this->SetupRootWindow();
 
+	// Prefabs are optional, a bad one stops the game like a bad root window
+	auto pf_cop = this->cfi.GetConfigObject("prefabs");
+	if (pf_cop != nullptr)
+	{
+		this->m_prefabs.Load(*pf_cop);
+	}
+
+	// Same for particle emitters
+	auto pa_cop = this->cfi.GetConfigObject("particles");
+	if (pa_cop != nullptr)
+	{
+		this->m_particles.Load(*pa_cop);
+	}
+
+	this->StartRewind();
+
 	if (boxymode)
 	{
 		// TODO FIXME temp stuff 
@@ -74,17 +110,164 @@ Game::Game(const std::string& configfilename, bool boxymode) : cfi(configfilenam
 }
 
 void Game::Run()
+	// Events are taken off the queue by the tick that handles them, so a
+	//	recording sees them on the same tick the simulation did
 {
+	const Uint64 tick_length = SDL_GetPerformanceFrequency() / TickRate;
+	Uint64 previous = SDL_GetPerformanceCounter();
+	Uint64 lag = 0;
+
+	std::vector<SDL_Event> events;
 	SDL_Event e;
 	while (this->IsRunning())
 	{
-		// Handle events on queue
-		while (SDL_PollEvent(&e) != 0)
+		this->m_stats.BeginFrame();
+		const Uint64 now = SDL_GetPerformanceCounter();
+		lag = std::min(lag + (now - previous), MaxCatchUpTicks * tick_length);
+		previous = now;
+
+		while (lag >= tick_length && this->IsRunning())
 		{
-			this->HandleEvent(e);
+			// Handle events on queue
+			events.clear();
+			while (SDL_PollEvent(&e) != 0)
+			{
+				events.push_back(e);
+			}
+			this->Tick(events);
+			lag -= tick_length;
 		}
 		this->Update();
+		this->EndFrame();
+	}
+}
+
+ActorHandle Game::Spawn(const std::string& prefab, size_t count, const SpawnGrid& grid)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Spawning {0} of {1}", count, prefab);
+
+	const Prefab* found = this->m_prefabs.Find(prefab);
+	if (found == nullptr)
+	{
+		throw std::out_of_range("No prefab called " + prefab);
+	}
+	return this->m_model.SpawnActors(*found, count, grid);
+}
+
+void Game::Record(const std::string& filename)
+{
+	this->m_recorder = std::make_unique<InputRecorder>(filename, TickRate);
+}
+
+bool Game::Replay(const std::string& filename)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("Replaying {0}", filename);
+
+	this->m_replay = std::make_unique<InputReplay>(filename);
+	InputReplay& replay = *this->m_replay;
+	if (replay.GetTickRate() != TickRate)
+	{
+		logger->warn("Recorded at {0} ticks per second, simulating at {1}", replay.GetTickRate(), TickRate);
+	}
+
+	const Uint64 start = SDL_GetPerformanceCounter();
+	std::vector<SDL_Event> events;
+	BehaviorScheduler::Decisions decisions;
+	while (this->IsRunning() && replay.NextTick(events, decisions))
+	{
+		// Behaviors decide what they did while recording, not what the clock allows now
+		this->m_stats.BeginFrame();
+		this->m_ai.GetScheduler().ForceDecisions(decisions);
+		this->Tick(events);
+		this->EndFrame();
+	}
+	const double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+	logger->info("Replayed {0} ticks in {1:.3f} s ({2:.0f} ticks per second)", replay.GetTick(), seconds,
+		(seconds > 0.0) ? replay.GetTick() / seconds : 0.0);
+	for (size_t k = 0; k < MemorySubsystemCount; ++k)
+	{
+		const auto usage = MemoryTelemetry::Get(static_cast<MemorySubsystem>(k));
+		logger->info("Memory {0}: {1} bytes, at most {2}", MemoryTelemetry::GetName(static_cast<MemorySubsystem>(k)), usage.bytes, usage.high_water);
+	}
+	const bool diverged = replay.HasDiverged();
+	if (diverged)
+	{
+		logger->error("Replay diverged from the recording on tick {0}", replay.GetDivergedTick());
+	}
+	this->m_replay.reset();
+	return !diverged;
+}
+
+bool Game::QuickSave()
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("Quick save on tick {0}", this->m_tick);
+
+	return this->m_model.Save("quicksave.actors");
+}
+
+bool Game::QuickLoad()
+	// Whatever was kept for rewinding belongs to another timeline now
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("Quick load on tick {0}", this->m_tick);
+
+	if (!this->m_model.Load("quicksave.actors"))
+	{
+		return false;
+	}
+	if (this->m_rewind)
+	{
+		this->m_rewind->Clear();
+	}
+	this->m_lod.Reset();
+	return true;
+}
+
+bool Game::Rewind(std::uint64_t ticks)
+	// The clock goes back too, the restored capture is the newest kept
+{
+	const std::uint64_t tick = (ticks < this->m_tick) ? this->m_tick - ticks : 0;
+	if (!this->m_rewind || !this->m_rewind->Rewind(tick, this->m_model.m_actors))
+	{
+		return false;
 	}
+	this->m_tick = this->m_rewind->GetStats().newest;
+	this->m_lod.Reset();
+	return true;
+}
+
+void Game::Serve(std::uint16_t port, const LinkConditions& conditions)
+{
+	this->m_client.reset();
+	this->m_server = std::make_unique<ReplicationServer>(port, conditions);
+	if (!this->m_rewind)
+	{
+		this->StartRewind();
+	}
+}
+
+void Game::Connect(const UdpAddress& server, const ReplicationInterest& interest, const LinkConditions& conditions)
+	// Whatever was simulated locally makes way for what the server sends, and a client has nothing of its own to rewind
+{
+	this->m_server.reset();
+	this->m_client = std::make_unique<ReplicationClient>(server, interest, conditions);
+	while (this->m_model.m_actors.GetLength() > 0)
+	{
+		this->m_model.m_actors.Pop();
+	}
+	this->m_rewind.reset();
+	this->m_lod.Reset();
+}
+
+void Game::StartRewind()
+	// A keyframe a second, the arena grows to what the world needs
+{
+	this->m_rewind = std::make_unique<RewindBuffer>(RewindSeconds * TickRate / RewindStride, RewindArenaLimit,
+		TickRate / RewindStride, 4096);
 }
 
 void Game::SetupRootWindow()
@@ -94,15 +277,15 @@ void Game::SetupRootWindow()
 	// Create window based on parameters stored in config file
 	// Get the root window dimensions and position
 	auto rw_cop = this->cfi.GetConfigObject("rootwindow");
-	logger->trace("Address of rootwindow pointer: {0}", static_cast<void*>(rw_cop));
+	logger->trace("Address of rootwindow pointer: {0}", static_cast<const void*>(rw_cop));
 	logger->debug("Name of object \"{0}\"", rw_cop->GetName());
 
 	auto mf_cop = this->cfi.GetConfigObject("mapfiles");
-	logger->trace("Address of mapfiles pointer: {0}", static_cast<void*>(mf_cop));
+	logger->trace("Address of mapfiles pointer: {0}", static_cast<const void*>(mf_cop));
 	logger->debug("Name of object \"{0}\"", mf_cop->GetName());
 
 	auto il_cop = this->cfi.GetConfigObject("imagelib");
-	logger->trace("Address of imagelib pointer: {0}", static_cast<void*>(il_cop));
+	logger->trace("Address of imagelib pointer: {0}", static_cast<const void*>(il_cop));
 	logger->debug("Name of object \"{0}\"", il_cop->GetName());
 
 
@@ -135,10 +318,7 @@ void Game::TempSetup()
 
 	// Set up boxy sprite
 	logger->debug("Loading sprite: {0}", "boxy.png");
-	auto loaded = IMG_Load("boxy.png");
-	auto boxy_sprite = SDL_ConvertSurface(loaded, this->GetWindowSurface()->format, NULL);
-	SDL_FreeSurface(loaded);
-	loaded = nullptr;
+	auto boxy_sprite = ImageLibrary::Decode("boxy.png", this->GetWindowSurface()->format->format);
 
 	SDL_Rect boxy_rect;
 	boxy_rect.x = 0;
@@ -158,12 +338,77 @@ void Game::TempSetup()
 	image_files.push_back("browntile.png");
 	image_files.push_back("greentile.png");
 
-	this->gmap->LoadTileImages(image_files);
+	this->m_assets = std::make_unique<AssetCache>(this->GetWindowSurface()->format->format);
+	this->m_assets->SetBudget(AssetCategory::Tiles, 64 * 1024 * 1024);
+	this->m_assets->SetBudget(AssetCategory::Sprites, 64 * 1024 * 1024);
 
-	// Doing it for the logger outputs
-	//this->gmap->LoadMap("basic_map.tmx");
+	// Baked by tools/PackAssets, anything not in it is decoded as usual
+	this->m_assets->Mount("assets.pack");
+
+	if (!this->m_particles.GetAtlasName().empty())
+	{
+		this->m_particle_atlas = this->m_assets->Acquire(this->m_particles.GetAtlasName(), AssetCategory::Sprites);
+	}
 
-	this->gmap->LoadTestMap(this->screen_rect.w / 32, this->screen_rect.h / 32);
+	this->m_pool = std::make_unique<ThreadPool>();
+	this->gmap->LoadTileImages(image_files, *this->m_assets, *this->m_pool);
+
+	// A map on disk if there is one, otherwise one made up
+	const std::string map_file("basic_map.tmx");
+	const bool map_from_file = std::filesystem::exists(map_file);
+	if (map_from_file)
+	{
+		this->gmap->LoadMap(map_file);
+		this->gmap->SetDisplaySize(this->screen_rect.w / 32, this->screen_rect.h / 32);
+	}
+	else
+	{
+		this->gmap->LoadTestMap(this->screen_rect.w / 32, this->screen_rect.h / 32);
+	}
+
+	// Edits to the tiles, the map and the root window show up without a restart
+	this->m_reload = std::make_unique<HotReload>(*this->m_pool);
+	for (size_t k = 0; k < image_files.size(); ++k)
+	{
+		this->m_reload->WatchImage(image_files[k], this->GetWindowSurface()->format->format, [this, file = image_files[k]](SDL_Surface* surface)
+		{
+			this->m_assets->Replace(file, surface);
+			this->gmap->RefreshTileImages();
+		});
+	}
+	this->m_reload->WatchConfig(this->cfi.GetFilename(), [this](const ConfigFile::ConfigFileInterface& cfi, const std::vector<ConfigFile::ConfigChange>& changes)
+	{
+		auto rw_changed = [](const ConfigFile::ConfigChange& change) { return change.Within("rootwindow[1]"); };
+		auto rw_cop = cfi.GetConfigObject("rootwindow");
+		if (rw_cop == nullptr || std::none_of(changes.begin(), changes.end(), rw_changed))
+		{
+			return;
+		}
+
+		RootWindow rw(*rw_cop);
+		this->screen_rect.w = rw.width;
+		this->screen_rect.h = rw.height;
+		SDL_SetWindowTitle(this->window, rw.title.c_str());
+		SDL_SetWindowPosition(this->window, rw.xpos, rw.ypos);
+		SDL_SetWindowSize(this->window, rw.width, rw.height);
+	});
+	if (map_from_file)
+	{
+		this->m_reload->WatchConfig(map_file, [this](const ConfigFile::ConfigFileInterface& cfi, const std::vector<ConfigFile::ConfigChange>& changes)
+		{
+			try
+			{
+				this->gmap->ReloadMap(cfi, changes);
+			}
+			catch (const std::string& e)
+			{
+				auto logger = spdlog::get("EngineLogger");
+				logger->error("Map not reloaded from {0}: {1}", cfi.GetFilename(), e);
+			}
+			// The size may have changed with the rest of the map
+			this->gmap->SetDisplaySize(this->screen_rect.w / 32, this->screen_rect.h / 32);
+		});
+	}
 }
 
 Game::~Game()
@@ -206,6 +451,10 @@ void Game::HandleEvent(SDL_Event & e)
 	{
 		this->running = false;
 	}
+	else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3)
+	{
+		this->m_show_stats = !this->m_show_stats;
+	}
 	else if (e.type == SDL_KEYDOWN)
 	{
 		m_pc.HandleEvent(e, m_model);
@@ -217,14 +466,120 @@ void Game::HandleEvent(SDL_Event & e)
 	return;
 }
 
+void Game::Tick(std::vector<SDL_Event>& events)
+	// Everything that changes the simulation happens here, never in Update
+{
+	{
+		FrameStats::Timer timer(this->m_stats, FramePhase::Events);
+		for (auto& e : events)
+		{
+			if (this->m_recorder)
+			{
+				this->m_recorder->Record(e);
+			}
+			this->HandleEvent(e);
+		}
+	}
+
+	// Behaviors decide within their budgets, then everything they asked for
+	//	happens.  Clients get it from the server instead.
+	if (this->m_client)
+	{
+		FrameStats::Timer timer(this->m_stats, FramePhase::Simulate);
+		this->FocusInterest();
+		this->m_client->Update(this->m_model.m_actors);
+	}
+	else
+	{
+		{
+			FrameStats::Timer timer(this->m_stats, FramePhase::Simulate);
+			this->FocusLod();
+			this->m_model.Simulate(this->m_ai, &this->m_lod);
+		}
+		{
+			FrameStats::Timer timer(this->m_stats, FramePhase::Apply);
+			this->m_model.Apply(this->m_ai.GetActions());
+		}
+
+		// Then what is due moves along its velocity for the ticks it owes,
+		//	stopped by solid tiles
+		FrameStats::Timer timer(this->m_stats, FramePhase::Move);
+		if (this->gmap != nullptr)
+		{
+			const int tile_size = static_cast<int>(std::get<0>(this->gmap->GetTileSize()));
+			this->m_model.Move(this->gmap->GetSolidity(), tile_size, 1.0f / TickRate, this->m_lod);
+		}
+	}
+
+	if (this->m_recorder)
+	{
+		// A client's behaviors didn't run, it has nothing to decide on replay
+		this->m_recorder->EndTick(this->m_model.m_actors,
+			this->m_client ? BehaviorScheduler::Decisions() : this->m_ai.GetScheduler().GetDecisions(), &this->m_frame);
+	}
+	if (this->m_replay)
+	{
+		// Before Notify clears what changed, the hash only looks at that
+		this->m_replay->Verify(this->m_model.m_actors, &this->m_frame);
+	}
+
+	this->m_tick++;
+	if (this->m_tick % RewindStride == 0 && this->m_rewind)
+	{
+		this->m_rewind->Capture(this->m_tick, this->m_model.m_actors);
+	}
+
+	if (this->m_server)
+	{
+		this->m_server->Update(this->m_model.m_actors);
+		if (this->m_tick % TickRate == 0)
+		{
+			auto logger = spdlog::get("EngineLogger");
+			for (const auto& client : this->m_server->GetStats())
+			{
+				logger->info("Client {0}: {1} actors, {2:.0f} bytes/s, {3} us/s", client.address.ToString(), client.actors,
+					client.bytes_per_second, client.cpu.count());
+			}
+		}
+	}
+
+	FrameStats::Timer timer(this->m_stats, FramePhase::ViewUpdate);
+	this->m_model.Notify(&this->m_frame);
+}
+
 void Game::Update()
 {
 	auto logger = spdlog::get("EngineLogger");
 	logger->info("Game::Update");
 
+	// Frame boundary, swap in whatever finished reloading
+	if (this->m_reload)
+	{
+		this->m_reload->Update();
+	}
+
 	SDL_Surface* screen = GetWindowSurface();
 	// First place the map
-	this->gmap->DrawTiles(screen);
+	{
+		FrameStats::Timer timer(this->m_stats, FramePhase::MapDraw);
+		this->gmap->DrawTiles(screen);
+	}
+
+	// Particles move with the frame time, the first frame and long stalls
+	//  take a short step instead
+	const Uint64 now = SDL_GetPerformanceCounter();
+	const float dt = (this->m_last_update == 0) ? 0.0f
+		: std::min(ParticleMaxStep, static_cast<float>(now - this->m_last_update) / SDL_GetPerformanceFrequency());
+	this->m_last_update = now;
+	{
+		FrameStats::Timer timer(this->m_stats, FramePhase::Effects);
+		this->m_particles.Update(dt);
+
+		const auto [x_offset, y_offset] = this->gmap->GetOffset();
+		const auto [tile_width, tile_height] = this->gmap->GetTileSize();
+		this->m_particles.Draw(screen, this->m_particle_atlas.Get(),
+			static_cast<float>(x_offset * static_cast<int>(tile_width)), static_cast<float>(y_offset * static_cast<int>(tile_height)));
+	}
 
 	Data& data = m_model.GetState();
 	// Find player
@@ -238,6 +593,97 @@ void Game::Update()
 
 	SDL_Rect dest_rect = player->GetPosition();
 	SDL_BlitSurface(player->GetSprite(), NULL, screen, &dest_rect);
+
+	if (this->m_show_stats)
+	{
+		this->m_overlay.Draw(screen, this->m_stats, 8, 8);
+	}
 		
+	FrameStats::Timer timer(this->m_stats, FramePhase::Present);
 	SDL_UpdateWindowSurface(this->window);
 }
+
+void Game::FocusInterest()
+	// Around the middle of the first view, as far out as Connect asked for
+{
+	if (this->m_model.m_views.empty())
+	{
+		return;
+	}
+
+	const View* view = this->m_model.m_views.front();
+	const auto [bx, by] = view->GetBlock();
+	const int size = std::max(view->GetBlockSize(), 1);
+	ReplicationInterest interest = this->m_client->GetInterest();
+	interest.bx = bx + this->screen_rect.w / size / 2;
+	interest.by = by + this->screen_rect.h / size / 2;
+	this->m_client->SetInterest(interest);
+}
+
+void Game::FocusLod()
+	// Near what the views show and what clients asked for.  Clients change
+	//	what is simulated in full, a recording made while serving only
+	//	replays the same with the same clients.
+{
+	this->m_lod.ClearFocus();
+	for (const View* view : this->m_model.m_views)
+	{
+		const auto [bx, by] = view->GetBlock();
+		const int size = std::max(view->GetBlockSize(), 1);
+		this->m_lod.AddFocus(bx, by, this->screen_rect.w / size + 1, this->screen_rect.h / size + 1);
+	}
+	if (this->m_server)
+	{
+		for (size_t k = 0; k < this->m_server->GetClientCount(); ++k)
+		{
+			const ReplicationInterest& interest = this->m_server->GetInterest(k);
+			this->m_lod.AddFocus(interest.bx - interest.radius, interest.by - interest.radius,
+				2 * interest.radius + 1, 2 * interest.radius + 1);
+		}
+	}
+	this->m_lod.Update(this->m_model.m_actors, this->m_tick);
+
+	if (this->m_tick % TickRate == 0)
+	{
+		const SimulationLod::Stats& stats = this->m_lod.GetStats();
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Simulation LOD: {0} full, {1} reduced, {2} coarse, {3} stepped this tick, {4} caught up so far",
+			stats.actors[static_cast<size_t>(LodTier::Full)], stats.actors[static_cast<size_t>(LodTier::Reduced)],
+			stats.actors[static_cast<size_t>(LodTier::Coarse)], stats.due, stats.caught_up);
+	}
+}
+
+void Game::EndFrame()
+	// Nothing the frame put in the arena may be used after this
+{
+#ifndef NDEBUG
+	const AllocationStats::Counts now = AllocationStats::Get();
+	const FrameArena::Stats& arena = this->m_frame.GetStats();
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Frame: {0} heap allocations ({1} bytes), arena {2} allocations ({3} of {4} bytes), {5} past the arena",
+		now.allocations - this->m_frame_start.allocations, now.bytes - this->m_frame_start.bytes,
+		arena.allocations, arena.used, arena.capacity, arena.overflow_allocations);
+#endif
+
+	this->m_frame.Reset();
+	this->m_frame_start = AllocationStats::Get();
+
+	if (MemoryTelemetry::TakeDumpRequest())
+	{
+		MemoryTelemetry::WriteJson("memory.json");
+	}
+
+	if (this->m_stats.EndFrame() && (!this->m_stats_csv.empty() || !this->m_stats_json.empty()))
+	{
+		this->m_stats.Export(this->m_stats_csv, this->m_stats_json);
+	}
+}
+
+void Game::ExportFrameStats(const std::string& csv_filename, const std::string& json_filename)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("Frame stats every {0} ms to {1} {2}", FrameStatsWindow.count(), csv_filename, json_filename);
+
+	this->m_stats_csv = csv_filename;
+	this->m_stats_json = json_filename;
+}
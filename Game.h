@@ -4,6 +4,8 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <chrono>
+#include <cstdint>
 
 #include "SDL.h"
 
@@ -12,23 +14,105 @@
 #include "Model.h"
 #include "View.h"
 #include "Control.h"
+#include "Controller.h"
+#include "Prefab.h"
+#include "FrameArena.h"
+#include "AllocationStats.h"
+#include "FrameStats.h"
+#include "FrameStatsOverlay.h"
+#include "ParticleSystem.h"
+#include "SimulationLod.h"
+#include "AssetCache.h"
+
+class ThreadPool;
+class HotReload;
+class InputRecorder;
+class InputReplay;
+class RewindBuffer;
+class ReplicationServer;
+class ReplicationClient;
+struct UdpAddress;
+struct LinkConditions;
+struct ReplicationInterest;
 
 class Game
 {
 public:
-	Game(const std::string& configfilename, bool boxymode);
+	// Headless games use SDL's dummy video driver, nothing is shown
+	Game(const std::string& configfilename, bool boxymode, bool headless = false);
 	~Game();
 
-	// Main game loop is here
+	// Main game loop is here, the simulation advances in fixed ticks
 	void Run();
+
+	// Saves the input of every tick Run simulates from now on
+	void Record(const std::string& filename);
+
+	// Simulates a recording as fast as possible without drawing, true if
+	//  every tick ended in the state it did when recorded
+	bool Replay(const std::string& filename);
+
+	// Every actor to and from quicksave.actors
+	bool QuickSave();
+	bool QuickLoad();
+
+	// Back to how things were ticks ago, or as close as what is kept
+	//  allows.  False if nothing that old is kept.
+	bool Rewind(std::uint64_t ticks);
+
+	// Replicates the simulation to clients that connect on port, once a
+	//  tick.  Throws std::runtime_error if the port can't be bound.
+	void Serve(std::uint16_t port, const LinkConditions& conditions);
+
+	// Shows what the server simulates instead of simulating.  Throws
+	//  std::runtime_error if no local port can be bound.
+	void Connect(const UdpAddress& server, const ReplicationInterest& interest, const LinkConditions& conditions);
+
+	// Every FrameStatsWindow, appends the frame stats to csv_filename and
+	//  replaces json_filename, either may be empty.  F3 shows them on screen.
+	void ExportFrameStats(const std::string& csv_filename, const std::string& json_filename);
+
+	static constexpr std::uint32_t TickRate = 60;
+
+	// After a stall (a slow frame, a debugger) the game drops the time it
+	//  can't catch up in MaxCatchUpTicks rather than starving the frames
+	static constexpr std::uint32_t MaxCatchUpTicks = 5;
+
+	// Rewind keeps RewindSeconds, captured every RewindStride ticks
+	static constexpr std::uint32_t RewindSeconds = 10;
+	static constexpr std::uint32_t RewindStride = 6;
+
+	// The most the rewind arena grows to, enough for a busy world
+	static constexpr size_t RewindArenaLimit = 256 * 1024 * 1024;
+
+	// Starting size of the frame arena, it grows to what a frame needs
+	static constexpr size_t FrameArenaBytes = 1024 * 1024;
+
+	static constexpr std::chrono::milliseconds FrameStatsWindow = std::chrono::milliseconds(5000);
+
+	// Live particles at most, the oldest make way for new ones past it
+	static constexpr size_t ParticleCapacity = 1 << 18;
+
+	// Particles never take a step longer than this, however long the frame
+	static constexpr float ParticleMaxStep = 0.1f;
+
 	size_t AddActor(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType at, const std::bitset<32> attrib);
+
+	// count actors of a prefab from the config, laid out on grid.  Throws
+	//  std::out_of_range for an unknown prefab.
+	ActorHandle Spawn(const std::string& prefab, size_t count, const SpawnGrid& grid);
 		
 protected:
 	void SetupRootWindow();
 	SDL_Surface* GetWindowSurface();
 	bool IsRunning();
 	void HandleEvent(SDL_Event& e);
+	void Tick(std::vector<SDL_Event>& events);
 	void Update();
+	void EndFrame();
+	void FocusLod();
+	void FocusInterest();
+	void StartRewind();
 
 private:
 
@@ -44,7 +128,47 @@ private:
 
 	Model m_model;
 	PlayerControl m_pc;
+	Controller m_ai;
 	View m_view;
+	PrefabLibrary m_prefabs;
+
+	// Images loaded from disk, declared first so it goes after its users
+	std::unique_ptr<AssetCache> m_assets;
+
+	// Effects, stepped and drawn once a frame rather than every tick
+	ParticleSystem m_particles;
+	AssetCache::Handle m_particle_atlas;
+	Uint64 m_last_update;
+
+	// Picks up edited files while running, applied between frames
+	std::unique_ptr<ThreadPool> m_pool;
+	std::unique_ptr<HotReload> m_reload;
+
+	// Only while recording, or replaying
+	std::unique_ptr<InputRecorder> m_recorder;
+	std::unique_ptr<InputReplay> m_replay;
+
+	// Ticks simulated, and the last few seconds of them
+	std::uint64_t m_tick;
+	std::unique_ptr<RewindBuffer> m_rewind;
+
+	// Actors far from every view simulate less often
+	SimulationLod m_lod;
+
+	// At most one of them, for networked games
+	std::unique_ptr<ReplicationServer> m_server;
+	std::unique_ptr<ReplicationClient> m_client;
+
+	// Scratch memory for one frame, and the heap use when it started
+	FrameArena m_frame;
+	AllocationStats::Counts m_frame_start;
+
+	// Time per phase of the frame, and where it goes when a window is over
+	FrameStats m_stats;
+	FrameStatsOverlay m_overlay;
+	bool m_show_stats;
+	std::string m_stats_csv;
+	std::string m_stats_json;
 
 	//std::map<int, std::vector<Control*>> m_eventmap;
 	//GameMap* m_gmap;
@@ -1,16 +1,44 @@
 #include "GameMap.h"
 #include <fstream>
-#include <random>
-#include <functional>
+#include <algorithm>
+#include <charconv>
+#include <limits>
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "ConfigFileInterface.h"
+#include "ConfigPath.h"
+#include "ConfigSchema.h"
+#include "ConfigDiff.h"
+#include "ThreadPool.h"
+#include "Visibility.h"
+
+struct MapHeader
+	// The parts of a TMX <map> node the engine uses, the rest is ignored
+{
+	unsigned int width;
+	unsigned int height;
+	unsigned int tile_width;
+	unsigned int tile_height;
+};
+
+// Small enough that width * height tiles still count in an int
+constexpr unsigned int MaxMapExtent = 16384;
+static_assert(static_cast<long long>(MaxMapExtent) * MaxMapExtent <= std::numeric_limits<int>::max(), "Map tiles must fit in an int");
+
+constexpr auto MapHeaderSchema = ConfigFile::MakeSchema<MapHeader>("map",
+	ConfigFile::Required("width", &MapHeader::width, 1u, MaxMapExtent),
+	ConfigFile::Required("height", &MapHeader::height, 1u, MaxMapExtent),
+	ConfigFile::Required("tilewidth", &MapHeader::tile_width, 1u, 4096u),
+	ConfigFile::Required("tileheight", &MapHeader::tile_height, 1u, 4096u));
 
 GameMap::GameMap() : 
 		x_extent(0), y_extent(0), 
 		x_offset(0), y_offset(0), 
 		tile_width(0), tile_height(0), 
-		display_width(0), display_height(0)
+		display_width(0), display_height(0),
+		fog(nullptr),
+		chunks_x(0), chunks_y(0),
+		memory(MemorySubsystem::Map)
 	{
 		// create color multi threaded logger
 		auto logger = spdlog::get("EngineLogger");
@@ -28,11 +56,6 @@ GameMap::GameMap() :
 		auto logger = spdlog::get("EngineLogger");
 		logger->trace("GameMap destroyed");
 
-		for (auto it = std::begin(tile_surf); it != std::end(tile_surf); ++it)
-		{
-			SDL_FreeSurface(*it);
-			*it = nullptr;
-		}
 		for (auto it = std::begin(deco_surf); it != std::end(deco_surf); ++it)
 		{
 			SDL_FreeSurface(*it);
@@ -51,8 +74,16 @@ GameMap::GameMap() :
 		auto logger = spdlog::get("EngineLogger");
 		logger->debug("GameMap loaded from: {0}", filename);
 
+		ConfigFile::ConfigFileInterface cfi(filename, ConfigFile::ConfigFileInterface::LoadMode::Snapshot);
+		this->LoadMap(cfi);
+	}
+
+	void GameMap::LoadMap(const ConfigFile::ConfigFileInterface& cfi)
+	{
+		auto logger = spdlog::get("EngineLogger");
+		const std::string& filename = cfi.GetFilename();
+
 		// Root object is a "map"
-		ConfigFile::ConfigFileInterface cfi(filename);
 		auto maproot = cfi.GetConfigObject("map");
 
 		if (maproot == nullptr)
@@ -61,39 +92,237 @@ GameMap::GameMap() :
 			throw std::string("No map in file");
 		}
 
-		this->x_extent = atoi(maproot->GetAttribute("width").c_str());
-		this->y_extent = atoi(maproot->GetAttribute("height").c_str());
-		logger->debug("Map with x_extent {0} and y_extent {1}", this->x_extent, this->y_extent);
+		MapHeader header;
+		std::vector<ConfigFile::ConfigError> errors;
+		if (!MapHeaderSchema.Bind(*maproot, header, errors))
+		{
+			for (const auto& error : errors)
+			{
+				logger->error("{0} in file {1}", error.ToString(), filename);
+			}
+			throw std::string("Bad map header");
+		}
+
+		logger->debug("Map with x_extent {0} and y_extent {1}", header.width, header.height);
+		logger->debug("Tiles of width {0} and height {1}", header.tile_width, header.tile_height);
 
-		this->tile_width = atoi(maproot->GetAttribute("tilewidth").c_str());
-		this->tile_height = atoi(maproot->GetAttribute("tileheight").c_str());
-		logger->debug("Tiles of width {0} and height {1}", this->tile_width, this->tile_height);
+		// TMX layers in order: tiles, decorators, overlay.  Everything is read
+		//	before the map changes, so a bad file leaves the map as it was.
+		IndexArray layers[] = { IndexArray(header.width, header.height), IndexArray(header.width, header.height),
+			IndexArray(header.width, header.height) };
 
-		for (auto e : maproot->GetChildren())
+		const auto& csv_data = cfi.CompilePath("data[@encoding='csv']");
+		size_t num_layers = 0;
+		for (const auto& layer : cfi.Query("map/layer"))
 		{
-			logger->info("Map child with name \"{0}\"", e.GetName());
+			logger->info("Map layer with name \"{0}\"", layer.GetAttribute("name"));
+			if (num_layers == 3)
+			{
+				logger->warn("Only three layers supported, ignoring the rest");
+				break;
+			}
+
+			auto data = csv_data.SelectFirst(layer);
+			if (!data)
+			{
+				logger->error("Layer without csv data in file {0}", filename);
+				throw std::string("Unsupported layer encoding");
+			}
+			this->ReadLayer(data.GetData(), header.width, header.height, layers[num_layers++]);
 		}
+
+		this->x_extent = header.width;
+		this->y_extent = header.height;
+		this->tile_width = header.tile_width;
+		this->tile_height = header.tile_height;
+		this->tile_indices = std::move(layers[0]);
+		this->deco_indices = std::move(layers[1]);
+		this->over_indices = std::move(layers[2]);
+
+		// Not procedural, everything is there already
+		this->generator.reset();
+		this->chunk_ready.clear();
+		this->chunks_x = this->chunks_y = 0;
+
+		this->flow_fields.clear();
+		this->RebuildCostGrid();
+		this->Account();
 		
 		return;
 	}
 
-	
-	void GameMap::LoadTileImages(std::vector<std::string> image_files)
-		// Recieve a map from TileIndex to filename
+	void GameMap::ReadLayer(std::string_view csv, unsigned int width, unsigned int height, IndexArray& indices)
+		// TMX global tile ids count from 1, 0 means nothing there
+	{
+		const char* p = csv.data();
+		const char* end = p + csv.size();
+
+		for (unsigned int k = 0; k < width * height; ++k)
+		{
+			while (p < end && (*p == ',' || *p == ' ' || *p == '\r' || *p == '\n' || *p == '\t'))
+			{
+				++p;
+			}
+
+			unsigned int gid = 0;
+			auto result = std::from_chars(p, end, gid);
+			if (result.ec != std::errc())
+			{
+				auto logger = spdlog::get("EngineLogger");
+				logger->error("Layer data ends after {0} of {1} tiles", k, width * height);
+				throw std::string("Bad layer data");
+			}
+			p = result.ptr;
+
+			// Top bits are TMX flip flags, not supported yet
+			gid &= 0x1FFFFFFF;
+			indices.Set(k % width, k / width, static_cast<TileIndex>(gid) - 1);
+		}
+	}
+
+	void GameMap::ReloadMap(const ConfigFile::ConfigFileInterface& cfi, const std::vector<ConfigFile::ConfigChange>& changes)
+		// Layer data is swapped in place.  Anything else, the size of the map
+		//	or its tiles, or layers coming and going, loads the whole map again.
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("GameMap reloading from: {0}", cfi.GetFilename());
+
+		const char* const layer_paths[] = { "map[1]/layer[1]", "map[1]/layer[2]", "map[1]/layer[3]" };
+		bool changed[3] = { false, false, false };
+		for (const auto& change : changes)
+		{
+			bool in_layer = false;
+			for (size_t k = 0; k < 3; ++k)
+			{
+				if (change.Within(layer_paths[k]) && (change.kind == ConfigFile::ConfigChange::Kind::Changed || change.path != layer_paths[k]))
+				{
+					changed[k] = in_layer = true;
+				}
+			}
+			if (!in_layer)
+			{
+				logger->info("Map structure changed at \"{0}\", reloading all of it", change.path);
+				this->LoadMap(cfi);
+				for (auto vm : this->visibility)
+				{
+					vm->InvalidateAll();
+				}
+				return;
+			}
+		}
+
+		// Read everything first, bad data leaves the map as it was
+		auto layers = cfi.Query("map/layer");
+		const auto& csv_data = cfi.CompilePath("data[@encoding='csv']");
+		IndexArray read[3];
+		for (size_t k = 0; k < 3; ++k)
+		{
+			if (!changed[k])
+			{
+				continue;
+			}
+			auto data = csv_data.SelectFirst(layers[k]);
+			if (!data)
+			{
+				logger->error("Layer without csv data in file {0}", cfi.GetFilename());
+				throw std::string("Unsupported layer encoding");
+			}
+			read[k] = IndexArray(this->x_extent, this->y_extent);
+			this->ReadLayer(data.GetData(), this->x_extent, this->y_extent, read[k]);
+		}
+
+		if (changed[0])
+		{
+			this->SwapTileLayer(read[0]);
+		}
+		if (changed[1])
+		{
+			this->deco_indices = std::move(read[1]);
+		}
+		if (changed[2])
+		{
+			this->over_indices = std::move(read[2]);
+		}
+		this->Account();
+		logger->info("Map layers reloaded: {0} {1} {2}", changed[0], changed[1], changed[2]);
+	}
+
+	void GameMap::SwapTileLayer(IndexArray& indices)
+		// A few tiles go through SetTile so flow fields and visibility are
+		//	repaired rather than rebuilt, a lot of them rebuild everything
+	{
+		std::vector<std::tuple<int, int>> different;
+		for (unsigned int y = 0; y < this->y_extent; ++y)
+		{
+			const TileIndex* before = this->tile_indices.PointAt(0, y);
+			const TileIndex* after = indices.PointAt(0, y);
+			for (unsigned int x = 0; x < this->x_extent; ++x)
+			{
+				if (before[x] != after[x])
+				{
+					different.emplace_back(x, y);
+				}
+			}
+		}
+
+		if (different.size() <= static_cast<size_t>(this->x_extent) * this->y_extent / 16)
+		{
+			for (const auto& xy : different)
+			{
+				this->SetTile(std::get<0>(xy), std::get<1>(xy), indices.At(std::get<0>(xy), std::get<1>(xy)));
+			}
+			return;
+		}
+
+		this->tile_indices = std::move(indices);
+		this->RebuildCostGrid();
+		for (auto& ff : this->flow_fields)
+		{
+			ff.second->Build(this->cost_grid);
+		}
+		for (auto vm : this->visibility)
+		{
+			vm->InvalidateAll();
+		}
+	}
+
+	void GameMap::RefreshTileImages()
+		// The handles stay the same when the cache swaps pixels, only the
+		//	surface pointers they give out change
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Tile images refreshed");
+
+		for (size_t k = 0; k < this->tile_images.size(); ++k)
+		{
+			this->tile_surf[k] = this->tile_images[k].Get();
+		}
+	}
+
+	void GameMap::LoadTileImages(const std::vector<std::string>& image_files, AssetCache& cache, ThreadPool& pool)
+		// Recieve a map from TileIndex to filename.  Tiles that aren't cached
+		//	yet are decoded in parallel and converted to the display format up
+		//	front, so drawing them is a straight copy.
 	{
 		// create color multi threaded logger
 		auto logger = spdlog::get("EngineLogger");
-		logger->trace("GameMap::LoadTileImages(std::map<TileIndex, std::string> image_files)");
+		logger->trace("GameMap::LoadTileImages(const std::vector<std::string>& image_files, AssetCache& cache, ThreadPool& pool)");
 
 		// Store as a map from TileIndex to SDL_Surface*
 		logger->debug("Convert vector from filenames to surface pointers");
-		for (auto it = std::begin(image_files); it != std::end(image_files); ++it)
+		const size_t first = this->tile_images.size();
+		for (auto& handle : cache.AcquireAll(image_files, AssetCategory::Tiles, pool))
 		{
-			logger->debug("Filename: {0}", *it);
-			SDL_Surface* p = IMG_Load(it->c_str());
-			this->tile_surf.push_back(p);
+			this->tile_images.push_back(std::move(handle));
+		}
+		this->tile_surf.resize(this->tile_images.size(), nullptr);
+		this->RefreshTileImages();
+		this->Account();
 
-			logger->debug("Pointer: {0}", static_cast<void*>(p));
+		for (size_t k = 0; k < image_files.size(); ++k)
+		{
+			logger->debug("Filename: {0}", image_files[k]);
+			logger->debug("Pointer: {0}", static_cast<void*>(this->tile_surf[first + k]));
 		}
 	}
 
@@ -115,54 +344,180 @@ GameMap::GameMap() :
 		auto logger = spdlog::get("EngineLogger");
 		logger->debug("Creating test map of size: {0},{1}", nx, ny);
 		
-		this->x_extent = nx;
-		this->y_extent = ny;
+		if (this->tile_surf.size() == 0)
+		{
+			throw std::exception("No tiles loaded, cannot construct test map");
+		}
+		logger->debug("Number of tile surfaces: {0}", this->tile_surf.size());
+
+		// One octave sampled once per tile lands exactly on the noise lattice,
+		//	so the heights are white noise and every tile is equally likely
+		auto generator = std::make_shared<MapGenerator>(0);
+		generator->SetNoise(1, 1.0f, 0.5f);
+		const auto num_tiles = this->tile_surf.size();
+		for (size_t k = 0; k < num_tiles; ++k)
+		{
+			generator->AddBiome(static_cast<float>(k + 1) / num_tiles, static_cast<TileIndex>(k));
+		}
+
+		this->SetGenerator(generator, nx, ny);
 		this->display_width  = nx;
 		this->display_height = ny;
 		this->tile_height = 32;
 		this->tile_width  = 32;
 
+		ThreadPool pool;
+		this->GenerateAll(pool);
+	}
+
+	void GameMap::SetGenerator(std::shared_ptr<const MapGenerator> generator, unsigned int nx, unsigned int ny)
+		// Sets up empty layers, nothing is generated until asked for
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Procedural map of size {0},{1} with seed {2}", nx, ny, generator->GetSeed());
+
+		this->generator = std::move(generator);
+		this->x_extent = nx;
+		this->y_extent = ny;
+
 		this->tile_indices = IndexArray(nx, ny);
 		this->deco_indices = IndexArray(nx, ny);
 		this->over_indices = IndexArray(nx, ny);
-		
-		if (this->tile_surf.size() == 0)
+
+		this->chunks_x = (nx + MapGenerator::ChunkSize - 1) / MapGenerator::ChunkSize;
+		this->chunks_y = (ny + MapGenerator::ChunkSize - 1) / MapGenerator::ChunkSize;
+		this->chunk_ready.assign(static_cast<size_t>(this->chunks_x) * this->chunks_y, 0);
+
+		// Any flow fields were for the old map
+		this->flow_fields.clear();
+		this->cost_grid.assign(static_cast<size_t>(nx) * ny, 1);
+		this->solidity = SolidityMap(nx, ny);
+		this->opacity = SolidityMap(nx, ny);
+		this->Account();
+	}
+
+	void GameMap::Account()
+	{
+		size_t bytes = this->tile_indices.GetByteCount() + this->deco_indices.GetByteCount() + this->over_indices.GetByteCount();
+		bytes += (this->tile_cost.capacity() + this->cost_grid.capacity()) * sizeof(FlowField::Cost);
+		bytes += this->tile_opaque.capacity() + this->chunk_ready.capacity();
+		for (const SolidityMap* map : { &this->solidity, &this->opacity })
 		{
-			throw std::exception("No tiles loaded, cannot construct test map");
+			bytes += (static_cast<size_t>(map->GetWidth()) * map->GetHeight() + 63) / 64 * sizeof(std::uint64_t);
 		}
 
-		std::default_random_engine generator;
-		std::uniform_int_distribution<int> distribution(0, this->tile_surf.size()-1);
-		logger->debug("Number of tile surfaces: {0}", this->tile_surf.size());
-		auto dice = std::bind(distribution, generator);
+		bytes += this->tile_images.capacity() * sizeof(AssetCache::Handle);
+		bytes += (this->tile_surf.capacity() + this->deco_surf.capacity() + this->over_surf.capacity()) * sizeof(SDL_Surface*);
+		for (const auto* surfaces : { &this->deco_surf, &this->over_surf })
+		{
+			for (const SDL_Surface* surface : *surfaces)
+			{
+				bytes += (surface != nullptr) ? AssetCache::SurfaceBytes(surface) : 0;
+			}
+		}
+		this->memory.Set(bytes);
+	}
 
-		for (unsigned int y = 0; y < ny; ++y)
+	void GameMap::GenerateAll(ThreadPool& pool)
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Generating {0} chunks on {1} threads", this->chunk_ready.size(), pool.GetSize() + 1);
+
+		// Chunks own whole words of the solidity map, so they can't collide
+		pool.ParallelFor(this->chunk_ready.size(), [this](size_t k)
 		{
-			for (unsigned int x = 0; x < nx; ++x)
+			if (!this->chunk_ready[k])
 			{
-				this->tile_indices.Set(x, y, dice());
+				this->FillChunk(static_cast<int>(k % this->chunks_x), static_cast<int>(k / this->chunks_x));
 			}
-			logger->trace("At location {0},{1}, index = {2}", 0, y, tile_indices.At(0, y));
+		});
+
+		for (auto& ff : this->flow_fields)
+		{
+			ff.second->Build(this->cost_grid);
 		}
-		
+	}
+
+	void GameMap::GenerateChunk(int cx, int cy)
+	{
+		if (!this->generator || cx < 0 || cy < 0 || cx >= this->chunks_x || cy >= this->chunks_y)
+		{
+			return;
+		}
+		if (this->chunk_ready[cx + cy * this->chunks_x])
+		{
+			return;
+		}
+
+		auto logger = spdlog::get("EngineLogger");
+		logger->trace("Generating chunk {0},{1} on demand", cx, cy);
+
+		this->FillChunk(cx, cy);
+
+		// Only routes through the chunk change, the rest of each field stays
+		for (auto& ff : this->flow_fields)
+		{
+			ff.second->Update(this->cost_grid, cx * MapGenerator::ChunkSize, cy * MapGenerator::ChunkSize,
+				MapGenerator::ChunkSize, MapGenerator::ChunkSize);
+		}
+	}
+
+	void GameMap::GenerateRegion(int x, int y, int width, int height)
+		// Makes sure every chunk overlapping the tile rectangle exists
+	{
+		if (!this->generator)
+		{
+			return;
+		}
+
+		const int cx0 = std::max(x, 0) / MapGenerator::ChunkSize;
+		const int cy0 = std::max(y, 0) / MapGenerator::ChunkSize;
+		const int cx1 = std::min((x + width - 1) / MapGenerator::ChunkSize, this->chunks_x - 1);
+		const int cy1 = std::min((y + height - 1) / MapGenerator::ChunkSize, this->chunks_y - 1);
+
+		for (int cy = cy0; cy <= cy1; ++cy)
+		{
+			for (int cx = cx0; cx <= cx1; ++cx)
+			{
+				this->GenerateChunk(cx, cy);
+			}
+		}
+	}
+
+	void GameMap::FillChunk(int cx, int cy)
+	{
+		const int stride = this->tile_indices.GetStride();
+		this->generator->GenerateChunk(cx, cy, this->x_extent, this->y_extent, stride,
+			this->tile_indices.PointAt(0, 0), this->deco_indices.PointAt(0, 0), this->over_indices.PointAt(0, 0));
+
+		const unsigned int x0 = cx * MapGenerator::ChunkSize;
+		const unsigned int y0 = cy * MapGenerator::ChunkSize;
+		this->UpdateCostGrid(x0, y0,
+			std::min(x0 + MapGenerator::ChunkSize, this->x_extent),
+			std::min(y0 + MapGenerator::ChunkSize, this->y_extent));
+
+		this->chunk_ready[cx + cy * this->chunks_x] = 1;
 	}
 
 	void GameMap::DrawTiles(SDL_Surface * surf)
 	{
+		this->GenerateRegion(this->x_offset, this->y_offset, this->display_width, this->display_height);
 		this->Draw(surf, this->tile_indices, this->tile_surf);
 	}
 
 	void GameMap::DrawOverlay(SDL_Surface * surf)
 	{
+		this->GenerateRegion(this->x_offset, this->y_offset, this->display_width, this->display_height);
 		this->Draw(surf, this->over_indices, this->over_surf);
 	}
 
 	void GameMap::DrawDecorators(SDL_Surface * surf)
 	{
+		this->GenerateRegion(this->x_offset, this->y_offset, this->display_width, this->display_height);
 		this->Draw(surf, this->deco_indices, this->deco_surf);
 	}
 
-	void GameMap::Draw(SDL_Surface* surf, GameMap::IndexArray indices, std::vector<SDL_Surface*> surfaces)
+	void GameMap::Draw(SDL_Surface* surf, const GameMap::IndexArray& indices, const std::vector<SDL_Surface*>& surfaces)
 	{
 		SDL_Rect source;
 		source.x = 0; source.y = 0; source.w = this->tile_width; source.h = this->tile_height;
@@ -184,6 +539,11 @@ GameMap::GameMap() :
 
 				// The tile index is relative (uses offset)
 				tileindex = indices.At(kx + this->x_offset, ky + this->y_offset);
+				if (tileindex < 0 || (this->fog && !this->fog->IsExplored(kx + this->x_offset, ky + this->y_offset)))
+				{
+					// Nothing placed here (MapGenerator::NoTile), or not explored yet
+					continue;
+				}
 				SDL_BlitSurface(surfaces[tileindex], &source, surf, &dest);
 
 				//std::cerr << "Any errors?  " << SDL_GetError() << std::endl;
@@ -191,6 +551,14 @@ GameMap::GameMap() :
 		}
 	}
 
+	void GameMap::SetDisplaySize(unsigned int nx, unsigned int ny)
+		// No bigger than the map, the offset is clipped again to suit
+	{
+		this->display_width = std::min(nx, this->x_extent);
+		this->display_height = std::min(ny, this->y_extent);
+		this->SetOffset(this->x_offset, this->y_offset);
+	}
+
 	void GameMap::SetOffset(int off_x, int off_y)
 	{
 		// Make sure offset won't move us past the edges of the map
@@ -239,10 +607,176 @@ GameMap::GameMap() :
 		this->SetOffset(new_x_offset, new_y_offset);
 	}
 
+	std::tuple<int, int> GameMap::GetOffset() const
+	{
+		return std::make_tuple(this->x_offset, this->y_offset);
+	}
+
+	std::tuple<unsigned int, unsigned int> GameMap::GetTileSize() const
+	{
+		return std::make_tuple(this->tile_width, this->tile_height);
+	}
+
+	void GameMap::SetTile(int x, int y, TileIndex index)
+		// Tiles outside of the map are left alone, like SolidityMap does
+	{
+		if (x < 0 || y < 0 || static_cast<unsigned int>(x) >= this->x_extent || static_cast<unsigned int>(y) >= this->y_extent)
+		{
+			auto logger = spdlog::get("EngineLogger");
+			logger->warn("Tile {0},{1} is outside of the map, not set", x, y);
+			return;
+		}
+
+		this->tile_indices.Set(x, y, index);
+
+		bool opaque = (static_cast<size_t>(index) < this->tile_opaque.size()) && this->tile_opaque[index];
+		if (opaque != this->opacity.IsSolid(x, y))
+		{
+			this->opacity.Set(x, y, opaque);
+			for (auto vm : this->visibility)
+			{
+				vm->InvalidateTile(x, y);
+			}
+		}
+
+		FlowField::Cost cost = (static_cast<size_t>(index) < this->tile_cost.size()) ? this->tile_cost[index] : 1;
+		auto& grid_cost = this->cost_grid[x + y * this->x_extent];
+		if (grid_cost == cost)
+		{
+			return;
+		}
+		grid_cost = cost;
+		this->solidity.Set(x, y, cost == FlowField::Impassable);
+
+		// Repair every cached field rather than rebuilding it
+		for (auto& ff : this->flow_fields)
+		{
+			ff.second->Update(this->cost_grid, x, y);
+		}
+	}
+
+	void GameMap::SetTileCost(TileIndex index, FlowField::Cost cost)
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Tile index {0} given traversal cost {1}", index, cost);
+
+		if (static_cast<size_t>(index) >= this->tile_cost.size())
+		{
+			this->tile_cost.resize(index + 1, 1);
+		}
+		this->tile_cost[index] = cost;
+
+		// Potentially every tile changed, so rebuild the fields from scratch
+		this->RebuildCostGrid();
+		for (auto& ff : this->flow_fields)
+		{
+			ff.second->Build(this->cost_grid);
+		}
+	}
+
+	void GameMap::SetTileOpaque(TileIndex index, bool opaque)
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Tile index {0} opaque: {1}", index, opaque);
+
+		if (static_cast<size_t>(index) >= this->tile_opaque.size())
+		{
+			this->tile_opaque.resize(index + 1, 0);
+		}
+		this->tile_opaque[index] = opaque;
+
+		// Tiles flip all over the map, let every source recast
+		this->RebuildCostGrid();
+		for (auto vm : this->visibility)
+		{
+			vm->InvalidateAll();
+		}
+	}
+
+	void GameMap::AttachVisibility(VisibilityMap* vm)
+	{
+		this->visibility.push_back(vm);
+	}
+
+	void GameMap::DetachVisibility(VisibilityMap* vm)
+	{
+		auto i = std::find(this->visibility.begin(), this->visibility.end(), vm);
+		if (i != this->visibility.end())
+		{
+			this->visibility.erase(i);
+		}
+	}
+
+	void GameMap::SetFog(const VisibilityMap* fog)
+	{
+		this->fog = fog;
+	}
+
+	std::shared_ptr<const FlowField> GameMap::GetFlowField(int goal_x, int goal_y)
+		// Returns a flow field shared with everyone else heading to the same goal.
+		//	Fields stay cached (and updated) until ReleaseFlowFields is called
+		//	while nobody else holds on to them.
+	{
+		auto key = std::make_tuple(goal_x, goal_y);
+		auto ffit = this->flow_fields.find(key);
+		if (ffit != this->flow_fields.end())
+		{
+			return ffit->second;
+		}
+
+		auto logger = spdlog::get("EngineLogger");
+		logger->debug("Building flow field for goal: {0},{1}", goal_x, goal_y);
+
+		auto ff = std::make_shared<FlowField>(this->x_extent, this->y_extent, goal_x, goal_y);
+		ff->Build(this->cost_grid);
+		this->flow_fields.emplace(key, ff);
+
+		return ff;
+	}
+
+	void GameMap::ReleaseFlowFields()
+	{
+		for (auto ffit = this->flow_fields.begin(); ffit != this->flow_fields.end(); )
+		{
+			if (ffit->second.use_count() == 1)
+			{
+				ffit = this->flow_fields.erase(ffit);
+			}
+			else
+			{
+				++ffit;
+			}
+		}
+	}
+
+	void GameMap::RebuildCostGrid()
+	{
+		this->cost_grid.assign(static_cast<size_t>(this->x_extent) * this->y_extent, 1);
+		this->solidity = SolidityMap(this->x_extent, this->y_extent);
+		this->opacity = SolidityMap(this->x_extent, this->y_extent);
+		this->UpdateCostGrid(0, 0, this->x_extent, this->y_extent);
+	}
+
+	void GameMap::UpdateCostGrid(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+		// Refreshes costs and solidity of the tiles in [x0, x1) x [y0, y1)
+	{
+		for (unsigned int y = y0; y < y1; ++y)
+		{
+			const TileIndex* row = this->tile_indices.PointAt(0, y);
+			for (unsigned int x = x0; x < x1; ++x)
+			{
+				FlowField::Cost cost = (static_cast<size_t>(row[x]) < this->tile_cost.size()) ? this->tile_cost[row[x]] : 1;
+				this->cost_grid[x + y * this->x_extent] = cost;
+				this->solidity.Set(x, y, cost == FlowField::Impassable);
+				this->opacity.Set(x, y, (static_cast<size_t>(row[x]) < this->tile_opaque.size()) && this->tile_opaque[row[x]]);
+			}
+		}
+	}
+
 	GameMap::IndexArray::IndexArray() : stride(0), vec()
 	{}
 
-	GameMap::IndexArray::IndexArray(const int width, const int height): stride(width), vec(width*height, 0)
+	GameMap::IndexArray::IndexArray(const int width, const int height): stride(width), vec(static_cast<size_t>(width) * height, 0)
 	{
 		// create color multi threaded logger
 		auto logger = spdlog::get("EngineLogger");
@@ -269,6 +803,12 @@ GameMap::GameMap() :
 	}
 
 	const GameMap::TileIndex* GameMap::IndexArray::PointAt(const int x, const int y) const
+	{
+		auto dp = this->vec.data() + (x + y * stride);
+		return dp;
+	}
+
+	GameMap::TileIndex* GameMap::IndexArray::PointAt(const int x, const int y)
 	{
 		auto dp = this->vec.data() + (x + y * stride);
 		return dp;
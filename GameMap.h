@@ -3,9 +3,24 @@
 #include "SDL.h"
 #include "SDL_image.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <tuple>
+#include <memory>
+
+#include "FlowField.h"
+#include "TileCollision.h"
+#include "MapGenerator.h"
+#include "AssetCache.h"
+#include "MemoryTelemetry.h"
+
+class ThreadPool;
+class VisibilityMap;
+namespace ConfigFile {
+	class ConfigFileInterface;
+	struct ConfigChange;
+}
 
 	class GameMap
 	{
@@ -22,9 +37,22 @@
 		// Functions for setting up and changing maps
 		//  can be slow
 		void LoadMap(const std::string& filename);
-		void LoadTileImages(std::vector<std::string> image_files);
+		void LoadTileImages(const std::vector<std::string>& image_files, AssetCache& cache, ThreadPool& pool);
 		void LoadTileImages(std::string filename);
 		void LoadTestMap(unsigned int nx, unsigned int ny);
+		void SetDisplaySize(unsigned int nx, unsigned int ny);
+
+		// Functions for hot reloading, only layers that changed are swapped in.
+		//  Call RefreshTileImages after the AssetCache replaced a tile image.
+		void ReloadMap(const ConfigFile::ConfigFileInterface& cfi, const std::vector<ConfigFile::ConfigChange>& changes);
+		void RefreshTileImages();
+
+		// Functions for procedural maps, chunks not generated up front are
+		//  generated on demand once they come into view
+		void SetGenerator(std::shared_ptr<const MapGenerator> generator, unsigned int nx, unsigned int ny);
+		void GenerateAll(ThreadPool& pool);
+		void GenerateChunk(int cx, int cy);
+		void GenerateRegion(int x, int y, int width, int height);
 
 		// Functions for drawing during operation
 		void DrawTiles(SDL_Surface* surf);
@@ -36,11 +64,39 @@
 		void DeltaOffset(int dx, int dy);
 		std::tuple<int, int> GetOffset() const;
 
+		// Pixels, for drawing things that aren't tiles in the same place
+		std::tuple<unsigned int, unsigned int> GetTileSize() const;
+
 		// Function for manipulating display area
 		void SetView(int x_display, int y_display);
 
+		// Functions for changing tiles during operation
+		void SetTile(int x, int y, TileIndex index);
+		void SetTileCost(TileIndex index, FlowField::Cost cost);
+		void SetTileOpaque(TileIndex index, bool opaque);
+
+		// Functions for navigation, flow fields are shared by everyone heading
+		//  to the same goal and kept up to date as tiles change
+		std::shared_ptr<const FlowField> GetFlowField(int goal_x, int goal_y);
+		void ReleaseFlowFields();
+
+		// Tiles with an Impassable cost, for moving actors around
+		const SolidityMap& GetSolidity() const { return this->solidity; }
+
+		// Functions for line of sight, attached visibility maps hear about
+		//  every tile that starts or stops blocking sight
+		const SolidityMap& GetOpacity() const { return this->opacity; }
+		void AttachVisibility(VisibilityMap* vm);
+		void DetachVisibility(VisibilityMap* vm);
+
+		// Tiles a player hasn't explored yet are not drawn, nullptr draws all
+		void SetFog(const VisibilityMap* fog);
+
 	private:
-		void Draw(SDL_Surface* surf, IndexArray indices, std::vector<SDL_Surface*> surfaces);
+		void Draw(SDL_Surface* surf, const IndexArray& indices, const std::vector<SDL_Surface*>& surfaces);
+		void LoadMap(const ConfigFile::ConfigFileInterface& cfi);
+		void ReadLayer(std::string_view csv, unsigned int width, unsigned int height, IndexArray& indices);
+		void SwapTileLayer(IndexArray& indices);
 
 		// Number of tiles in complete map
 		unsigned int x_extent, y_extent;
@@ -59,11 +115,16 @@
 		public:
 			IndexArray();
 			IndexArray(const int width, const int height);
+			IndexArray(IndexArray&&) = default;
+			IndexArray& operator=(IndexArray&&) = default;
 			~IndexArray();
 
 			void Set(const int x, const int y, TileIndex index);
 			TileIndex At(const int x, const int y) const;
 			const TileIndex* PointAt(const int x, const int y) const;
+			TileIndex* PointAt(const int x, const int y);
+			int GetStride() const { return stride; }
+			size_t GetByteCount() const { return vec.capacity() * sizeof(TileIndex); }
 						
 		private:
 			std::vector<TileIndex> vec;
@@ -74,9 +135,37 @@
 		IndexArray deco_indices;
 		IndexArray over_indices;
 
+		// Tile images belong to the AssetCache, tile_surf mirrors the handles
+		//  so drawing doesn't have to go through them
+		std::vector<AssetCache::Handle> tile_images;
 		std::vector<SDL_Surface*> tile_surf;
 		std::vector<SDL_Surface*> deco_surf;
 		std::vector<SDL_Surface*> over_surf;
 
+		// Traversal cost per TileIndex, and the resulting cost of every tile
+		void RebuildCostGrid();
+		void UpdateCostGrid(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1);
+		std::vector<FlowField::Cost> tile_cost;
+		std::vector<FlowField::Cost> cost_grid;
+		SolidityMap solidity;
+
+		// Which TileIndex blocks sight, and the resulting opaque tiles
+		std::vector<std::uint8_t> tile_opaque;
+		SolidityMap opacity;
+		std::vector<VisibilityMap*> visibility;
+		const VisibilityMap* fog;
+
+		std::map<std::tuple<int, int>, std::shared_ptr<FlowField>> flow_fields;
+
+		// Procedural source of the map, and which chunks it already filled
+		void FillChunk(int cx, int cy);
+		std::shared_ptr<const MapGenerator> generator;
+		std::vector<std::uint8_t> chunk_ready;
+		int chunks_x, chunks_y;
+
+		// Everything above but the tile images, which the AssetCache counts
+		void Account();
+		MemoryAccount memory;
+
 		
 	};
@@ -0,0 +1,187 @@
+#include "HotReload.h"
+#include <stdexcept>
+#include "ThreadPool.h"
+#include "ImageLibrary.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+HotReload::HotReload(ThreadPool& pool, std::chrono::milliseconds poll_interval) : m_pool(pool), m_watcher(poll_interval)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("HotReload::HotReload(ThreadPool& pool, std::chrono::milliseconds poll_interval)");
+	logger->info("Hot reload using {0}", m_watcher.IsUsingNotify() ? "inotify" : "polling");
+}
+
+HotReload::~HotReload()
+	// Jobs read the current config, so they have to finish first
+{
+	for (auto& file : m_files)
+	{
+		if (!file.second.job.valid())
+		{
+			continue;
+		}
+		try
+		{
+			auto result = file.second.job.get();
+			if (result.surface != nullptr)
+			{
+				SDL_FreeSurface(result.surface);
+			}
+		}
+		catch (...)
+		{
+		}
+	}
+}
+
+void HotReload::WatchConfig(const std::string& filename, ConfigCallback on_change)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Hot reload watching config: {0}", filename);
+
+	Watched& watched = m_files[filename];
+	watched.is_config = true;
+	watched.display_format = 0;
+	watched.on_config = std::move(on_change);
+	watched.current = std::make_unique<ConfigFile::ConfigFileInterface>(filename, ConfigFile::ConfigFileInterface::LoadMode::Mapped);
+	watched.again = false;
+	m_watcher.Watch(filename);
+}
+
+void HotReload::WatchImage(const std::string& filename, Uint32 display_format, ImageCallback on_change)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Hot reload watching image: {0}", filename);
+
+	Watched& watched = m_files[filename];
+	watched.is_config = false;
+	watched.display_format = display_format;
+	watched.on_image = std::move(on_change);
+	watched.again = false;
+	m_watcher.Watch(filename);
+}
+
+void HotReload::Update()
+{
+	m_watcher.Poll(m_changed);
+	for (const auto& filename : m_changed)
+	{
+		auto fit = m_files.find(filename);
+		if (fit == m_files.end())
+		{
+			continue;
+		}
+		if (fit->second.job.valid())
+		{
+			fit->second.again = true;
+		}
+		else
+		{
+			this->Start(fit->first, fit->second);
+		}
+	}
+
+	for (auto& file : m_files)
+	{
+		Watched& watched = file.second;
+		if (!watched.job.valid() || watched.job.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			continue;
+		}
+
+		auto logger = spdlog::get("EngineLogger");
+		try
+		{
+			this->Apply(file.first, watched, watched.job.get());
+		}
+		catch (const ConfigFile::ConfigFileException& e)
+		{
+			logger->error("Reload of {0} failed, keeping the old version: {1}", file.first, e.message);
+		}
+		catch (const std::exception& e)
+		{
+			logger->error("Reload of {0} failed, keeping the old version: {1}", file.first, e.what());
+		}
+		catch (const std::string& e)
+		{
+			logger->error("Reload of {0} failed, keeping the old version: {1}", file.first, e);
+		}
+
+		if (watched.again)
+		{
+			watched.again = false;
+			this->Start(file.first, watched);
+		}
+	}
+}
+
+size_t HotReload::GetPending() const
+{
+	size_t pending = 0;
+	for (const auto& file : m_files)
+	{
+		pending += file.second.job.valid();
+	}
+	return pending;
+}
+
+void HotReload::Start(const std::string& filename, Watched& watched)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("Reloading changed file: {0}", filename);
+
+	if (watched.is_config)
+	{
+		// current is only replaced in Apply, never while a job is running
+		const ConfigFile::ConfigFileInterface* current = watched.current.get();
+		watched.job = m_pool.Submit([filename, current]()
+		{
+			Result result;
+			result.surface = nullptr;
+			result.config = std::make_unique<ConfigFile::ConfigFileInterface>(filename, ConfigFile::ConfigFileInterface::LoadMode::Mapped);
+			result.changes = ConfigFile::DiffConfig(current->GetTree().GetRoot(), result.config->GetTree().GetRoot());
+			return result;
+		});
+	}
+	else
+	{
+		const Uint32 display_format = watched.display_format;
+		watched.job = m_pool.Submit([filename, display_format]()
+		{
+			Result result;
+			result.surface = ImageLibrary::Decode(filename, display_format);
+			if (result.surface == nullptr)
+			{
+				throw std::runtime_error("Cannot decode image");
+			}
+			return result;
+		});
+	}
+}
+
+void HotReload::Apply(const std::string& filename, Watched& watched, Result result)
+{
+	auto logger = spdlog::get("EngineLogger");
+
+	if (!watched.is_config)
+	{
+		logger->debug("Image swapped in: {0}", filename);
+		watched.on_image(result.surface);
+		return;
+	}
+
+	if (result.changes.empty())
+	{
+		logger->debug("{0} saved without changes", filename);
+		return;
+	}
+	for (const auto& change : result.changes)
+	{
+		logger->debug("Config change in {0}: \"{1}\"", filename, change.path);
+	}
+
+	// Changes point into both versions, the old one goes once the callback is done
+	watched.on_config(*result.config, result.changes);
+	watched.current = std::move(result.config);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <future>
+
+#include "SDL.h"
+#include "FileWatcher.h"
+#include "ConfigFileInterface.h"
+#include "ConfigDiff.h"
+
+class ThreadPool;
+
+/// Reloads config files, maps and images while the game runs.  Changed
+///  files are re-parsed on the thread pool, one job per file, and nothing
+///  the game uses is touched until Update hands the result to the file's
+///  callback.  Call Update once per frame, between frames, from the thread
+///  that owns the game state.
+///
+///  Config callbacks get the new file and what changed since the version
+///  they last saw.  The changes point into both versions and are only
+///  good until the callback returns.  Files that fail to parse (half
+///  saved, typos) are logged and the previous version stays in use.
+///
+class HotReload
+{
+public:
+	using ConfigCallback = std::function<void(const ConfigFile::ConfigFileInterface&, const std::vector<ConfigFile::ConfigChange>&)>;
+
+	// Takes ownership of the new surface
+	using ImageCallback = std::function<void(SDL_Surface*)>;
+
+	HotReload(ThreadPool& pool, std::chrono::milliseconds poll_interval = std::chrono::milliseconds(250));
+	~HotReload();
+
+	HotReload(const HotReload&) = delete;
+	HotReload& operator=(const HotReload&) = delete;
+
+	// The file is parsed now so later changes have something to diff against
+	void WatchConfig(const std::string& filename, ConfigCallback on_change);
+	// Reloaded images are converted like ImageLibrary::Decode does
+	void WatchImage(const std::string& filename, Uint32 display_format, ImageCallback on_change);
+
+	// Starts jobs for files changed since last time and applies finished ones
+	void Update();
+
+	size_t GetPending() const;
+
+private:
+	struct Result
+	{
+		std::unique_ptr<ConfigFile::ConfigFileInterface> config;
+		std::vector<ConfigFile::ConfigChange> changes;
+		SDL_Surface* surface;
+	};
+
+	struct Watched
+	{
+		bool is_config;
+		Uint32 display_format;
+		ConfigCallback on_config;
+		ImageCallback on_image;
+
+		// Version callbacks have seen, changes are diffed against it
+		std::unique_ptr<ConfigFile::ConfigFileInterface> current;
+
+		// At most one job per file, a change during the job queues another
+		std::future<Result> job;
+		bool again;
+	};
+
+	void Start(const std::string& filename, Watched& watched);
+	void Apply(const std::string& filename, Watched& watched, Result result);
+
+	ThreadPool& m_pool;
+	FileWatcher m_watcher;
+	std::map<std::string, Watched> m_files;
+	std::vector<std::string> m_changed;
+};
@@ -1,39 +1,146 @@
 #include "ImageLibrary.h"
-#include <iostream>
+#include <algorithm>
+#include <filesystem>
 #include "SDL_image.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "ThreadPool.h"
 
 Image::Image(std::string filename, SDL_Surface* screen): filename(filename), surface(nullptr)
 {
-	SDL_Surface* loaded = IMG_Load(filename.c_str());
-	this->surface = SDL_ConvertSurface(loaded, screen->format, NULL);
-	SDL_FreeSurface(loaded);
-	loaded = nullptr;
-	std::cerr << "Image created: " << filename << std::endl;
+	this->surface = ImageLibrary::Decode(filename, screen->format->format);
+
+	auto logger = spdlog::get("EngineLogger");
+	logger->debug("Image created: {0}", filename);
 }
 
 Image::~Image()
 {
 	SDL_FreeSurface(this->surface);
-	std::cerr << "Image destroyed." << std::endl;
 
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("Image destroyed.");
 }
 
 
-ImageLibrary::ImageLibrary(std::string directory, SDL_Surface* screen)
+ImageLibrary::ImageLibrary(std::string directory, AssetCache& cache, AssetCategory category, ThreadPool& pool)
 {
-	std::cerr << "Image library created at this directory: " << directory << std::endl;
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("Image library created at this directory: {0}", directory);
 
+	std::vector<std::string> files;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+	{
+		auto extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (entry.is_regular_file() && (extension == ".png" || extension == ".bmp" || extension == ".jpg"))
+		{
+			files.push_back(entry.path().string());
+		}
+	}
+	if (ec)
+	{
+		logger->error("Cannot read image directory {0}: {1}", directory, ec.message());
+	}
+
+	// Sorted so ids don't depend on the order the file system lists things
+	std::sort(files.begin(), files.end());
+
+	for (size_t k = 0; k < files.size(); ++k)
+	{
+		const auto id = static_cast<ImageId>(k);
+		const auto& filename = files[k];
+		auto decoded = pool.Submit([filename, &cache, category]() { return cache.Acquire(filename, category); });
+
+		image_by_id[id] = Entry{ filename, decoded.share() };
+		id_by_name[std::filesystem::path(filename).filename().string()] = id;
+	}
+	logger->debug("{0} images queued for decoding", files.size());
 }
 
 ImageLibrary::~ImageLibrary()
+	// Decoding jobs have to finish, or their handles would turn up later
+{
+	this->WaitAll();
+
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("ImageLibrary destroyed.");
+}
+
+SDL_Surface* ImageLibrary::Decode(const std::string& filename, Uint32 display_format)
+{
+	auto logger = spdlog::get("EngineLogger");
+
+	SDL_Surface* loaded = IMG_Load(filename.c_str());
+	if (loaded == nullptr)
+	{
+		logger->error("Cannot load image {0}: {1}", filename, IMG_GetError());
+		return nullptr;
+	}
+
+	// Alpha would be lost in an opaque display format
+	const Uint32 format = (loaded->format->Amask != 0) ? SDL_PIXELFORMAT_ARGB8888 : display_format;
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, format, 0);
+	SDL_FreeSurface(loaded);
+	loaded = nullptr;
+
+	if (converted == nullptr)
+	{
+		logger->error("Cannot convert image {0}: {1}", filename, SDL_GetError());
+		return nullptr;
+	}
+
+	// Colour keys survive the conversion, runs of them blit faster encoded
+	Uint32 key;
+	if (SDL_GetColorKey(converted, &key) == 0)
+	{
+		SDL_SetSurfaceRLE(converted, 1);
+	}
+
+	logger->trace("Image decoded: {0}", filename);
+	return converted;
+}
+
+std::shared_future<AssetCache::Handle> ImageLibrary::Request(ImageId id) const
 {
-	std::cerr << "ImageLibrary destroyed." << std::endl;
+	auto image = image_by_id.find(id);
+	if (image == image_by_id.end())
+	{
+		return std::shared_future<AssetCache::Handle>();
+	}
+	return image->second.handle;
+}
 
+SDL_Surface* ImageLibrary::GetImage(ImageId id)
+{
+	auto image = image_by_id.find(id);
+	if (image == image_by_id.end())
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->warn("No image with id {0}", id);
+		return nullptr;
+	}
+	return image->second.handle.get().Get();
 }
 
-SDL_Surface* GetImage(int id)
+ImageLibrary::ImageId ImageLibrary::GetId(const std::string& filename) const
 {
-	std::cerr << "Image reference retrieved." << std::endl;
+	auto id = id_by_name.find(filename);
+	return (id == id_by_name.end()) ? -1 : id->second;
+}
 
-	return NULL;
-}
\ No newline at end of file
+bool ImageLibrary::IsReady(ImageId id) const
+{
+	auto image = image_by_id.find(id);
+	return image != image_by_id.end() &&
+		image->second.handle.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void ImageLibrary::WaitAll() const
+{
+	for (const auto& image : image_by_id)
+	{
+		image.second.handle.wait();
+	}
+}
@@ -2,8 +2,13 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include <future>
 
 #include "SDL.h"
+#include "AssetCache.h"
+
+class ThreadPool;
 
 class Image
 {
@@ -11,19 +16,53 @@ public:
 	Image(std::string filename, SDL_Surface* screen);
 	~Image();
 
+	SDL_Surface* GetSurface() const { return surface; }
+
 private:
 	std::string filename;
 	SDL_Surface* surface;
 };
 
 class ImageLibrary
+	// Every image in a directory, decoded in parallel on a thread pool and
+	//	converted once so blits never have to convert pixels:
+	//	  - opaque images take the display format
+	//	  - images with an alpha channel take ARGB8888, which SDL blends onto
+	//		the display formats without a conversion pass
+	//	  - colour keyed images get RLE acceleration
+	//	Ids follow the sorted file names.  Surfaces belong to the AssetCache,
+	//	the library holds a handle on each for as long as it exists.
 {
 public:
-	ImageLibrary(std::string directory, SDL_Surface* screen);
+	using ImageId = int;
+
+	ImageLibrary(std::string directory, AssetCache& cache, AssetCategory category, ThreadPool& pool);
 	~ImageLibrary();
 
-	SDL_Surface* GetImage(int id);
-	
+	// Decodes and converts one file, the caller owns the surface.
+	//	Returns nullptr if the file can't be loaded.  Safe on any thread.
+	static SDL_Surface* Decode(const std::string& filename, Uint32 display_format);
+
+	// Handle on an image that may still be decoding
+	std::shared_future<AssetCache::Handle> Request(ImageId id) const;
+
+	// Waits for the image if it isn't decoded yet, nullptr for a bad id or file
+	SDL_Surface* GetImage(ImageId id);
+
+	// -1 if there is no such file
+	ImageId GetId(const std::string& filename) const;
+	size_t GetCount() const { return image_by_id.size(); }
+
+	bool IsReady(ImageId id) const;
+	void WaitAll() const;
+
 private:
-	std::map<int, SDL_Surface*> image_by_id;
+	struct Entry
+	{
+		std::string filename;
+		std::shared_future<AssetCache::Handle> handle;
+	};
+
+	std::map<ImageId, Entry> image_by_id;
+	std::map<std::string, ImageId> id_by_name;
 };
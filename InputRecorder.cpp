@@ -0,0 +1,378 @@
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "InputRecorder.h"
+#include "Model.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+const char InputRecorder::Magic[8] = { 'I', 'N', 'P', 'U', 'T', 'L', 'O', 'G' };
+
+namespace {
+
+	// FNV-1a over 8 byte words
+	std::uint64_t HashBytes(const void* data, size_t size, std::uint64_t hash)
+	{
+		const char* bytes = static_cast<const char*>(data);
+		size_t k = 0;
+		for (; k + 8 <= size; k += 8)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, bytes + k, sizeof(word));
+			hash = (hash ^ word) * 1099511628211ull;
+		}
+		for (; k < size; ++k)
+		{
+			hash = (hash ^ static_cast<unsigned char>(bytes[k])) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Seven bits at a time, low first, at most 10 bytes
+	size_t EncodeVarint(std::uint64_t value, char* out)
+	{
+		size_t length = 0;
+		while (value >= 0x80)
+		{
+			out[length++] = static_cast<char>((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		out[length++] = static_cast<char>(value);
+		return length;
+	}
+
+	std::uint64_t ZigZag(std::int64_t value)
+	{
+		return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	}
+
+	// splitmix64 finish, so actor hashes don't cancel out in a sum
+	std::uint64_t Finish(std::uint64_t hash)
+	{
+		hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+		hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+		return hash ^ (hash >> 31);
+	}
+
+}
+
+ActorHash::ActorHash() :
+	m_hash(InitialHash),
+	m_sum(0),
+	m_following(false)
+{
+}
+
+std::uint64_t ActorHash::Step(const Actors& actors, std::pmr::memory_resource* scratch)
+	// The sum doesn't depend on the order, so replaying the structure only
+	//	has to keep each hash with its actor
+{
+	actors.BuildDelta(m_delta, scratch);
+
+	// The first tick, or one after the Actors started over
+	if (m_delta.reset || !m_following)
+	{
+		m_hashes.resize(actors.GetLength());
+		m_sum = 0;
+		for (size_t index = 0; index < m_hashes.size(); ++index)
+		{
+			m_hashes[index] = HashActor(actors, index);
+			m_sum += m_hashes[index];
+		}
+		m_following = true;
+	}
+	else
+	{
+		for (const auto& s : m_delta.structure)
+		{
+			switch (s.kind)
+			{
+			case ActorDelta::Structural::Kind::Added:
+				// The changed ranges cover them
+				m_hashes.resize(m_hashes.size() + s.other, 0);
+				break;
+			case ActorDelta::Structural::Kind::Removed:
+				m_sum -= m_hashes.back();
+				m_hashes.pop_back();
+				break;
+			case ActorDelta::Structural::Kind::Swapped:
+				std::swap(m_hashes[s.index], m_hashes[s.other]);
+				break;
+			}
+		}
+
+		for (const auto& range : m_delta.changed)
+		{
+			for (size_t index = range.first; index < range.first + range.count; ++index)
+			{
+				const std::uint64_t hash = HashActor(actors, index);
+				m_sum += hash - m_hashes[index];
+				m_hashes[index] = hash;
+			}
+		}
+	}
+
+	m_hash = (m_hash ^ m_sum) * 1099511628211ull;
+	m_hash = (m_hash ^ m_hashes.size()) * 1099511628211ull;
+	return m_hash;
+}
+
+std::uint64_t ActorHash::HashActor(const Actors& actors, size_t index)
+{
+	const ActorHandle handle = actors.GetHandle(index);
+	std::uint64_t hash = HashBytes(&handle, sizeof(handle), InitialHash);
+	hash = HashBytes(&actors.m_pd[index], sizeof(Actors::PositionData), hash);
+	hash = HashBytes(&actors.m_md[index], sizeof(Actors::MovementData), hash);
+	hash = HashBytes(&actors.m_types[index], sizeof(Actors::ActorType), hash);
+	hash = (hash ^ actors.m_attributes[index].to_ulong()) * 1099511628211ull;
+	return Finish(hash);
+}
+
+InputRecorder::InputRecorder(const std::string& filename, std::uint32_t tick_rate) :
+	m_filename(filename),
+	m_out(filename, std::ios::binary | std::ios::trunc),
+	m_tick(0),
+	m_event_count(0)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("Recording input to {0} at {1} ticks per second", filename, tick_rate);
+
+	if (!m_out)
+	{
+		throw std::runtime_error("Cannot create input log: " + filename);
+	}
+
+	Header header;
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.tick_rate = tick_rate;
+	m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+InputRecorder::~InputRecorder()
+{
+	auto logger = spdlog::get("EngineLogger");
+	m_out.flush();
+	if (!m_out)
+	{
+		logger->error("Input log is incomplete: {0}", m_filename);
+	}
+	logger->info("Input recording ended after {0} ticks: {1}", m_tick, m_filename);
+}
+
+void InputRecorder::Record(const SDL_Event& e)
+{
+	switch (e.type)
+	{
+	case SDL_QUIT:
+		m_events.push_back(static_cast<char>(EventKind::Quit));
+		break;
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		m_events.push_back(static_cast<char>(e.type == SDL_KEYDOWN ? EventKind::KeyDown : EventKind::KeyUp));
+		this->PutSigned(e.key.keysym.sym);
+		this->PutVarint(static_cast<std::uint64_t>(e.key.keysym.scancode));
+		this->PutVarint(e.key.keysym.mod);
+		m_events.push_back(static_cast<char>(e.key.repeat));
+		break;
+	case SDL_MOUSEMOTION:
+		m_events.push_back(static_cast<char>(EventKind::MouseMotion));
+		this->PutVarint(e.motion.state);
+		this->PutSigned(e.motion.x);
+		this->PutSigned(e.motion.y);
+		this->PutSigned(e.motion.xrel);
+		this->PutSigned(e.motion.yrel);
+		break;
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		m_events.push_back(static_cast<char>(e.type == SDL_MOUSEBUTTONDOWN ? EventKind::MouseButtonDown : EventKind::MouseButtonUp));
+		m_events.push_back(static_cast<char>(e.button.button));
+		m_events.push_back(static_cast<char>(e.button.clicks));
+		this->PutSigned(e.button.x);
+		this->PutSigned(e.button.y);
+		break;
+	default:
+		return;
+	}
+	m_event_count++;
+}
+
+void InputRecorder::EndTick(const Actors& actors, const std::vector<std::uint32_t>& decisions, std::pmr::memory_resource* scratch)
+{
+	const std::uint64_t hash = m_hash.Step(actors, scratch);
+
+	// The count goes first, it is only known once the tick is over
+	char count[10];
+	m_out.write(count, EncodeVarint(m_event_count, count));
+	m_out.write(m_events.data(), m_events.size());
+	m_out.write(count, EncodeVarint(decisions.size(), count));
+	for (std::uint32_t decided : decisions)
+	{
+		m_out.write(count, EncodeVarint(decided, count));
+	}
+	m_out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+
+	m_events.clear();
+	m_event_count = 0;
+	m_tick++;
+}
+
+void InputRecorder::PutVarint(std::uint64_t value)
+{
+	char bytes[10];
+	m_events.insert(m_events.end(), bytes, bytes + EncodeVarint(value, bytes));
+}
+
+void InputRecorder::PutSigned(std::int64_t value)
+{
+	this->PutVarint(ZigZag(value));
+}
+
+
+InputReplay::InputReplay(const std::string& filename) :
+	m_filename(filename),
+	m_file(filename, MappedFile::Mode::ReadOnly),
+	m_position(sizeof(InputRecorder::Header)),
+	m_tick_rate(0),
+	m_tick(0),
+	m_recorded_hash(0),
+	m_diverged(false),
+	m_diverged_tick(0)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("InputReplay::InputReplay(const std::string& filename)");
+
+	InputRecorder::Header header;
+	if (m_file.GetSize() < sizeof(header))
+	{
+		throw std::runtime_error("Input log too short: " + filename);
+	}
+	std::memcpy(&header, m_file.GetData(), sizeof(header));
+	if (std::memcmp(header.magic, InputRecorder::Magic, sizeof(header.magic)) != 0 || header.version != InputRecorder::Version ||
+		header.tick_rate == 0)
+	{
+		throw std::runtime_error("Not an input log of this version: " + filename);
+	}
+	m_tick_rate = header.tick_rate;
+
+	logger->info("Replaying input from {0} at {1} ticks per second", filename, m_tick_rate);
+}
+
+bool InputReplay::NextTick(std::vector<SDL_Event>& events, std::vector<std::uint32_t>& decisions)
+{
+	events.clear();
+	decisions.clear();
+	if (m_position == m_file.GetSize())
+	{
+		return false;
+	}
+
+	const std::uint64_t count = this->GetVarint();
+	for (std::uint64_t k = 0; k < count; ++k)
+	{
+		SDL_Event e;
+		std::memset(&e, 0, sizeof(e));
+		const auto kind = static_cast<InputRecorder::EventKind>(this->GetByte());
+		switch (kind)
+		{
+		case InputRecorder::EventKind::Quit:
+			e.type = SDL_QUIT;
+			break;
+		case InputRecorder::EventKind::KeyDown:
+		case InputRecorder::EventKind::KeyUp:
+			e.type = (kind == InputRecorder::EventKind::KeyDown) ? SDL_KEYDOWN : SDL_KEYUP;
+			e.key.state = (kind == InputRecorder::EventKind::KeyDown) ? 1 : 0;
+			e.key.keysym.sym = static_cast<SDL_Keycode>(this->GetSigned());
+			e.key.keysym.scancode = static_cast<decltype(e.key.keysym.scancode)>(this->GetVarint());
+			e.key.keysym.mod = static_cast<Uint16>(this->GetVarint());
+			e.key.repeat = this->GetByte();
+			break;
+		case InputRecorder::EventKind::MouseMotion:
+			e.type = SDL_MOUSEMOTION;
+			e.motion.state = static_cast<Uint32>(this->GetVarint());
+			e.motion.x = static_cast<Sint32>(this->GetSigned());
+			e.motion.y = static_cast<Sint32>(this->GetSigned());
+			e.motion.xrel = static_cast<Sint32>(this->GetSigned());
+			e.motion.yrel = static_cast<Sint32>(this->GetSigned());
+			break;
+		case InputRecorder::EventKind::MouseButtonDown:
+		case InputRecorder::EventKind::MouseButtonUp:
+			e.type = (kind == InputRecorder::EventKind::MouseButtonDown) ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+			e.button.state = (kind == InputRecorder::EventKind::MouseButtonDown) ? 1 : 0;
+			e.button.button = this->GetByte();
+			e.button.clicks = this->GetByte();
+			e.button.x = static_cast<Sint32>(this->GetSigned());
+			e.button.y = static_cast<Sint32>(this->GetSigned());
+			break;
+		default:
+			throw std::runtime_error("Input log has an unknown event: " + m_filename);
+		}
+
+		// Timestamps follow the ticks, not the wall clock of the recording
+		e.key.timestamp = static_cast<Uint32>(m_tick * 1000 / m_tick_rate);
+		events.push_back(e);
+	}
+
+	// No more types than bytes left, a damaged count can't allocate much
+	const std::uint64_t types = this->GetVarint();
+	if (types > m_file.GetSize() - m_position)
+	{
+		throw std::runtime_error("Input log has a bad decision count: " + m_filename);
+	}
+	for (std::uint64_t k = 0; k < types; ++k)
+	{
+		decisions.push_back(static_cast<std::uint32_t>(this->GetVarint()));
+	}
+
+	if (m_file.GetSize() - m_position < sizeof(m_recorded_hash))
+	{
+		throw std::runtime_error("Input log ends half way through a tick: " + m_filename);
+	}
+	std::memcpy(&m_recorded_hash, m_file.GetData() + m_position, sizeof(m_recorded_hash));
+	m_position += sizeof(m_recorded_hash);
+	m_tick++;
+	return true;
+}
+
+bool InputReplay::Verify(const Actors& actors, std::pmr::memory_resource* scratch)
+{
+	if (m_hash.Step(actors, scratch) != m_recorded_hash && !m_diverged)
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->error("Replay of {0} diverged on tick {1}", m_filename, m_tick);
+		m_diverged = true;
+		m_diverged_tick = m_tick;
+	}
+	return !m_diverged;
+}
+
+std::uint8_t InputReplay::GetByte()
+{
+	if (m_position >= m_file.GetSize())
+	{
+		throw std::runtime_error("Input log ends half way through a tick: " + m_filename);
+	}
+	return static_cast<std::uint8_t>(m_file.GetData()[m_position++]);
+}
+
+std::uint64_t InputReplay::GetVarint()
+{
+	std::uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		const std::uint8_t byte = this->GetByte();
+		value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return value;
+		}
+	}
+	throw std::runtime_error("Input log has a bad number: " + m_filename);
+}
+
+std::int64_t InputReplay::GetSigned()
+{
+	const std::uint64_t value = this->GetVarint();
+	return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <memory_resource>
+
+#include "SDL.h"
+#include "MappedFile.h"
+#include "Model.h"
+
+/// Running hash of the Actors, one step per tick.  Every actor has a hash
+///  of its handle and state, the step mixes their sum into the hash of the
+///  tick before.  Only what the Actors marked since their last
+///  ClearChanges is hashed again, so a tick costs what changed in it.
+///
+class ActorHash
+{
+public:
+	ActorHash();
+
+	// The hash after this tick.  Call it every tick, before the Model
+	//  notifies its views, that clears the changes.  The first call hashes
+	//  every actor.  Sorting the changes takes scratch memory.
+	std::uint64_t Step(const Actors& actors, std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	static constexpr std::uint64_t InitialHash = 14695981039346656037ull;
+
+private:
+	// Floats by their bits, a replay has to match exactly
+	static std::uint64_t HashActor(const Actors& actors, size_t index);
+
+	std::uint64_t m_hash;
+	std::uint64_t m_sum;
+
+	// Per actor, kept in the order of the Actors by replaying the delta
+	std::vector<std::uint64_t> m_hashes;
+	bool m_following;
+	ActorDelta m_delta;
+};
+
+
+/// Input captured per fixed simulation tick, so a session can be played
+///  back exactly: same events on the same ticks.  Only the events the
+///  simulation reacts to are kept (quit, keys, mouse), packed as varints.
+///
+///  After each tick the state of the Actors is hashed into a running
+///  hash, which goes into the log with the tick.  A replay that ends up
+///  with a different hash has diverged from the recording on that tick.
+///  So do the decisions the tick's behavior budgets allowed, which depend
+///  on the clock, for the replay to make the same ones.
+///
+///  Log: header, then per tick the number of events, the events, the
+///  number of decision counts, the counts and the 8 byte running hash.
+///  Everything is in native byte order.
+///
+class InputRecorder
+{
+public:
+	// Throws std::runtime_error if the log can't be created
+	InputRecorder(const std::string& filename, std::uint32_t tick_rate);
+	~InputRecorder();
+
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder& operator=(const InputRecorder&) = delete;
+
+	// Events that aren't input are skipped
+	void Record(const SDL_Event& e);
+
+	// Closes the current tick with the state it left behind and what its
+	//  behaviors decided, see BehaviorScheduler::GetDecisions
+	void EndTick(const Actors& actors, const std::vector<std::uint32_t>& decisions,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	std::uint64_t GetTick() const { return m_tick; }
+
+	// Shared with InputReplay
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t tick_rate;
+	};
+	static constexpr std::uint32_t Version = 3;
+	static const char Magic[8];
+
+	enum class EventKind : std::uint8_t { Quit, KeyDown, KeyUp, MouseMotion, MouseButtonDown, MouseButtonUp };
+
+private:
+	void PutVarint(std::uint64_t value);
+	void PutSigned(std::int64_t value);
+
+	std::string m_filename;
+	std::ofstream m_out;
+	std::uint64_t m_tick;
+	ActorHash m_hash;
+
+	// Events of the tick in progress
+	std::vector<char> m_events;
+	std::uint32_t m_event_count;
+};
+
+/// Plays an InputRecorder log back tick by tick, without waiting between
+///  ticks.  Check the state after every tick with Verify.
+///
+class InputReplay
+{
+public:
+	// Throws std::runtime_error if the file isn't a log of this version
+	explicit InputReplay(const std::string& filename);
+
+	// Events and decisions of the next tick, false once the log is over.
+	//  Throws std::runtime_error if the log is damaged.
+	bool NextTick(std::vector<SDL_Event>& events, std::vector<std::uint32_t>& decisions);
+
+	// State after the tick NextTick gave out, false if it isn't what was
+	//  recorded.  Stays false after the first divergence.  Call it where
+	//  the recording ended the tick, before the views are notified.
+	bool Verify(const Actors& actors, std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	std::uint32_t GetTickRate() const { return m_tick_rate; }
+	std::uint64_t GetTick() const { return m_tick; }
+	bool HasDiverged() const { return m_diverged; }
+
+	// First tick that didn't match, only meaningful if HasDiverged
+	std::uint64_t GetDivergedTick() const { return m_diverged_tick; }
+
+private:
+	std::uint64_t GetVarint();
+	std::int64_t GetSigned();
+	std::uint8_t GetByte();
+
+	std::string m_filename;
+	MappedFile m_file;
+	std::uint64_t m_position;
+	std::uint32_t m_tick_rate;
+
+	std::uint64_t m_tick;
+	ActorHash m_hash;
+	std::uint64_t m_recorded_hash;
+	bool m_diverged;
+	std::uint64_t m_diverged_tick;
+};
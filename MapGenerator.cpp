@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+
+#include "MapGenerator.h"
+
+namespace {
+
+	float Fade(float t)
+	{
+		// Smoothstep, hides the lattice
+		return t * t * (3.0f - 2.0f * t);
+	}
+
+}
+
+MapGenerator::MapGenerator(std::uint32_t seed) :
+	m_seed(seed), m_octaves(4), m_frequency(1.0f / 32.0f), m_persistence(0.5f)
+{}
+
+void MapGenerator::SetNoise(int octaves, float frequency, float persistence)
+{
+	m_octaves = std::max(octaves, 1);
+	m_frequency = frequency;
+	m_persistence = persistence;
+}
+
+void MapGenerator::AddBiome(float max_height, TileIndex tile)
+{
+	m_biomes.push_back(Biome{ max_height, tile });
+}
+
+void MapGenerator::AddScatter(Layer layer, TileIndex on_tile, TileIndex place, float density)
+{
+	// Compare hashes against an integer threshold, no floats per tile
+	density = std::min(std::max(density, 0.0f), 1.0f);
+	auto threshold = static_cast<std::uint32_t>(density * 4294967295.0);
+	auto salt = Hash(m_seed, static_cast<int>(m_scatter.size()), 0x5CA7);
+
+	m_scatter.push_back(Scatter{ layer, on_tile, place, threshold, salt });
+}
+
+void MapGenerator::GenerateChunk(int cx, int cy, int width, int height, int stride,
+	TileIndex* tiles, TileIndex* decorators, TileIndex* overlay) const
+{
+	const int x0 = cx * ChunkSize;
+	const int y0 = cy * ChunkSize;
+	const int x1 = std::min(x0 + ChunkSize, width);
+	const int y1 = std::min(y0 + ChunkSize, height);
+
+	for (int y = y0; y < y1; ++y)
+	{
+		TileIndex* tile_row = tiles + static_cast<size_t>(y) * stride;
+		TileIndex* deco_row = decorators ? decorators + static_cast<size_t>(y) * stride : nullptr;
+		TileIndex* over_row = overlay ? overlay + static_cast<size_t>(y) * stride : nullptr;
+
+		for (int x = x0; x < x1; ++x)
+		{
+			const TileIndex base = BiomeAt(HeightAt(x, y));
+			tile_row[x] = base;
+			if (deco_row)
+			{
+				deco_row[x] = NoTile;
+			}
+			if (over_row)
+			{
+				over_row[x] = NoTile;
+			}
+
+			// Later rules win where several match
+			for (const auto& rule : m_scatter)
+			{
+				if (rule.on_tile != base || Hash(rule.salt, x, y) > rule.threshold)
+				{
+					continue;
+				}
+				switch (rule.layer)
+				{
+				case Layer::Tiles:
+					tile_row[x] = rule.place;
+					break;
+				case Layer::Decorators:
+					if (deco_row) { deco_row[x] = rule.place; }
+					break;
+				case Layer::Overlay:
+					if (over_row) { over_row[x] = rule.place; }
+					break;
+				}
+			}
+		}
+	}
+}
+
+float MapGenerator::HeightAt(int x, int y) const
+	// Fractal sum of value noise octaves, normalised back into [0, 1)
+{
+	float sum = 0.0f;
+	float norm = 0.0f;
+	float amplitude = 1.0f;
+	float frequency = m_frequency;
+
+	for (int octave = 0; octave < m_octaves; ++octave)
+	{
+		sum += amplitude * Lattice(m_seed + octave * 0x9E3779B9u, x * frequency, y * frequency);
+		norm += amplitude;
+		amplitude *= m_persistence;
+		frequency *= 2.0f;
+	}
+
+	return std::min(sum / norm, 0.99999994f);
+}
+
+std::uint32_t MapGenerator::Hash(std::uint32_t seed, int x, int y)
+	// Integer mix of the coordinates, good enough for terrain and cheap
+{
+	std::uint32_t h = seed ^ (static_cast<std::uint32_t>(x) * 0x8DA6B343u) ^ (static_cast<std::uint32_t>(y) * 0xD8163841u);
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+float MapGenerator::Lattice(std::uint32_t seed, float x, float y) const
+{
+	const float fx = std::floor(x);
+	const float fy = std::floor(y);
+	const int ix = static_cast<int>(fx);
+	const int iy = static_cast<int>(fy);
+	const float tx = Fade(x - fx);
+	const float ty = Fade(y - fy);
+
+	// Top 24 bits of the hash as a float in [0, 1)
+	const float scale = 1.0f / 16777216.0f;
+	const float v00 = (Hash(seed, ix, iy) >> 8) * scale;
+	const float v10 = (Hash(seed, ix + 1, iy) >> 8) * scale;
+	const float v01 = (Hash(seed, ix, iy + 1) >> 8) * scale;
+	const float v11 = (Hash(seed, ix + 1, iy + 1) >> 8) * scale;
+
+	const float top = v00 + (v10 - v00) * tx;
+	const float bottom = v01 + (v11 - v01) * tx;
+	return top + (bottom - top) * ty;
+}
+
+MapGenerator::TileIndex MapGenerator::BiomeAt(float height) const
+{
+	for (const auto& biome : m_biomes)
+	{
+		if (height < biome.max_height)
+		{
+			return biome.tile;
+		}
+	}
+	return m_biomes.empty() ? 0 : m_biomes.back().tile;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+/// Procedural map description.  Heights come from seeded fractal value
+///  noise, biome thresholds turn heights into base tiles and scatter
+///  rules sprinkle decorators and overlays on top.  Every tile only
+///  depends on the seed and its own coordinates, so chunks can be filled
+///  in any order, on any number of threads, or lazily while streaming,
+///  and always come out the same.
+///
+class MapGenerator
+{
+public:
+	using TileIndex = int;
+
+	// Written into decorator and overlay layers where nothing is placed
+	static constexpr TileIndex NoTile = -1;
+
+	// Maps are generated in square chunks of this many tiles
+	static constexpr int ChunkSize = 64;
+
+	enum class Layer { Tiles, Decorators, Overlay };
+
+	explicit MapGenerator(std::uint32_t seed);
+	~MapGenerator() = default;
+
+	// Rules, add biomes in order of increasing max_height
+	void SetNoise(int octaves, float frequency, float persistence);
+	void AddBiome(float max_height, TileIndex tile);
+	void AddScatter(Layer layer, TileIndex on_tile, TileIndex place, float density);
+
+	// Fills chunk (cx, cy) of a width x height map.  Layer pointers are to
+	//	tile (0, 0) of a row major array with the given stride, decorators
+	//	and overlay may be null.
+	void GenerateChunk(int cx, int cy, int width, int height, int stride,
+		TileIndex* tiles, TileIndex* decorators, TileIndex* overlay) const;
+
+	// Height in [0, 1) at tile (x, y)
+	float HeightAt(int x, int y) const;
+
+	std::uint32_t GetSeed() const { return m_seed; }
+
+private:
+	struct Biome
+	{
+		float max_height;
+		TileIndex tile;
+	};
+
+	struct Scatter
+	{
+		Layer layer;
+		TileIndex on_tile;
+		TileIndex place;
+		std::uint32_t threshold;
+		std::uint32_t salt;
+	};
+
+	static std::uint32_t Hash(std::uint32_t seed, int x, int y);
+	float Lattice(std::uint32_t seed, float x, float y) const;
+	TileIndex BiomeAt(float height) const;
+
+	std::uint32_t m_seed;
+	int m_octaves;
+	float m_frequency;
+	float m_persistence;
+
+	std::vector<Biome>		m_biomes;
+	std::vector<Scatter>	m_scatter;
+};
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : data(nullptr), size(0), mapped_size(0)
+#ifdef _WIN32
+	, file_handle(nullptr), mapping_handle(nullptr)
+#endif
+{}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename, Mode mode) : MappedFile()
+{
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Cannot open file: " + filename);
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		throw std::runtime_error("Cannot get size of file: " + filename);
+	}
+	this->size = static_cast<std::uint64_t>(file_size.QuadPart);
+
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+
+	// A view ending exactly on a page boundary has no spare zero byte, and
+	//	empty files can't be mapped at all, so those get read instead
+	if (this->size == 0 || (mode == Mode::CopyOnWrite && this->size % si.dwPageSize == 0))
+	{
+		this->fallback = std::make_unique<char[]>(static_cast<size_t>(this->size) + 1);
+		std::uint64_t done = 0;
+		while (done < this->size)
+		{
+			DWORD chunk = static_cast<DWORD>(std::min<std::uint64_t>(this->size - done, 1u << 30));
+			DWORD got = 0;
+			if (!ReadFile(file, this->fallback.get() + done, chunk, &got, nullptr) || got == 0)
+			{
+				CloseHandle(file);
+				throw std::runtime_error("Cannot read file: " + filename);
+			}
+			done += got;
+		}
+		this->fallback[static_cast<size_t>(this->size)] = '\0';
+		this->data = this->fallback.get();
+		CloseHandle(file);
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr,
+		(mode == Mode::ReadOnly) ? PAGE_READONLY : PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		throw std::runtime_error("Cannot map file: " + filename);
+	}
+
+	void* view = MapViewOfFile(mapping, (mode == Mode::ReadOnly) ? FILE_MAP_READ : FILE_MAP_COPY, 0, 0, 0);
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Cannot map view of file: " + filename);
+	}
+
+	this->data = static_cast<char*>(view);
+	this->mapped_size = this->size;
+	this->file_handle = file;
+	this->mapping_handle = mapping;
+}
+
+void MappedFile::Release()
+{
+	if (this->fallback)
+	{
+		this->fallback.reset();
+	}
+	else if (this->data != nullptr)
+	{
+		UnmapViewOfFile(this->data);
+		CloseHandle(static_cast<HANDLE>(this->mapping_handle));
+		CloseHandle(static_cast<HANDLE>(this->file_handle));
+	}
+	this->data = nullptr;
+	this->size = 0;
+	this->mapped_size = 0;
+	this->file_handle = nullptr;
+	this->mapping_handle = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename, Mode mode) : MappedFile()
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Cannot open file: " + filename);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		throw std::runtime_error("Cannot get size of file: " + filename);
+	}
+	this->size = static_cast<std::uint64_t>(st.st_size);
+
+	const std::uint64_t page = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+	void* view = MAP_FAILED;
+
+	if (mode == Mode::ReadOnly)
+	{
+		if (this->size == 0)
+		{
+			close(fd);
+			this->fallback = std::make_unique<char[]>(1);
+			this->data = this->fallback.get();
+			return;
+		}
+		view = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		this->mapped_size = this->size;
+	}
+	else if (this->size % page != 0)
+	{
+		// The rest of the last page reads as zeros and is private to us
+		view = mmap(nullptr, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		this->mapped_size = this->size;
+	}
+	else
+	{
+		// Ends on a page boundary, put the file in front of a zeroed page
+		this->mapped_size = this->size + page;
+		view = mmap(nullptr, this->mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (view != MAP_FAILED && this->size > 0 &&
+			mmap(view, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+		{
+			munmap(view, this->mapped_size);
+			view = MAP_FAILED;
+		}
+	}
+	close(fd);
+
+	if (view == MAP_FAILED)
+	{
+		this->size = 0;
+		this->mapped_size = 0;
+		throw std::runtime_error("Cannot map file: " + filename);
+	}
+
+	// Mostly read front to back by parsers
+	madvise(view, this->mapped_size, MADV_SEQUENTIAL);
+	this->data = static_cast<char*>(view);
+}
+
+void MappedFile::Release()
+{
+	if (this->fallback)
+	{
+		this->fallback.reset();
+	}
+	else if (this->data != nullptr)
+	{
+		munmap(this->data, this->mapped_size);
+	}
+	this->data = nullptr;
+	this->size = 0;
+	this->mapped_size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	this->Release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : MappedFile()
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		this->Release();
+		std::swap(this->data, other.data);
+		std::swap(this->size, other.size);
+		std::swap(this->mapped_size, other.mapped_size);
+		std::swap(this->fallback, other.fallback);
+#ifdef _WIN32
+		std::swap(this->file_handle, other.file_handle);
+		std::swap(this->mapping_handle, other.mapping_handle);
+#endif
+	}
+	return *this;
+}
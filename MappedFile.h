@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+/// A whole file mapped into memory.  ReadOnly views share the page cache,
+///  CopyOnWrite views can be written (e.g. parsed in place) without the
+///  changes ever reaching the file.  CopyOnWrite views always have a
+///  writable zero byte just past the end, so text can be used as a C string.
+///
+class MappedFile
+{
+public:
+	enum class Mode { ReadOnly, CopyOnWrite };
+
+	MappedFile();
+	MappedFile(const std::string& filename, Mode mode);
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	char* GetData() { return this->data; }
+	const char* GetData() const { return this->data; }
+	std::uint64_t GetSize() const { return this->size; }
+	bool IsOpen() const { return this->data != nullptr; }
+
+	// Hand the pages back early, the object is empty afterwards
+	void Release();
+
+private:
+	char* data;
+	std::uint64_t size;
+	std::uint64_t mapped_size;
+
+	// Fallback copy for files that can't be mapped with a spare zero byte
+	std::unique_ptr<char[]> fallback;
+
+#ifdef _WIN32
+	void* file_handle;
+	void* mapping_handle;
+#endif
+};
@@ -0,0 +1,155 @@
+#include <array>
+#include <csignal>
+#include <fstream>
+#include <sstream>
+
+#include "MemoryTelemetry.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	struct Counter
+	{
+		std::atomic<size_t> bytes{ 0 };
+		std::atomic<size_t> high_water{ 0 };
+	};
+
+	std::array<Counter, MemorySubsystemCount> subsystems;
+	Counter total;
+
+	// Set from the signal handler, lock free so that is allowed
+	volatile std::sig_atomic_t dump_requested = 0;
+
+	const char* const Names[MemorySubsystemCount] = { "actors", "views", "map", "images", "config", "rewind", "frame", "particles" };
+
+	void Raise(Counter& counter, size_t bytes)
+	{
+		const size_t now = counter.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+		size_t high = counter.high_water.load(std::memory_order_relaxed);
+		while (now > high && !counter.high_water.compare_exchange_weak(high, now, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void RequestDump(int)
+	{
+		dump_requested = 1;
+	}
+
+}
+
+MemoryTelemetry::Usage MemoryTelemetry::Get(MemorySubsystem subsystem)
+{
+	const Counter& counter = subsystems[static_cast<size_t>(subsystem)];
+	return Usage{ counter.bytes.load(std::memory_order_relaxed), counter.high_water.load(std::memory_order_relaxed) };
+}
+
+MemoryTelemetry::Usage MemoryTelemetry::GetTotal()
+{
+	return Usage{ total.bytes.load(std::memory_order_relaxed), total.high_water.load(std::memory_order_relaxed) };
+}
+
+const char* MemoryTelemetry::GetName(MemorySubsystem subsystem)
+{
+	return Names[static_cast<size_t>(subsystem)];
+}
+
+std::string MemoryTelemetry::ToJson()
+{
+	std::ostringstream json;
+	const Usage all = GetTotal();
+	json << "{\"total\":{\"bytes\":" << all.bytes << ",\"high_water\":" << all.high_water << "},\"subsystems\":{";
+	for (size_t k = 0; k < MemorySubsystemCount; ++k)
+	{
+		const Usage usage = Get(static_cast<MemorySubsystem>(k));
+		json << ((k > 0) ? "," : "") << "\"" << Names[k] << "\":{\"bytes\":" << usage.bytes << ",\"high_water\":" << usage.high_water << "}";
+	}
+	json << "}}";
+	return json.str();
+}
+
+bool MemoryTelemetry::WriteJson(const std::string& filename)
+{
+	auto logger = spdlog::get("EngineLogger");
+
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	out << ToJson() << '\n';
+	if (!out)
+	{
+		logger->error("Cannot write memory telemetry to {0}", filename);
+		return false;
+	}
+	logger->info("Memory telemetry written to {0}", filename);
+	return true;
+}
+
+void MemoryTelemetry::InstallDumpSignal()
+{
+#ifdef _WIN32
+	std::signal(SIGBREAK, RequestDump);
+#else
+	std::signal(SIGUSR1, RequestDump);
+#endif
+}
+
+bool MemoryTelemetry::TakeDumpRequest()
+{
+	if (dump_requested == 0)
+	{
+		return false;
+	}
+	dump_requested = 0;
+	return true;
+}
+
+void MemoryTelemetry::Add(MemorySubsystem subsystem, size_t bytes)
+{
+	Raise(subsystems[static_cast<size_t>(subsystem)], bytes);
+	Raise(total, bytes);
+}
+
+void MemoryTelemetry::Remove(MemorySubsystem subsystem, size_t bytes)
+{
+	subsystems[static_cast<size_t>(subsystem)].bytes.fetch_sub(bytes, std::memory_order_relaxed);
+	total.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemoryAccount::MemoryAccount(MemorySubsystem subsystem) : m_subsystem(subsystem), m_bytes(0)
+{}
+
+MemoryAccount::MemoryAccount(const MemoryAccount& other) : m_subsystem(other.m_subsystem), m_bytes(0)
+{
+	this->Set(other.Get());
+}
+
+MemoryAccount& MemoryAccount::operator=(const MemoryAccount& other)
+	// Stays with its own subsystem, only the size is copied
+{
+	this->Set(other.Get());
+	return *this;
+}
+
+MemoryAccount::~MemoryAccount()
+{
+	MemoryTelemetry::Remove(m_subsystem, m_bytes.load(std::memory_order_relaxed));
+}
+
+void MemoryAccount::Set(size_t bytes)
+{
+	const size_t before = m_bytes.exchange(bytes, std::memory_order_relaxed);
+	if (bytes > before)
+	{
+		MemoryTelemetry::Add(m_subsystem, bytes - before);
+	}
+	else if (bytes < before)
+	{
+		MemoryTelemetry::Remove(m_subsystem, before - bytes);
+	}
+}
+
+void MemoryAccount::Add(size_t bytes)
+{
+	m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	MemoryTelemetry::Add(m_subsystem, bytes);
+}
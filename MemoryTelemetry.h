@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+enum class MemorySubsystem { Actors, Views, Map, Images, Config, Rewind, Frame, Particles };
+constexpr size_t MemorySubsystemCount = 8;
+
+/// Bytes held by each subsystem, and the most each has held, for the
+///  whole process.  Subsystems report what they hold through a
+///  MemoryAccount, so the numbers are the storage they keep (capacities,
+///  surface pixels), not every allocation made on their behalf.
+///
+///  Safe from any thread.  A dump is requested with SIGUSR1 (SIGBREAK on
+///  Windows) once InstallDumpSignal has been called, whoever owns the
+///  main loop picks it up with TakeDumpRequest.
+///
+class MemoryTelemetry
+{
+public:
+	struct Usage
+	{
+		size_t bytes;
+		size_t high_water;
+	};
+
+	static Usage Get(MemorySubsystem subsystem);
+
+	// Every subsystem together, the high water is of the total itself
+	static Usage GetTotal();
+
+	static const char* GetName(MemorySubsystem subsystem);
+
+	// {"total":{"bytes":..,"high_water":..},"subsystems":{"actors":{..},..}}
+	static std::string ToJson();
+
+	// False if the file can't be written
+	static bool WriteJson(const std::string& filename);
+
+	static void InstallDumpSignal();
+	static bool TakeDumpRequest();
+
+private:
+	friend class MemoryAccount;
+
+	static void Add(MemorySubsystem subsystem, size_t bytes);
+	static void Remove(MemorySubsystem subsystem, size_t bytes);
+};
+
+/// What one object holds for its subsystem.  Owners set it whenever their
+///  storage changes size, whatever is set is taken back when it goes.
+///  Copies hold as much as what they were copied from.
+///
+class MemoryAccount
+{
+public:
+	explicit MemoryAccount(MemorySubsystem subsystem);
+	MemoryAccount(const MemoryAccount& other);
+	MemoryAccount& operator=(const MemoryAccount& other);
+	~MemoryAccount();
+
+	void Set(size_t bytes);
+	void Add(size_t bytes);
+	size_t Get() const { return m_bytes.load(std::memory_order_relaxed); }
+
+private:
+	MemorySubsystem m_subsystem;
+	std::atomic<size_t> m_bytes;
+};
@@ -1,13 +1,19 @@
 #include <algorithm>
 #include <iterator>
+#include <numeric>
 #include <stdexcept>
 #include <memory>
+#include <cmath>
 
 #include "Model.h"
 #include "View.h"
 #include "Controller.h"
+#include "TileCollision.h"
+#include "SimulationLod.h"
+#include "Prefab.h"
+#include "ActorSnapshot.h"
 
-Actors::Actors(size_t num_actors)
+Actors::Actors(size_t num_actors) : m_length(0), m_next_handle(0), m_reset(false), m_memory(MemorySubsystem::Actors)
 {
 	this->Reserve(num_actors);
 }
@@ -18,18 +24,36 @@ void Actors::Reserve(size_t num_actors)
 	m_md.reserve(num_actors);
 	m_types.reserve(num_actors);
 	m_attributes.reserve(num_actors);
+	m_handles.reserve(num_actors);
+	m_changes.reserve(num_actors);
 
+	this->Account();
 	return;
 }
 
-void Actors::Push(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib)
+void Actors::Account()
+{
+	m_memory.Set(m_pd.capacity() * sizeof(PositionData) + m_md.capacity() * sizeof(MovementData) +
+		m_types.capacity() * sizeof(ActorType) + m_attributes.capacity() * sizeof(std::bitset<32>) +
+		m_handles.capacity() * sizeof(ActorHandle) + m_changes.capacity() * sizeof(ChangeMask) +
+		m_changed.capacity() * sizeof(size_t) + m_structure.capacity() * sizeof(ActorDelta::Structural));
+}
+
+ActorHandle Actors::Push(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib)
 {
 	m_pd.push_back(pd);
 	m_md.push_back(md);
 	m_types.push_back(at);
 	m_attributes.push_back(attrib);
 
+	const ActorHandle handle = m_next_handle++;
+	m_handles.push_back(handle);
+	m_changes.push_back(AllChanged);
+	m_changed.push_back(m_length);
+	m_structure.push_back({ ActorDelta::Structural::Kind::Added, handle, m_length, 1 });
+
 	m_length++;
+	return handle;
 }
 
 void Actors::Swap(const size_t first, const size_t second)
@@ -40,6 +64,19 @@ void Actors::Swap(const size_t first, const size_t second)
 		std::iter_swap(std::next(m_md.begin(), first), std::next(m_md.begin(), second));
 		std::iter_swap(std::next(m_types.begin(), first), std::next(m_types.begin(), second));
 		std::iter_swap(std::next(m_attributes.begin(), first), std::next(m_attributes.begin(), second));
+		std::swap(m_handles[first], m_handles[second]);
+
+		// Marks move with their actors
+		std::swap(m_changes[first], m_changes[second]);
+		if (m_changes[first] != 0)
+		{
+			m_changed.push_back(first);
+		}
+		if (m_changes[second] != 0)
+		{
+			m_changed.push_back(second);
+		}
+		m_structure.push_back({ ActorDelta::Structural::Kind::Swapped, 0, first, second });
 	}
 	else
 	{
@@ -55,6 +92,156 @@ void Actors::Pop()
 	m_attributes.pop_back();
 
 	m_length--;
+	m_structure.push_back({ ActorDelta::Structural::Kind::Removed, m_handles.back(), m_length, 0 });
+	m_handles.pop_back();
+	m_changes.pop_back();
+}
+
+ActorHandle Actors::PushBulk(const size_t count, const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib)
+	// resize fills with block copies, no per actor push_back and no regrowth
+{
+	const size_t first = m_length;
+	const size_t length = first + count;
+	m_pd.resize(length, pd);
+	m_md.resize(length, md);
+	m_types.resize(length, at);
+	m_attributes.resize(length, attrib);
+
+	const ActorHandle handle = m_next_handle;
+	m_handles.resize(length);
+	std::iota(m_handles.begin() + first, m_handles.end(), handle);
+	m_next_handle += static_cast<ActorHandle>(count);
+
+	m_changes.resize(length, AllChanged);
+	m_changed.reserve(m_changed.size() + count);
+	for (size_t index = first; index < length; ++index)
+	{
+		m_changed.push_back(index);
+	}
+	m_structure.push_back({ ActorDelta::Structural::Kind::Added, handle, first, count });
+
+	m_length = length;
+	return handle;
+}
+
+void Actors::PlaceGrid(const size_t first, const size_t count, const SpawnGrid& grid)
+	// Row by row, so the inner loop is a plain run the compiler can vectorise.
+	//	Offsets are taken from the grid's block and only the whole blocks they
+	//	span are added to it, floats never hold a world position.
+{
+	if (grid.block_size <= 0)
+	{
+		throw std::invalid_argument("Spawn grid needs a positive block size");
+	}
+
+	const float block = static_cast<float>(grid.block_size);
+	const float inv_block = 1.0f / block;
+	const float last = std::nextafter(block, 0.0f);
+	const size_t columns = std::max<size_t>(grid.columns, 1);
+	PositionData* pd = m_pd.data() + first;
+
+	for (size_t begin = 0; begin < count; begin += columns)
+	{
+		const size_t end = std::min(count, begin + columns);
+		float y = grid.y + static_cast<float>(begin / columns) * grid.spacing_y;
+		const int dby = static_cast<int>(std::floor(y * inv_block));
+		y = std::min(y - dby * block, last);
+		for (size_t k = begin; k < end; ++k)
+		{
+			const float x = grid.x + static_cast<float>(k - begin) * grid.spacing_x;
+			const int dbx = static_cast<int>(std::floor(x * inv_block));
+			pd[k].bx = grid.bx + dbx;
+			pd[k].by = grid.by + dby;
+			pd[k].x = std::min(x - dbx * block, last);
+			pd[k].y = y;
+		}
+	}
+}
+
+void Actors::Restore(const size_t count, const ActorHandle* handles, ActorHandle next_handle)
+{
+	m_pd.resize(count);
+	m_md.resize(count);
+	m_types.resize(count);
+	m_attributes.resize(count);
+	m_handles.assign(handles, handles + count);
+	m_next_handle = next_handle;
+	m_length = count;
+
+	// Views start over, so nothing needs marking
+	m_changes.assign(count, 0);
+	m_changed.clear();
+	m_structure.clear();
+	m_reset = true;
+}
+
+void Actors::MarkChanged(const size_t index, ChangeMask fields)
+{
+	if (m_changes[index] == 0)
+	{
+		m_changed.push_back(index);
+	}
+	m_changes[index] |= fields;
+}
+
+void Actors::BuildDelta(ActorDelta& delta, std::pmr::memory_resource* scratch) const
+	// Marked indices become sorted runs of neighbours
+{
+	delta.reset = m_reset;
+	delta.structure = m_structure;
+	delta.changed.clear();
+	delta.length = m_length;
+	if (m_reset)
+	{
+		delta.structure.clear();
+		if (m_length > 0)
+		{
+			delta.changed.push_back({ 0, m_length, AllChanged });
+		}
+		return;
+	}
+
+	std::pmr::vector<size_t> indices(scratch);
+	indices.reserve(m_changed.size());
+	for (size_t index : m_changed)
+	{
+		if (index < m_length && m_changes[index] != 0)
+		{
+			indices.push_back(index);
+		}
+	}
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+	for (size_t index : indices)
+	{
+		if (!delta.changed.empty() && delta.changed.back().first + delta.changed.back().count == index)
+		{
+			delta.changed.back().count++;
+			delta.changed.back().fields |= m_changes[index];
+		}
+		else
+		{
+			delta.changed.push_back({ index, 1, m_changes[index] });
+		}
+	}
+}
+
+void Actors::ClearChanges()
+{
+	for (size_t index : m_changed)
+	{
+		if (index < m_length)
+		{
+			m_changes[index] = 0;
+		}
+	}
+	m_changed.clear();
+	m_structure.clear();
+	m_reset = false;
+
+	// Once a tick, whatever grew since
+	this->Account();
 }
 
 Model::Model(size_t num_actors): m_actors(num_actors)
@@ -69,6 +256,7 @@ Model::~Model() {}
 void Model::Attach(View* v) noexcept
 {
 	m_views.push_back(v);
+	m_new_views.push_back(v);
 }
 
 void Model::Detach(View* v) noexcept
@@ -83,36 +271,97 @@ void Model::Detach(View* v) noexcept
 	{
 		// Pass
 	}
+
+	auto n = std::find(m_new_views.begin(), m_new_views.end(), v);
+	if (n != m_new_views.end())
+	{
+		m_new_views.erase(n);
+	}
 }
 
-void Model::Notify() const
+void Model::Notify(std::pmr::memory_resource* scratch)
+	// Views do work in proportion to what changed, not to the number of actors
 {
+	m_actors.BuildDelta(m_delta, scratch);
+	if (!m_new_views.empty())
+	{
+		const size_t length = m_actors.GetLength();
+		m_full.reset = true;
+		m_full.structure.clear();
+		m_full.changed.clear();
+		if (length > 0)
+		{
+			m_full.changed.push_back({ 0, length, Actors::AllChanged });
+		}
+		m_full.length = length;
+	}
+
 	for (View* vp : m_views)
 	{
-		vp->UpdateView(m_actors);
+		const bool is_new = std::find(m_new_views.begin(), m_new_views.end(), vp) != m_new_views.end();
+		vp->UpdateView(m_actors, is_new ? m_full : m_delta);
 	}
+
+	m_new_views.clear();
+	m_actors.ClearChanges();
 }
 
-void Model::Simulate(Controller& c) const
+bool Model::Save(const std::string& filename) const
 {
-	c.Control(m_actors);
+	return ActorSnapshot::Save(filename, m_actors);
 }
 
-void Model::Apply(const std::vector<std::unique_ptr<Action>>& actions)
+bool Model::Load(const std::string& filename)
 {
-	for (const auto& a: actions)
+	return ActorSnapshot::Load(filename, m_actors);
+}
+
+void Model::Simulate(Controller& c, const SimulationLod* lod) const
+{
+	c.Control(m_actors, lod);
+}
+
+void Model::Apply(const ActionList& actions)
+{
+	for (const Action* a: actions)
 	{
 		a->Execute(m_actors);
 	}
 }
 
+void Model::Move(const SolidityMap& solidity, int tile_size, float dt)
+{
+	SweepActors(m_actors, solidity, tile_size, dt);
+}
+
+void Model::Move(const SolidityMap& solidity, int tile_size, float dt, const SimulationLod& lod)
+	// Only the actors that are due, each for the ticks it owes
+{
+	SweepActors(m_actors, solidity, tile_size, dt, lod.GetDue(), lod.GetDueTicks());
+}
+
 void Model::AddActor(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib)
 {
 	m_actors.Push(pd, md, at, attrib);
 }
 
+ActorHandle Model::SpawnActors(const Prefab& prefab, const size_t count, const SpawnGrid& grid)
+{
+	// Checked before anything is added, PlaceGrid would throw too late
+	if (grid.block_size <= 0)
+	{
+		throw std::invalid_argument("Spawn grid needs a positive block size");
+	}
+
+	const Actors::PositionData pd = { 0, 0, 0.0f, 0.0f, prefab.width, prefab.height };
+	const size_t first = m_actors.GetLength();
+	const ActorHandle handle = m_actors.PushBulk(count, pd, prefab.movement, prefab.type, prefab.attributes);
+	m_actors.PlaceGrid(first, count, grid);
+	return handle;
+}
+
 void Model::RemoveActor(const size_t index)
 {
-	m_actors.Swap(index, m_actors.GetLength());
+	m_actors.Swap(index, m_actors.GetLength() - 1);
 	m_actors.Pop();
 }
\ No newline at end of file
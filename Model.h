@@ -1,17 +1,72 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <bitset>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+
+#include "MemoryTelemetry.h"
 
 class View;
 class Controller;
-class Action;
+class ActionList;
+class SolidityMap;
+class SimulationLod;
+struct Prefab;
+struct SpawnGrid;
+
+using ActorHandle = std::uint32_t;
+
+/// What happened to the Actors since the last Model::Notify.  Views replay
+///  the structural changes in order (additions append, removals pop the
+///  last actor, swaps swap two), after which their arrays line up with the
+///  Actors again, then refresh the changed ranges.  Ranges use the indices
+///  after all structural changes and include everything added.
+///
+struct ActorDelta
+{
+	struct Structural
+	{
+		enum class Kind { Added, Removed, Swapped };
+
+		Kind kind;
+		ActorHandle handle;		// Added (the first), Removed
+		size_t index;
+		size_t other;			// Added: how many, with consecutive handles.  Swapped: the other index.
+	};
+
+	struct Range
+	{
+		size_t first;
+		size_t count;
+		std::uint8_t fields;	// Actors::ChangeMask of every actor in the range
+	};
+
+	// Everything is new, e.g. for a view that was just attached or after
+	//  a load.  Views start over with length actors and skip structure.
+	bool reset = false;
+
+	std::vector<Structural> structure;
+	std::vector<Range> changed;		// sorted
+	size_t length = 0;
+
+	bool IsEmpty() const { return !reset && structure.empty() && changed.empty(); }
+};
 
 class Actors
 {
 public:
 	Actors(size_t num_actors);
 
+	using ChangeMask = std::uint8_t;
+	static constexpr ChangeMask PositionChanged = 1;
+	static constexpr ChangeMask MovementChanged = 2;
+	static constexpr ChangeMask TypeChanged = 4;
+	static constexpr ChangeMask AttributesChanged = 8;
+	static constexpr ChangeMask AllChanged = 15;
+
 	enum class ActorType { Player, Rock, Stick };
 
 	struct PositionData
@@ -33,14 +88,57 @@ public:
 	std::vector<std::bitset<32>> m_attributes;
 
 	void Reserve(size_t num_actors);
-	void Push(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib);
+	ActorHandle Push(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib);
 	void Swap(const size_t first, const size_t second);
 	void Pop();
 
+	// Appends count copies in one go, every array grows once.  Returns the
+	//  handle of the first, the rest follow on.
+	ActorHandle PushBulk(const size_t count, const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib);
+
+	// Lays out actors [first, first + count) on the grid.  PushBulk already
+	//  marked them.  Throws std::invalid_argument if the block size isn't
+	//  positive.
+	void PlaceGrid(const size_t first, const size_t count, const SpawnGrid& grid);
+
 	size_t GetLength() const { return m_length; }
+	ActorHandle GetHandle(const size_t index) const { return m_handles[index]; }
+	const ActorHandle* GetHandles() const { return m_handles.data(); }
+	ActorHandle GetNextHandle() const { return m_next_handle; }
+
+	// Replaces every actor, for loading saved state.  The arrays are
+	//  resized to count for the caller to fill, handles are copied.  Views
+	//  start over.  Doesn't allocate if the arrays are big enough already.
+	void Restore(const size_t count, const ActorHandle* handles, ActorHandle next_handle);
+
+	// Anything that writes the arrays directly has to say what it changed,
+	//  views only hear about what is marked
+	void MarkChanged(const size_t index, ChangeMask fields);
+
+	// Changes since the last ClearChanges, into delta so its storage is
+	//  reused.  Sorting the marked indices takes scratch memory from scratch.
+	void BuildDelta(ActorDelta& delta, std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) const;
+	void ClearChanges();
 
 private:
 	size_t m_length;
+
+	// Handles stay with their actor through swaps, never reused
+	std::vector<ActorHandle> m_handles;
+	ActorHandle m_next_handle;
+
+	// Per actor, plus the indices marked since the last ClearChanges.  The
+	//  list may repeat indices or hold ones popped since.
+	std::vector<ChangeMask> m_changes;
+	std::vector<size_t> m_changed;
+	std::vector<ActorDelta::Structural> m_structure;
+
+	// Restored since the last ClearChanges
+	bool m_reset;
+
+	// Capacity of every array, brought up to date by Reserve and ClearChanges
+	void Account();
+	MemoryAccount m_memory;
 };
 
 /// Model base class, knows about the data, but not how to view
@@ -56,16 +154,31 @@ public:
 	~Model();
 	void Attach(View* v) noexcept;
 	void Detach(View* v) noexcept;
-	void Notify() const;
 
-	void Simulate(Controller& control) const;
-	void Apply(const std::vector<std::unique_ptr<Action>>& actions);
+	// Once per tick, views get what changed since the last call.  Scratch
+	//  memory comes from scratch and isn't needed after.
+	void Notify(std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	// lod is optional, updated for this tick, see SimulationLod
+	void Simulate(Controller& control, const SimulationLod* lod = nullptr) const;
+	void Apply(const ActionList& actions);
+	void Move(const SolidityMap& solidity, int tile_size, float dt);
+	void Move(const SolidityMap& solidity, int tile_size, float dt, const SimulationLod& lod);
+
+	// Quick save and load of every actor, see ActorSnapshot.  A failed load
+	//  leaves the actors as they were.
+	bool Save(const std::string& filename) const;
+	bool Load(const std::string& filename);
 
 protected:
 	
 	friend class Game;
 	void AddActor(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib);
 	void RemoveActor(const size_t index);
+
+	// count actors made from prefab, laid out on grid.  Returns the handle
+	//  of the first, the rest follow on.
+	ActorHandle SpawnActors(const Prefab& prefab, const size_t count, const SpawnGrid& grid);
 	
 private:
 
@@ -76,4 +189,9 @@ private:
 	Actors				m_actors;
 	std::vector<View*>	m_views;
 
+	// Attached since the last Notify, they get everything once
+	std::vector<View*>	m_new_views;
+	ActorDelta			m_delta;
+	ActorDelta			m_full;
+
 };
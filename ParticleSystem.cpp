@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include "ParticleSystem.h"
+#include "ConfigFileInterface.h"
+#include "ConfigSchema.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	constexpr auto EmitterSchema = ConfigFile::MakeSchema<ParticleEmitter>("emitter",
+		ConfigFile::Required("name", &ParticleEmitter::name, 1, 64),
+		ConfigFile::Optional("rate", &ParticleEmitter::rate, 0.0f, 0.0f, 1.0e6f),
+		ConfigFile::Required("life", &ParticleEmitter::life, 0.001f, 600.0f),
+		ConfigFile::Optional("life_jitter", &ParticleEmitter::life_jitter, 0.0f, 0.0f, 600.0f),
+		ConfigFile::Optional("speed", &ParticleEmitter::speed, 0.0f),
+		ConfigFile::Optional("speed_jitter", &ParticleEmitter::speed_jitter, 0.0f, 0.0f),
+		ConfigFile::Optional("direction", &ParticleEmitter::direction, 0.0f),
+		ConfigFile::Optional("spread", &ParticleEmitter::spread, 360.0f, 0.0f, 360.0f),
+		ConfigFile::Optional("ax", &ParticleEmitter::ax, 0.0f),
+		ConfigFile::Optional("ay", &ParticleEmitter::ay, 0.0f),
+		ConfigFile::Optional("fade", &ParticleEmitter::fade, true),
+		ConfigFile::Optional("frame", &ParticleEmitter::frame, 0, 0, 65535)).Strict();
+
+	constexpr float Pi = 3.14159265f;
+
+	// Jitter never takes a particle's life below this
+	constexpr float MinimumLife = 0.001f;
+
+	size_t Advance(size_t count, float dt, float* __restrict x, float* __restrict y,
+		float* __restrict vx, float* __restrict vy, const float* __restrict ax, const float* __restrict ay,
+		float* __restrict age, const float* __restrict life, const float* __restrict fade_rate, float* __restrict fade)
+		// Returns how many are still alive.  No branches and no calls, and the
+		//  arrays can't overlap, so this vectorises, eight particles at a time
+		//  with AVX.  Dead particles move along with the rest, it costs less
+		//  than skipping them.
+	{
+		size_t live = 0;
+		for (size_t k = 0; k < count; ++k)
+		{
+			vx[k] += ax[k] * dt;
+			vy[k] += ay[k] * dt;
+			x[k] += vx[k] * dt;
+			y[k] += vy[k] * dt;
+			age[k] += dt;
+			fade[k] = std::max(0.0f, 1.0f - age[k] * fade_rate[k]);
+			live += (age[k] < life[k]) ? 1 : 0;
+		}
+		return live;
+	}
+
+}
+
+ParticleSystem::ParticleSystem(size_t capacity, std::uint32_t seed) :
+	m_capacity(capacity), m_head(0), m_count(0), m_random(seed), m_stats{ 0, 0, 0, 0 },
+	m_memory(MemorySubsystem::Particles)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("ParticleSystem::ParticleSystem(size_t capacity, std::uint32_t seed)");
+
+	if (capacity == 0)
+	{
+		throw std::invalid_argument("A particle system needs room for at least one particle");
+	}
+
+	for (auto field : { &m_x, &m_y, &m_vx, &m_vy, &m_ax, &m_ay, &m_age, &m_life, &m_fade_rate, &m_fade })
+	{
+		field->assign(capacity, 0.0f);
+	}
+	m_frame.assign(capacity, 0);
+	m_visible.resize(capacity);
+	m_keys.resize(capacity);
+	m_order.resize(capacity);
+	m_running.reserve(16);
+
+	m_memory.Set(capacity * (10 * sizeof(float) + sizeof(std::uint16_t) + 3 * sizeof(std::uint32_t)));
+}
+
+void ParticleSystem::Load(const ConfigFile::ConfigObject& particles)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("ParticleSystem::Load(const ConfigFile::ConfigObject& particles)");
+
+	std::map<std::string, ParticleEmitter> loaded;
+	std::vector<ConfigFile::ConfigError> errors;
+	size_t position = 0;
+	for (auto child : particles.GetChildren())
+	{
+		if (child.GetName() != "emitter")
+		{
+			continue;
+		}
+		position++;
+
+		ParticleEmitter emitter = {};
+		const size_t first_error = errors.size();
+		EmitterSchema.Bind(child, emitter, errors);
+
+		if (!emitter.name.empty() && loaded.count(emitter.name) != 0)
+		{
+			errors.push_back({ "emitter", "name", "\"" + emitter.name + "\" is defined twice" });
+		}
+
+		// Several emitters share the node name, say which one
+		for (size_t k = first_error; k < errors.size(); ++k)
+		{
+			errors[k].node = "emitter[" + std::to_string(position) + "]";
+		}
+		if (errors.size() == first_error)
+		{
+			loaded[emitter.name] = std::move(emitter);
+		}
+	}
+
+	if (!errors.empty())
+	{
+		std::string message;
+		for (const auto& error : errors)
+		{
+			message += (message.empty() ? "" : "\n") + error.ToString();
+		}
+		logger->error("Bad particle configuration:\n{0}", message);
+		throw ConfigFile::ConfigFileException(message, "particles", "");
+	}
+
+	if (particles.HasAttribute("atlas"))
+	{
+		m_atlas_name = std::string(particles.GetAttribute("atlas"));
+	}
+	for (auto& emitter : loaded)
+	{
+		m_emitters[emitter.first] = std::move(emitter.second);
+	}
+	logger->info("{0} particle emitters loaded", loaded.size());
+}
+
+const ParticleEmitter* ParticleSystem::Find(const std::string& name) const
+{
+	auto emitter = m_emitters.find(name);
+	return (emitter == m_emitters.end()) ? nullptr : &emitter->second;
+}
+
+void ParticleSystem::Burst(const ParticleEmitter& emitter, float x, float y, size_t count)
+{
+	this->Emit(emitter, x, y, count);
+}
+
+ParticleSystem::EmitterId ParticleSystem::Start(const ParticleEmitter& emitter, float x, float y)
+{
+	const Running running{ &emitter, x, y, 0.0f, true };
+	for (size_t id = 0; id < m_running.size(); ++id)
+	{
+		if (!m_running[id].active)
+		{
+			m_running[id] = running;
+			return id;
+		}
+	}
+	m_running.push_back(running);
+	return m_running.size() - 1;
+}
+
+void ParticleSystem::Move(EmitterId id, float x, float y)
+{
+	if (id >= m_running.size() || !m_running[id].active)
+	{
+		throw std::invalid_argument("No running emitter " + std::to_string(id));
+	}
+	m_running[id].x = x;
+	m_running[id].y = y;
+}
+
+void ParticleSystem::Stop(EmitterId id)
+{
+	if (id >= m_running.size() || !m_running[id].active)
+	{
+		throw std::invalid_argument("No running emitter " + std::to_string(id));
+	}
+	m_running[id].active = false;
+}
+
+void ParticleSystem::Emit(const ParticleEmitter& emitter, float x, float y, size_t count)
+	// At the head, pushing the tail along once the ring is full
+{
+	// Any more would only overwrite the ones emitted first
+	count = std::min(count, m_capacity);
+
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (size_t n = 0; n < count; ++n)
+	{
+		const size_t k = m_head;
+		if (m_count == m_capacity)
+		{
+			if (m_age[k] < m_life[k])
+			{
+				m_stats.overwritten++;
+			}
+		}
+		else
+		{
+			m_count++;
+		}
+		m_head = (m_head + 1 == m_capacity) ? 0 : m_head + 1;
+
+		const float life = std::max(MinimumLife, emitter.life + emitter.life_jitter * unit(m_random));
+		const float speed = emitter.speed + emitter.speed_jitter * unit(m_random);
+		const float angle = (emitter.direction + 0.5f * emitter.spread * unit(m_random)) * (Pi / 180.0f);
+
+		m_x[k] = x;
+		m_y[k] = y;
+		m_vx[k] = speed * std::cos(angle);
+		m_vy[k] = speed * std::sin(angle);
+		m_ax[k] = emitter.ax;
+		m_ay[k] = emitter.ay;
+		m_age[k] = 0.0f;
+		m_life[k] = life;
+		m_fade_rate[k] = emitter.fade ? 1.0f / life : 0.0f;
+		m_fade[k] = 1.0f;
+		m_frame[k] = static_cast<std::uint16_t>(emitter.frame);
+	}
+}
+
+void ParticleSystem::Integrate(size_t first, size_t last, float dt)
+{
+	m_stats.live += Advance(last - first, dt, &m_x[first], &m_y[first], &m_vx[first], &m_vy[first],
+		&m_ax[first], &m_ay[first], &m_age[first], &m_life[first], &m_fade_rate[first], &m_fade[first]);
+}
+
+void ParticleSystem::Update(float dt)
+{
+	for (auto& running : m_running)
+	{
+		if (!running.active)
+		{
+			continue;
+		}
+		running.owed += running.emitter->rate * dt;
+		const float whole = std::floor(running.owed);
+		running.owed -= whole;
+		this->Emit(*running.emitter, running.x, running.y, static_cast<size_t>(whole));
+	}
+
+	// The ring is at most two spans of the arrays
+	m_stats.live = 0;
+	const size_t tail = this->TailIndex();
+	if (tail + m_count <= m_capacity)
+	{
+		this->Integrate(tail, tail + m_count, dt);
+	}
+	else
+	{
+		this->Integrate(tail, m_capacity, dt);
+		this->Integrate(0, m_head, dt);
+	}
+
+	// Take back the dead at the tail, those further in wait their turn
+	size_t k = tail;
+	while (m_count > 0 && m_age[k] >= m_life[k])
+	{
+		m_count--;
+		k = (k + 1 == m_capacity) ? 0 : k + 1;
+	}
+}
+
+void ParticleSystem::Draw(SDL_Surface* target, SDL_Surface* atlas, float view_x, float view_y)
+{
+	m_stats.drawn = 0;
+	m_stats.batches = 0;
+	if (target == nullptr || atlas == nullptr || atlas->h <= 0 || atlas->w < atlas->h)
+	{
+		return;
+	}
+
+	const int cell = atlas->h;
+	const size_t cells = static_cast<size_t>(atlas->w / cell);
+	const size_t buckets = cells * FadeLevels;
+	if (m_batch_start.size() < buckets + 1)
+	{
+		m_batch_start.resize(buckets + 1);
+	}
+	std::fill(m_batch_start.begin(), m_batch_start.begin() + buckets + 1, 0);
+
+	// Cull, and key what is left by cell and fade level
+	const float half = 0.5f * cell;
+	const float left = view_x - half;
+	const float top = view_y - half;
+	const float right = view_x + target->w + half;
+	const float bottom = view_y + target->h + half;
+	size_t visible = 0;
+	for (size_t n = 0, k = this->TailIndex(); n < m_count; ++n, k = (k + 1 == m_capacity) ? 0 : k + 1)
+	{
+		if (m_age[k] >= m_life[k] || m_x[k] <= left || m_x[k] >= right || m_y[k] <= top || m_y[k] >= bottom)
+		{
+			continue;
+		}
+		const size_t frame = std::min<size_t>(m_frame[k], cells - 1);
+		const int level = std::min(FadeLevels - 1, static_cast<int>(m_fade[k] * FadeLevels));
+		const std::uint32_t key = static_cast<std::uint32_t>(frame * FadeLevels + level);
+		m_visible[visible] = static_cast<std::uint32_t>(k);
+		m_keys[visible] = key;
+		m_batch_start[key + 1]++;
+		visible++;
+	}
+
+	// Counting sort into batches
+	for (size_t key = 0; key < buckets; ++key)
+	{
+		m_batch_start[key + 1] += m_batch_start[key];
+	}
+	for (size_t n = 0; n < visible; ++n)
+	{
+		m_order[m_batch_start[m_keys[n]]++] = m_visible[n];
+	}
+
+	// Placing moved every start along to the next, so a batch now ends where it started
+	SDL_SetSurfaceBlendMode(atlas, SDL_BLENDMODE_BLEND);
+	size_t start = 0;
+	for (size_t key = 0; key < buckets; ++key)
+	{
+		const size_t end = m_batch_start[key];
+		if (end == start)
+		{
+			continue;
+		}
+
+		const int level = static_cast<int>(key % FadeLevels);
+		const SDL_Rect source{ static_cast<int>(key / FadeLevels) * cell, 0, cell, cell };
+		SDL_SetSurfaceAlphaMod(atlas, static_cast<Uint8>((level + 1) * 255 / FadeLevels));
+		for (size_t n = start; n < end; ++n)
+		{
+			const size_t k = m_order[n];
+			// Blitting clips place, so it's made afresh each time
+			SDL_Rect place{ static_cast<int>(std::floor(m_x[k] - view_x - half)), static_cast<int>(std::floor(m_y[k] - view_y - half)), cell, cell };
+			SDL_BlitSurface(atlas, &source, target, &place);
+		}
+		m_stats.batches++;
+		start = end;
+	}
+	SDL_SetSurfaceAlphaMod(atlas, 255);
+	m_stats.drawn = visible;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <cstdint>
+
+#include "SDL.h"
+#include "MemoryTelemetry.h"
+
+namespace ConfigFile {
+	class ConfigObject;
+}
+
+/// How an emitter sends out particles.  Defined in config under a
+///  <particles> node, which names the atlas they are drawn from:
+///
+///		<particles atlas="particles.png">
+///			<emitter name="dust" rate="200" life="0.8" life_jitter="0.2"
+///				speed="40" speed_jitter="20" direction="270" spread="90"
+///				ax="0" ay="60" fade="1" frame="0"/>
+///		</particles>
+///
+///  rate is particles a second for emitters that run, life in seconds,
+///  speed in pixels a second, direction and spread (the whole cone) in
+///  degrees with 0 along x and 90 down the screen.  frame is the cell of
+///  the atlas, a strip of square cells as high as the atlas.  Particles
+///  that fade go from opaque to clear over their life.
+///
+struct ParticleEmitter
+{
+	std::string name;
+	float rate;
+	float life;
+	float life_jitter;
+	float speed;
+	float speed_jitter;
+	float direction;
+	float spread;
+	float ax, ay;
+	bool fade;
+	int frame;
+};
+
+/// Effects that don't need to be Actors: no types, attributes, handles or
+///  views, just a fixed number of particles laid out like the Actors, one
+///  array per field.  Storage is a ring, new particles go at the head and
+///  dead ones are taken back at the tail, and when it is full the oldest
+///  particle makes way.  Update is a straight pass over the arrays the
+///  compiler vectorises.
+///
+///  Draw culls to the target and sorts what is left into batches of the
+///  same atlas cell and fade level, so the atlas state changes once per
+///  batch rather than once per particle.
+///
+///  Positions are world pixels.  Not for the simulation, particles are
+///  updated with the frame time and never replicated or recorded.
+///
+class ParticleSystem
+{
+public:
+	using EmitterId = size_t;
+
+	struct Stats
+	{
+		size_t live;
+		size_t drawn;
+		size_t batches;
+		std::uint64_t overwritten;	// Particles that made way before they died
+	};
+
+	// Throws std::invalid_argument for no capacity
+	explicit ParticleSystem(size_t capacity, std::uint32_t seed = 0);
+
+	// Adds every emitter under a <particles> node, replacing emitters of the
+	//  same name.  Throws ConfigFileException listing every problem, in which
+	//  case nothing is added.
+	void Load(const ConfigFile::ConfigObject& particles);
+
+	// nullptr if there is no such emitter
+	const ParticleEmitter* Find(const std::string& name) const;
+	const std::string& GetAtlasName() const { return m_atlas_name; }
+
+	// count particles at once
+	void Burst(const ParticleEmitter& emitter, float x, float y, size_t count);
+
+	// Emits at the emitter's rate until stopped.  The emitter must stay
+	//  loaded while it runs.
+	EmitterId Start(const ParticleEmitter& emitter, float x, float y);
+	void Move(EmitterId id, float x, float y);
+	void Stop(EmitterId id);
+
+	void Update(float dt);
+
+	// Everything that shows on target, whose top left corner is at world
+	//  (view_x, view_y)
+	void Draw(SDL_Surface* target, SDL_Surface* atlas, float view_x, float view_y);
+
+	size_t GetCapacity() const { return m_capacity; }
+	const Stats& GetStats() const { return m_stats; }
+
+	// Fade is drawn in this many steps, each a batch of its own
+	static constexpr int FadeLevels = 8;
+
+private:
+	struct Running
+	{
+		const ParticleEmitter* emitter;
+		float x, y;
+		float owed;		// Fraction of a particle carried to the next update
+		bool active;
+	};
+
+	void Emit(const ParticleEmitter& emitter, float x, float y, size_t count);
+	void Integrate(size_t first, size_t last, float dt);
+	size_t TailIndex() const { return (m_head + m_capacity - m_count) % m_capacity; }
+
+	size_t m_capacity;
+	size_t m_head;		// Where the next particle goes
+	size_t m_count;		// Slots from the tail up to the head, dead or alive
+
+	// Per particle.  fade_rate is zero for particles that don't fade.
+	std::vector<float> m_x, m_y;
+	std::vector<float> m_vx, m_vy;
+	std::vector<float> m_ax, m_ay;
+	std::vector<float> m_age, m_life;
+	std::vector<float> m_fade_rate, m_fade;
+	std::vector<std::uint16_t> m_frame;
+
+	std::map<std::string, ParticleEmitter> m_emitters;
+	std::string m_atlas_name;
+	std::vector<Running> m_running;
+	std::mt19937 m_random;
+
+	// Scratch for Draw, kept to reuse the storage: the particles that show
+	//  with their batch keys, then sorted by key, and where each batch starts
+	std::vector<std::uint32_t> m_visible;
+	std::vector<std::uint32_t> m_keys;
+	std::vector<std::uint32_t> m_order;
+	std::vector<std::uint32_t> m_batch_start;
+
+	Stats m_stats;
+	MemoryAccount m_memory;
+};
@@ -0,0 +1,117 @@
+#include "Prefab.h"
+#include "ConfigFileInterface.h"
+#include "ConfigSchema.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	struct PrefabNode
+		// A <prefab> node as written, turned into a Prefab once it checks out
+	{
+		std::string name;
+		std::string type;
+		unsigned int attributes;
+		int width;
+		int height;
+		float vx, vy;
+		float ax, ay;
+	};
+
+	constexpr auto PrefabSchema = ConfigFile::MakeSchema<PrefabNode>("prefab",
+		ConfigFile::Required("name", &PrefabNode::name, 1, 64),
+		ConfigFile::Required("type", &PrefabNode::type, 1, 16),
+		ConfigFile::Optional("attributes", &PrefabNode::attributes, 0u),
+		ConfigFile::Required("width", &PrefabNode::width, 1, 4096),
+		ConfigFile::Required("height", &PrefabNode::height, 1, 4096),
+		ConfigFile::Optional("vx", &PrefabNode::vx, 0.0f),
+		ConfigFile::Optional("vy", &PrefabNode::vy, 0.0f),
+		ConfigFile::Optional("ax", &PrefabNode::ax, 0.0f),
+		ConfigFile::Optional("ay", &PrefabNode::ay, 0.0f)).Strict();
+
+	const std::map<std::string, Actors::ActorType> ActorTypeNames = {
+		{ "player", Actors::ActorType::Player },
+		{ "rock", Actors::ActorType::Rock },
+		{ "stick", Actors::ActorType::Stick }
+	};
+
+}
+
+PrefabLibrary::PrefabLibrary()
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("PrefabLibrary::PrefabLibrary()");
+}
+
+void PrefabLibrary::Load(const ConfigFile::ConfigObject& prefabs)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("PrefabLibrary::Load(const ConfigFile::ConfigObject& prefabs)");
+
+	std::map<std::string, Prefab> loaded;
+	std::vector<ConfigFile::ConfigError> errors;
+	size_t position = 0;
+	for (auto child : prefabs.GetChildren())
+	{
+		if (child.GetName() != "prefab")
+		{
+			continue;
+		}
+		position++;
+
+		PrefabNode node = {};
+		const size_t first_error = errors.size();
+		PrefabSchema.Bind(child, node, errors);
+
+		auto type = ActorTypeNames.find(node.type);
+		if (!node.type.empty() && type == ActorTypeNames.end())
+		{
+			errors.push_back({ "prefab", "type", "unknown actor type \"" + node.type + "\"" });
+		}
+		if (!node.name.empty() && loaded.count(node.name) != 0)
+		{
+			errors.push_back({ "prefab", "name", "\"" + node.name + "\" is defined twice" });
+		}
+
+		// Several prefabs share the node name, say which one
+		for (size_t k = first_error; k < errors.size(); ++k)
+		{
+			errors[k].node = "prefab[" + std::to_string(position) + "]";
+		}
+		if (errors.size() != first_error)
+		{
+			continue;
+		}
+
+		Prefab& prefab = loaded[node.name];
+		prefab.name = node.name;
+		prefab.type = type->second;
+		prefab.attributes = std::bitset<32>(node.attributes);
+		prefab.width = node.width;
+		prefab.height = node.height;
+		prefab.movement = Actors::MovementData{ node.vx, node.vy, node.ax, node.ay };
+	}
+
+	if (!errors.empty())
+	{
+		std::string message;
+		for (const auto& error : errors)
+		{
+			message += (message.empty() ? "" : "\n") + error.ToString();
+		}
+		logger->error("Bad prefab configuration:\n{0}", message);
+		throw ConfigFile::ConfigFileException(message, "prefabs", "");
+	}
+
+	for (auto& prefab : loaded)
+	{
+		m_prefabs[prefab.first] = std::move(prefab.second);
+	}
+	logger->info("{0} prefabs loaded", loaded.size());
+}
+
+const Prefab* PrefabLibrary::Find(const std::string& name) const
+{
+	auto prefab = m_prefabs.find(name);
+	return (prefab == m_prefabs.end()) ? nullptr : &prefab->second;
+}
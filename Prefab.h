@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <bitset>
+
+#include "Model.h"
+
+namespace ConfigFile {
+	class ConfigObject;
+}
+
+/// Template for actors spawned in bulk.  Defined in config under a
+///  <prefabs> node, one <prefab> each:
+///
+///		<prefabs>
+///			<prefab name="rock" type="rock" attributes="5" width="32" height="32"
+///				vx="0" vy="0"/>
+///		</prefabs>
+///
+///  type is player, rock or stick.  Movement and attributes default to
+///  zero.
+///
+struct Prefab
+{
+	std::string name;
+	Actors::ActorType type;
+	std::bitset<32> attributes;
+	int width;
+	int height;
+	Actors::MovementData movement;
+};
+
+/// Where a bulk spawn puts its actors: a grid columns wide, starting at
+///  offset (x, y) inside block (bx, by) and filling row by row.
+///
+struct SpawnGrid
+{
+	int bx, by;
+	float x, y;
+	unsigned int columns;
+	float spacing_x, spacing_y;
+	int block_size;
+};
+
+class PrefabLibrary
+{
+public:
+	PrefabLibrary();
+
+	// Adds every prefab under a <prefabs> node, replacing prefabs of the
+	//  same name.  Throws ConfigFileException listing every problem, in
+	//  which case nothing is added.
+	void Load(const ConfigFile::ConfigObject& prefabs);
+
+	// nullptr if there is no such prefab
+	const Prefab* Find(const std::string& name) const;
+	size_t GetCount() const { return m_prefabs.size(); }
+
+private:
+	std::map<std::string, Prefab> m_prefabs;
+};
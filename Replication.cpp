@@ -0,0 +1,697 @@
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <cmath>
+
+#include "Replication.h"
+#include "BitStream.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	// Server to client: 'R' 'S', kind, reserved, sequence, baseline (0 for
+	//	none), number of entries, then the bit packed entries
+	constexpr size_t SnapshotHeaderSize = 14;
+
+	// Client to server: 'R' 'C', kind, reserved, acknowledged sequence,
+	//	interest bx, by and radius
+	constexpr size_t AcknowledgementSize = 18;
+
+	constexpr std::uint8_t SnapshotKind = 1;
+	constexpr std::uint8_t AcknowledgementKind = 1;
+
+	// Entries of a snapshot, two bits each
+	constexpr std::uint32_t CreateEntry = 0;
+	constexpr std::uint32_t UpdateEntry = 1;
+	constexpr std::uint32_t RemoveEntry = 2;
+
+	// Interest is looked up block by block, keep it sane
+	constexpr int MaxRadius = 64;
+
+	constexpr float PositionScale = 16.0f;
+	constexpr float MovementScale = 256.0f;
+
+	void PutU16(std::vector<std::uint8_t>& out, std::uint16_t value)
+	{
+		out.push_back(static_cast<std::uint8_t>(value));
+		out.push_back(static_cast<std::uint8_t>(value >> 8));
+	}
+
+	void PutU32(std::vector<std::uint8_t>& out, std::uint32_t value)
+	{
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			out.push_back(static_cast<std::uint8_t>(value >> shift));
+		}
+	}
+
+	std::uint16_t GetU16(const std::uint8_t* in)
+	{
+		return static_cast<std::uint16_t>(in[0] | (in[1] << 8));
+	}
+
+	std::uint32_t GetU32(const std::uint8_t* in)
+	{
+		return static_cast<std::uint32_t>(in[0]) | (static_cast<std::uint32_t>(in[1]) << 8) |
+			(static_cast<std::uint32_t>(in[2]) << 16) | (static_cast<std::uint32_t>(in[3]) << 24);
+	}
+
+	std::uint64_t BlockKey(int bx, int by)
+	{
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(bx)) << 32) | static_cast<std::uint32_t>(by);
+	}
+
+	ReplicatedActor Quantize(const Actors& actors, size_t index)
+	{
+		const auto& pd = actors.m_pd[index];
+		const auto& md = actors.m_md[index];
+		return ReplicatedActor{
+			actors.GetHandle(index),
+			pd.bx, pd.by,
+			static_cast<std::int32_t>(std::lround(pd.x * PositionScale)), static_cast<std::int32_t>(std::lround(pd.y * PositionScale)),
+			pd.w, pd.h,
+			static_cast<std::int32_t>(std::lround(md.vx * MovementScale)), static_cast<std::int32_t>(std::lround(md.vy * MovementScale)),
+			static_cast<std::int32_t>(std::lround(md.ax * MovementScale)), static_cast<std::int32_t>(std::lround(md.ay * MovementScale)),
+			static_cast<std::uint32_t>(actors.m_types[index]),
+			static_cast<std::uint32_t>(actors.m_attributes[index].to_ulong())
+		};
+	}
+
+	void Dequantize(const ReplicatedActor& actor, Actors::PositionData& pd, Actors::MovementData& md)
+	{
+		pd = Actors::PositionData{ actor.bx, actor.by, actor.x / PositionScale, actor.y / PositionScale, actor.w, actor.h };
+		md = Actors::MovementData{ actor.vx / MovementScale, actor.vy / MovementScale, actor.ax / MovementScale, actor.ay / MovementScale };
+	}
+
+	Actors::ActorType ToActorType(std::uint32_t type)
+	{
+		// Anything the server made up is a rock
+		return (type <= static_cast<std::uint32_t>(Actors::ActorType::Stick)) ? static_cast<Actors::ActorType>(type) : Actors::ActorType::Rock;
+	}
+
+	Actors::ChangeMask Differences(const ReplicatedActor& a, const ReplicatedActor& b)
+	{
+		Actors::ChangeMask mask = 0;
+		if (a.bx != b.bx || a.by != b.by || a.x != b.x || a.y != b.y || a.w != b.w || a.h != b.h)
+		{
+			mask |= Actors::PositionChanged;
+		}
+		if (a.vx != b.vx || a.vy != b.vy || a.ax != b.ax || a.ay != b.ay)
+		{
+			mask |= Actors::MovementChanged;
+		}
+		if (a.type != b.type)
+		{
+			mask |= Actors::TypeChanged;
+		}
+		if (a.attributes != b.attributes)
+		{
+			mask |= Actors::AttributesChanged;
+		}
+		return mask;
+	}
+
+	void WriteDifference(BitWriter& writer, std::int32_t now, std::int32_t before)
+	{
+		writer.WriteSigned(static_cast<std::int64_t>(now) - before);
+	}
+
+	std::int32_t ReadDifference(BitReader& reader, std::int32_t before)
+	{
+		return static_cast<std::int32_t>(before + reader.ReadSigned());
+	}
+
+	void WriteActor(BitWriter& writer, const ReplicatedActor& now, const ReplicatedActor& before, Actors::ChangeMask mask)
+		// Against before, whole when before is all zeros
+	{
+		if (mask & Actors::PositionChanged)
+		{
+			WriteDifference(writer, now.bx, before.bx);
+			WriteDifference(writer, now.by, before.by);
+			WriteDifference(writer, now.x, before.x);
+			WriteDifference(writer, now.y, before.y);
+			WriteDifference(writer, now.w, before.w);
+			WriteDifference(writer, now.h, before.h);
+		}
+		if (mask & Actors::MovementChanged)
+		{
+			WriteDifference(writer, now.vx, before.vx);
+			WriteDifference(writer, now.vy, before.vy);
+			WriteDifference(writer, now.ax, before.ax);
+			WriteDifference(writer, now.ay, before.ay);
+		}
+		if (mask & Actors::TypeChanged)
+		{
+			writer.WriteUnsigned(now.type);
+		}
+		if (mask & Actors::AttributesChanged)
+		{
+			writer.Write(now.attributes, 32);
+		}
+	}
+
+	void ReadActor(BitReader& reader, ReplicatedActor& actor, Actors::ChangeMask mask)
+		// Onto what actor holds already
+	{
+		if (mask & Actors::PositionChanged)
+		{
+			actor.bx = ReadDifference(reader, actor.bx);
+			actor.by = ReadDifference(reader, actor.by);
+			actor.x = ReadDifference(reader, actor.x);
+			actor.y = ReadDifference(reader, actor.y);
+			actor.w = ReadDifference(reader, actor.w);
+			actor.h = ReadDifference(reader, actor.h);
+		}
+		if (mask & Actors::MovementChanged)
+		{
+			actor.vx = ReadDifference(reader, actor.vx);
+			actor.vy = ReadDifference(reader, actor.vy);
+			actor.ax = ReadDifference(reader, actor.ax);
+			actor.ay = ReadDifference(reader, actor.ay);
+		}
+		if (mask & Actors::TypeChanged)
+		{
+			actor.type = static_cast<std::uint32_t>(reader.ReadUnsigned());
+		}
+		if (mask & Actors::AttributesChanged)
+		{
+			actor.attributes = reader.Read(32);
+		}
+	}
+
+	bool ByHandle(const ReplicatedActor& a, const ReplicatedActor& b)
+	{
+		return a.handle < b.handle;
+	}
+
+	const std::vector<ReplicatedActor> NoActors;
+
+}
+
+ReplicationServer::ReplicationServer(std::uint16_t port, const LinkConditions& conditions) : m_socket(port), m_sequence(1)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("ReplicationServer::ReplicationServer(std::uint16_t port, const LinkConditions& conditions)");
+
+	if (conditions.loss > 0.0f || conditions.latency.count() > 0 || conditions.jitter.count() > 0)
+	{
+		m_socket.SetConditions(conditions);
+	}
+	m_packet.reserve(MaxPacket);
+	logger->info("Replication server on port {0}", m_socket.GetPort());
+}
+
+void ReplicationServer::Update(const Actors& actors)
+{
+	m_socket.Pump();
+	this->Receive();
+
+	const auto now = std::chrono::steady_clock::now();
+	auto timed_out = std::stable_partition(m_clients.begin(), m_clients.end(), [now](const Client& client)
+	{
+		return now - client.heard <= ClientTimeout;
+	});
+	for (auto client = timed_out; client != m_clients.end(); ++client)
+	{
+		auto logger = spdlog::get("EngineLogger");
+		logger->info("Replication client {0} timed out", client->address.ToString());
+	}
+	m_clients.erase(timed_out, m_clients.end());
+
+	if (!m_clients.empty())
+	{
+		this->IndexActors(actors);
+		for (auto& client : m_clients)
+		{
+			this->SendSnapshot(client);
+		}
+	}
+	m_sequence++;
+}
+
+std::vector<ReplicationServer::ClientStats> ReplicationServer::GetStats() const
+{
+	std::vector<ClientStats> stats;
+	for (const auto& client : m_clients)
+	{
+		stats.push_back(client.stats);
+	}
+	return stats;
+}
+
+void ReplicationServer::Receive()
+{
+	UdpAddress from;
+	std::uint8_t data[64];
+	size_t size;
+	while ((size = m_socket.Receive(from, data, sizeof(data))) > 0)
+	{
+		if (size != AcknowledgementSize || data[0] != 'R' || data[1] != 'C' || data[2] != AcknowledgementKind)
+		{
+			continue;
+		}
+
+		auto client = std::find_if(m_clients.begin(), m_clients.end(), [&from](const Client& c) { return c.address == from; });
+		if (client == m_clients.end())
+		{
+			auto logger = spdlog::get("EngineLogger");
+			logger->info("Replication client {0} connected", from.ToString());
+
+			Client added;
+			added.address = from;
+			added.acknowledged = 0;
+			added.sent.resize(History);
+			added.rotation = 0;
+			added.stats = ClientStats{ from, 0, 0, 0, 0, 0.0, std::chrono::microseconds(0) };
+			added.window_start = std::chrono::steady_clock::now();
+			added.window_bytes = 0;
+			added.window_cpu = std::chrono::microseconds(0);
+			m_clients.push_back(std::move(added));
+			client = std::prev(m_clients.end());
+		}
+
+		// Acknowledgements can arrive out of order, only ever move forward
+		const std::uint32_t acknowledged = GetU32(data + 4);
+		if (acknowledged > client->acknowledged && acknowledged < m_sequence)
+		{
+			client->acknowledged = acknowledged;
+			client->stats.acknowledged = acknowledged;
+		}
+		client->interest.bx = static_cast<std::int32_t>(GetU32(data + 8));
+		client->interest.by = static_cast<std::int32_t>(GetU32(data + 12));
+		client->interest.radius = std::min<int>(GetU16(data + 16), MaxRadius);
+		client->heard = std::chrono::steady_clock::now();
+	}
+}
+
+void ReplicationServer::IndexActors(const Actors& actors)
+	// Blocks that stayed empty for a tick are forgotten
+{
+	for (auto block = m_blocks.begin(); block != m_blocks.end();)
+	{
+		if (block->second.empty())
+		{
+			block = m_blocks.erase(block);
+		}
+		else
+		{
+			block->second.clear();
+			++block;
+		}
+	}
+
+	const size_t count = actors.GetLength();
+	m_quantized.resize(count);
+	for (size_t index = 0; index < count; ++index)
+	{
+		m_quantized[index] = Quantize(actors, index);
+		m_blocks[BlockKey(actors.m_pd[index].bx, actors.m_pd[index].by)].push_back(static_cast<std::uint32_t>(index));
+	}
+}
+
+void ReplicationServer::CollectInterest(const ReplicationInterest& interest)
+{
+	m_current.clear();
+	for (int by = interest.by - interest.radius; by <= interest.by + interest.radius; ++by)
+	{
+		for (int bx = interest.bx - interest.radius; bx <= interest.bx + interest.radius; ++bx)
+		{
+			auto block = m_blocks.find(BlockKey(bx, by));
+			if (block == m_blocks.end())
+			{
+				continue;
+			}
+			for (auto index : block->second)
+			{
+				m_current.push_back(m_quantized[index]);
+			}
+		}
+	}
+	std::sort(m_current.begin(), m_current.end(), ByHandle);
+}
+
+void ReplicationServer::SendSnapshot(Client& client)
+{
+	using Clock = std::chrono::steady_clock;
+	const auto start = Clock::now();
+
+	this->CollectInterest(client.interest);
+
+	const Snapshot& acknowledged = client.sent[client.acknowledged % History];
+	const bool has_base = client.acknowledged != 0 && acknowledged.sequence == client.acknowledged;
+	const std::vector<ReplicatedActor>& base = has_base ? acknowledged.actors : NoActors;
+
+	// Both are sorted by handle, walk them side by side
+	m_pairings.clear();
+	m_differing.clear();
+	size_t i = 0;
+	size_t j = 0;
+	while (i < m_current.size() || j < base.size())
+	{
+		Pairing pairing{ -1, -1, true, false };
+		if (j == base.size() || (i < m_current.size() && m_current[i].handle < base[j].handle))
+		{
+			pairing.current = static_cast<std::int64_t>(i++);
+		}
+		else if (i == m_current.size() || base[j].handle < m_current[i].handle)
+		{
+			pairing.base = static_cast<std::int64_t>(j++);
+		}
+		else
+		{
+			pairing.differs = Differences(m_current[i], base[j]) != 0;
+			pairing.current = static_cast<std::int64_t>(i++);
+			pairing.base = static_cast<std::int64_t>(j++);
+		}
+		if (pairing.differs)
+		{
+			m_differing.push_back(m_pairings.size());
+		}
+		m_pairings.push_back(pairing);
+	}
+
+	m_packet.clear();
+	m_packet.push_back('R');
+	m_packet.push_back('S');
+	m_packet.push_back(SnapshotKind);
+	m_packet.push_back(0);
+	PutU32(m_packet, m_sequence);
+	PutU32(m_packet, has_base ? client.acknowledged : 0);
+	PutU16(m_packet, 0);
+
+	// Start where the last snapshot ran out of room
+	BitWriter writer(m_packet);
+	const size_t differing = m_differing.size();
+	const size_t first = (differing > 0) ? client.rotation % differing : 0;
+	const ReplicatedActor zero = {};
+	ActorHandle previous = 0;
+	size_t written = 0;
+	for (; written < differing; ++written)
+	{
+		Pairing& pairing = m_pairings[m_differing[(first + written) % differing]];
+		const ReplicatedActor& actor = (pairing.current >= 0) ? m_current[pairing.current] : base[pairing.base];
+
+		const size_t mark = writer.GetBitCount();
+		if (pairing.current < 0)
+		{
+			writer.Write(RemoveEntry, 2);
+			writer.WriteSigned(static_cast<std::int64_t>(actor.handle) - previous);
+		}
+		else if (pairing.base < 0)
+		{
+			writer.Write(CreateEntry, 2);
+			writer.WriteSigned(static_cast<std::int64_t>(actor.handle) - previous);
+			WriteActor(writer, actor, zero, Actors::AllChanged);
+		}
+		else
+		{
+			const auto mask = Differences(actor, base[pairing.base]);
+			writer.Write(UpdateEntry, 2);
+			writer.WriteSigned(static_cast<std::int64_t>(actor.handle) - previous);
+			writer.Write(mask, 4);
+			WriteActor(writer, actor, base[pairing.base], mask);
+		}
+
+		if (SnapshotHeaderSize + writer.GetByteCount() > MaxPacket)
+		{
+			writer.Truncate(mark);
+			break;
+		}
+		pairing.sent = true;
+		previous = actor.handle;
+	}
+	client.rotation = first + written;
+	m_packet[12] = static_cast<std::uint8_t>(written);
+	m_packet[13] = static_cast<std::uint8_t>(written >> 8);
+	m_socket.Send(client.address, m_packet.data(), m_packet.size());
+
+	// What the client will have once this arrives: whatever didn't fit
+	//	stays as it was
+	m_store.clear();
+	for (const auto& pairing : m_pairings)
+	{
+		if (pairing.differs && !pairing.sent)
+		{
+			if (pairing.base >= 0)
+			{
+				m_store.push_back(base[pairing.base]);
+			}
+		}
+		else if (pairing.current >= 0)
+		{
+			m_store.push_back(m_current[pairing.current]);
+		}
+	}
+	Snapshot& slot = client.sent[m_sequence % History];
+	slot.sequence = m_sequence;
+	std::swap(slot.actors, m_store);
+
+	const auto end = Clock::now();
+	client.stats.actors = m_current.size();
+	client.stats.packets++;
+	client.stats.bytes += m_packet.size();
+	client.window_bytes += m_packet.size();
+	client.window_cpu += std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+	const std::chrono::duration<double> window = end - client.window_start;
+	if (window.count() >= 1.0)
+	{
+		client.stats.bytes_per_second = client.window_bytes / window.count();
+		client.stats.cpu = std::chrono::microseconds(static_cast<long long>(client.window_cpu.count() / window.count()));
+		client.window_start = end;
+		client.window_bytes = 0;
+		client.window_cpu = std::chrono::microseconds(0);
+	}
+}
+
+ReplicationClient::ReplicationClient(const UdpAddress& server, const ReplicationInterest& interest, const LinkConditions& conditions) :
+	m_socket(0), m_server(server), m_interest(interest), m_latest(0), m_applied(0),
+	m_stats{ 0, 0, 0, 0.0, 0, 0 }, m_window_start(std::chrono::steady_clock::now()), m_window_bytes(0)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("ReplicationClient::ReplicationClient(const UdpAddress& server, const ReplicationInterest& interest, const LinkConditions& conditions)");
+
+	if (conditions.loss > 0.0f || conditions.latency.count() > 0 || conditions.jitter.count() > 0)
+	{
+		m_socket.SetConditions(conditions, 2);
+	}
+	this->SetInterest(interest);
+	m_received.resize(ReplicationServer::History);
+	m_packet.resize(2 * ReplicationServer::MaxPacket);
+	m_outgoing.reserve(AcknowledgementSize);
+	logger->info("Replicating from {0}", server.ToString());
+}
+
+void ReplicationClient::SetInterest(const ReplicationInterest& interest)
+{
+	m_interest = interest;
+	m_interest.radius = std::min(std::max(interest.radius, 0), MaxRadius);
+}
+
+void ReplicationClient::Update(Actors& actors)
+{
+	m_socket.Pump();
+
+	UdpAddress from;
+	size_t size;
+	while ((size = m_socket.Receive(from, m_packet.data(), m_packet.size())) > 0)
+	{
+		if (from != m_server)
+		{
+			continue;
+		}
+		m_stats.packets++;
+		m_stats.bytes += size;
+		m_window_bytes += size;
+		if (!this->Decode(m_packet.data(), size))
+		{
+			m_stats.dropped++;
+		}
+	}
+
+	// Only the newest matters, it is against what is shown that the
+	//	views hear about changes
+	const Snapshot& latest = m_received[m_latest % ReplicationServer::History];
+	if (m_latest != m_applied && latest.sequence == m_latest)
+	{
+		this->Apply(m_shown, latest.actors, actors);
+		m_shown = latest.actors;
+		m_applied = m_latest;
+	}
+	this->SendAcknowledgement();
+
+	const auto now = std::chrono::steady_clock::now();
+	const std::chrono::duration<double> window = now - m_window_start;
+	if (window.count() >= 1.0)
+	{
+		m_stats.bytes_per_second = m_window_bytes / window.count();
+		m_window_start = now;
+		m_window_bytes = 0;
+	}
+	m_stats.sequence = m_applied;
+	m_stats.actors = actors.GetLength();
+}
+
+ReplicationClient::Stats ReplicationClient::GetStats() const
+{
+	return m_stats;
+}
+
+bool ReplicationClient::Decode(const std::uint8_t* data, size_t size)
+{
+	if (size < SnapshotHeaderSize || data[0] != 'R' || data[1] != 'S' || data[2] != SnapshotKind)
+	{
+		return false;
+	}
+	const std::uint32_t sequence = GetU32(data + 4);
+	const std::uint32_t baseline = GetU32(data + 8);
+	const std::uint16_t count = GetU16(data + 12);
+	if (sequence <= m_latest || baseline >= sequence)
+	{
+		return false;
+	}
+
+	const Snapshot& known = m_received[baseline % ReplicationServer::History];
+	if (baseline != 0 && known.sequence != baseline)
+	{
+		return false;
+	}
+	const std::vector<ReplicatedActor>& base = (baseline != 0) ? known.actors : NoActors;
+
+	m_ops.clear();
+	try
+	{
+		BitReader reader(data + SnapshotHeaderSize, size - SnapshotHeaderSize);
+		ActorHandle previous = 0;
+		for (std::uint16_t k = 0; k < count; ++k)
+		{
+			const std::uint32_t kind = reader.Read(2);
+			ReplicatedActor actor = {};
+			actor.handle = static_cast<ActorHandle>(previous + reader.ReadSigned());
+			previous = actor.handle;
+
+			if (kind == CreateEntry)
+			{
+				ReadActor(reader, actor, Actors::AllChanged);
+			}
+			else if (kind == UpdateEntry)
+			{
+				auto before = std::lower_bound(base.begin(), base.end(), actor, ByHandle);
+				if (before == base.end() || before->handle != actor.handle)
+				{
+					return false;
+				}
+				const auto mask = static_cast<Actors::ChangeMask>(reader.Read(4));
+				actor = *before;
+				ReadActor(reader, actor, mask);
+			}
+			else if (kind != RemoveEntry)
+			{
+				return false;
+			}
+			m_ops.push_back({ kind, actor });
+		}
+	}
+	catch (const std::runtime_error&)
+	{
+		return false;
+	}
+	std::sort(m_ops.begin(), m_ops.end(), [](const auto& a, const auto& b) { return a.second.handle < b.second.handle; });
+
+	// Entries replace, add to or remove from the baseline
+	m_next.clear();
+	size_t j = 0;
+	for (const auto& op : m_ops)
+	{
+		while (j < base.size() && base[j].handle < op.second.handle)
+		{
+			m_next.push_back(base[j++]);
+		}
+		const bool in_base = j < base.size() && base[j].handle == op.second.handle;
+		if (in_base)
+		{
+			j++;
+		}
+		else if (op.first != CreateEntry)
+		{
+			return false;
+		}
+		if (op.first != RemoveEntry)
+		{
+			m_next.push_back(op.second);
+		}
+	}
+	m_next.insert(m_next.end(), base.begin() + j, base.end());
+
+	Snapshot& slot = m_received[sequence % ReplicationServer::History];
+	slot.sequence = sequence;
+	std::swap(slot.actors, m_next);
+	m_latest = sequence;
+	return true;
+}
+
+void ReplicationClient::Apply(const std::vector<ReplicatedActor>& before, const std::vector<ReplicatedActor>& after, Actors& actors)
+	// Removed actors are swapped to the end and popped, like the model does
+{
+	Actors::PositionData pd;
+	Actors::MovementData md;
+	size_t i = 0;
+	size_t j = 0;
+	while (i < before.size() || j < after.size())
+	{
+		if (j == after.size() || (i < before.size() && before[i].handle < after[j].handle))
+		{
+			const ActorHandle gone = before[i++].handle;
+			const size_t index = m_local[gone];
+			const size_t last = actors.GetLength() - 1;
+			if (index != last)
+			{
+				actors.Swap(index, last);
+				m_remote[index] = m_remote[last];
+				m_local[m_remote[index]] = index;
+			}
+			actors.Pop();
+			m_remote.pop_back();
+			m_local.erase(gone);
+		}
+		else if (i == before.size() || after[j].handle < before[i].handle)
+		{
+			const ReplicatedActor& added = after[j++];
+			Dequantize(added, pd, md);
+			actors.Push(pd, md, ToActorType(added.type), std::bitset<32>(added.attributes));
+			m_local[added.handle] = actors.GetLength() - 1;
+			m_remote.push_back(added.handle);
+		}
+		else
+		{
+			const ReplicatedActor& now = after[j++];
+			const auto mask = Differences(now, before[i++]);
+			if (mask == 0)
+			{
+				continue;
+			}
+			const size_t index = m_local[now.handle];
+			Dequantize(now, pd, md);
+			actors.m_pd[index] = pd;
+			actors.m_md[index] = md;
+			actors.m_types[index] = ToActorType(now.type);
+			actors.m_attributes[index] = std::bitset<32>(now.attributes);
+			actors.MarkChanged(index, mask);
+		}
+	}
+}
+
+void ReplicationClient::SendAcknowledgement()
+{
+	std::vector<std::uint8_t>& out = m_outgoing;
+	out.clear();
+	out.push_back('R');
+	out.push_back('C');
+	out.push_back(AcknowledgementKind);
+	out.push_back(0);
+	PutU32(out, m_latest);
+	PutU32(out, static_cast<std::uint32_t>(m_interest.bx));
+	PutU32(out, static_cast<std::uint32_t>(m_interest.by));
+	PutU16(out, static_cast<std::uint16_t>(m_interest.radius));
+	m_socket.Send(m_server, out.data(), out.size());
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+#include "Model.h"
+#include "UdpSocket.h"
+
+/// Blocks a client wants to hear about: every actor within radius blocks
+///  of (bx, by), either way.
+///
+struct ReplicationInterest
+{
+	int bx, by;
+	int radius;
+};
+
+/// One actor as it goes over the wire.  Positions within the block are
+///  kept in 1/16 pixel, movement in 1/256 pixel per tick.
+///
+struct ReplicatedActor
+{
+	ActorHandle handle;
+	std::int32_t bx, by;
+	std::int32_t x, y;
+	std::int32_t w, h;
+	std::int32_t vx, vy;
+	std::int32_t ax, ay;
+	std::uint32_t type;
+	std::uint32_t attributes;
+};
+
+/// Server end of the replication.  Runs next to the simulation, and once
+///  a tick sends every client the actors in its interest that differ from
+///  the last snapshot the client acknowledged: new ones whole, changed
+///  ones as the fields that changed, as differences, and handles of the
+///  ones it no longer gets.  Until the first acknowledgement, or if it is
+///  too old to still be known, everything is sent whole.
+///
+///  A snapshot never goes over MaxPacket.  What doesn't fit waits for a
+///  later tick, and the next snapshot starts where this one stopped so
+///  nothing is starved.  The server remembers what each client ends up
+///  with, so later deltas stay exact however many packets are lost.
+///
+///  Clients announce themselves by sending, and are forgotten after
+///  ClientTimeout without hearing from them.
+///
+class ReplicationServer
+{
+public:
+	struct ClientStats
+	{
+		UdpAddress address;
+		size_t actors;					// In its interest on the last tick
+		std::uint32_t acknowledged;
+		std::uint64_t packets;
+		std::uint64_t bytes;
+		double bytes_per_second;		// Over the last full second
+		std::chrono::microseconds cpu;	// Spent on it in the last full second
+	};
+
+	// Throws std::runtime_error if the port can't be bound
+	explicit ReplicationServer(std::uint16_t port, const LinkConditions& conditions = LinkConditions());
+
+	// Once per tick, after the simulation.  Reads what the clients sent,
+	//  then sends each of them a snapshot.
+	void Update(const Actors& actors);
+
+	std::vector<ClientStats> GetStats() const;
+
+	// What each client asked for, as of the last Update
+	size_t GetClientCount() const { return m_clients.size(); }
+	const ReplicationInterest& GetInterest(size_t client) const { return m_clients[client].interest; }
+	std::uint16_t GetPort() const { return m_socket.GetPort(); }
+
+	static constexpr size_t MaxPacket = 1200;
+	static constexpr size_t History = 32;
+	static constexpr std::chrono::seconds ClientTimeout{ 5 };
+
+private:
+	struct Snapshot
+	{
+		std::uint32_t sequence = 0;
+		std::vector<ReplicatedActor> actors;	// Sorted by handle
+	};
+
+	struct Client
+	{
+		UdpAddress address;
+		ReplicationInterest interest;
+		std::uint32_t acknowledged;
+		std::vector<Snapshot> sent;				// By sequence % History
+		size_t rotation;
+		std::chrono::steady_clock::time_point heard;
+
+		ClientStats stats;
+		std::chrono::steady_clock::time_point window_start;
+		std::uint64_t window_bytes;
+		std::chrono::microseconds window_cpu;
+	};
+
+	// Every actor in interest, next to what the client has of it
+	struct Pairing
+	{
+		std::int64_t current;
+		std::int64_t base;
+		bool differs;
+		bool sent;
+	};
+
+	void Receive();
+	void IndexActors(const Actors& actors);
+	void SendSnapshot(Client& client);
+	void CollectInterest(const ReplicationInterest& interest);
+
+	UdpSocket m_socket;
+	std::vector<Client> m_clients;
+	std::uint32_t m_sequence;
+
+	// Actors by block, rebuilt once per tick and shared by every client
+	std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> m_blocks;
+	std::vector<ReplicatedActor> m_quantized;
+
+	// Scratch, kept to reuse the storage
+	std::vector<ReplicatedActor> m_current;
+	std::vector<Pairing> m_pairings;
+	std::vector<size_t> m_differing;
+	std::vector<ReplicatedActor> m_store;
+	std::vector<std::uint8_t> m_packet;
+};
+
+/// Client end.  Applies the snapshots that arrive to its own Actors, which
+///  hold nothing but replicated actors, and acknowledges them.  Local
+///  handles are the client's own, the server's are mapped onto them.
+///  Snapshots that arrive late, twice or against a baseline the client no
+///  longer has are dropped.
+///
+class ReplicationClient
+{
+public:
+	struct Stats
+	{
+		std::uint64_t packets;
+		std::uint64_t bytes;
+		std::uint64_t dropped;
+		double bytes_per_second;
+		std::uint32_t sequence;
+		size_t actors;
+	};
+
+	// Throws std::runtime_error if no local port can be bound
+	ReplicationClient(const UdpAddress& server, const ReplicationInterest& interest, const LinkConditions& conditions = LinkConditions());
+
+	void SetInterest(const ReplicationInterest& interest);
+	const ReplicationInterest& GetInterest() const { return m_interest; }
+
+	// Once per tick instead of simulating.  Applies the newest snapshot
+	//  that arrived, marking what changed for the views, and tells the
+	//  server where the client is.
+	void Update(Actors& actors);
+
+	Stats GetStats() const;
+
+private:
+	struct Snapshot
+	{
+		std::uint32_t sequence = 0;
+		std::vector<ReplicatedActor> actors;	// Sorted by handle
+	};
+
+	// The snapshot in the packet, false if it can't be used
+	bool Decode(const std::uint8_t* data, size_t size);
+	void Apply(const std::vector<ReplicatedActor>& before, const std::vector<ReplicatedActor>& after, Actors& actors);
+	void SendAcknowledgement();
+
+	UdpSocket m_socket;
+	UdpAddress m_server;
+	ReplicationInterest m_interest;
+
+	std::vector<Snapshot> m_received;			// By sequence % ReplicationServer::History
+	std::uint32_t m_latest;
+
+	// What actors holds, as of snapshot m_applied
+	std::vector<ReplicatedActor> m_shown;
+	std::uint32_t m_applied;
+
+	// Server handle to local index and back
+	std::unordered_map<ActorHandle, size_t> m_local;
+	std::vector<ActorHandle> m_remote;
+
+	Stats m_stats;
+	std::chrono::steady_clock::time_point m_window_start;
+	std::uint64_t m_window_bytes;
+
+	// Scratch, kept to reuse the storage
+	std::vector<std::uint8_t> m_packet;
+	std::vector<std::uint8_t> m_outgoing;
+	std::vector<std::pair<std::uint32_t, ReplicatedActor>> m_ops;
+	std::vector<ReplicatedActor> m_next;
+};
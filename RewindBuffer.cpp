@@ -0,0 +1,387 @@
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include "RewindBuffer.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+namespace {
+
+	// Captures are packed like snapshots, one block per array
+	constexpr size_t RecordBytes = sizeof(Actors::PositionData) + sizeof(Actors::MovementData) +
+		sizeof(Actors::ActorType) + sizeof(std::bitset<32>) + sizeof(ActorHandle);
+
+	// Shorter runs of zeros stay inside the literal, a new run costs more
+	//  than it saves
+	constexpr size_t MinZeroRun = 8;
+
+	// Runs of at least MinZeroRun between literals keep the worst case
+	//  well inside half again the input
+	size_t EncodeBound(size_t size)
+	{
+		return size + size / 2 + 32;
+	}
+
+	char* PutVarint(std::uint64_t value, char* out)
+	{
+		while (value >= 0x80)
+		{
+			*out++ = static_cast<char>((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		*out++ = static_cast<char>(value);
+		return out;
+	}
+
+	const char* GetVarint(const char* in, const char* end, std::uint64_t& value)
+	{
+		value = 0;
+		for (unsigned int shift = 0; in < end && shift < 64; shift += 7)
+		{
+			const auto byte = static_cast<unsigned char>(*in++);
+			value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return in;
+			}
+		}
+		throw std::runtime_error("Rewind capture is damaged");
+	}
+
+}
+
+RewindBuffer::RewindBuffer(size_t frames, size_t arena_bytes, size_t keyframe_interval, size_t expected_actors) :
+	m_first(0), m_count(0), m_arena_limit(arena_bytes), m_write(0), m_keyframe_interval(keyframe_interval), m_since_key(0),
+	m_memory(MemorySubsystem::Rewind)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("RewindBuffer::RewindBuffer(size_t frames, size_t arena_bytes, size_t keyframe_interval, size_t expected_actors)");
+
+	if (frames == 0 || keyframe_interval == 0)
+	{
+		throw std::invalid_argument("Rewind needs at least one frame and a keyframe interval of at least one");
+	}
+	m_entries.resize(frames);
+	m_arena.resize(std::min(arena_bytes, EncodeBound(expected_actors * RecordBytes)));
+	m_image.reserve(expected_actors * RecordBytes);
+	m_previous.reserve(expected_actors * RecordBytes);
+	m_scratch.resize(EncodeBound(expected_actors * RecordBytes));
+	this->Account();
+
+	logger->debug("Rewind keeps {0} frames in up to {1} bytes, keyframe every {2}", frames, arena_bytes, keyframe_interval);
+}
+
+void RewindBuffer::Capture(std::uint64_t tick, const Actors& actors)
+{
+	this->Pack(actors);
+
+	bool key = (m_count == 0 || m_since_key + 1 >= m_keyframe_interval);
+	size_t size = 0;
+	size_t offset = 0;
+	for (;;)
+	{
+		size = this->Encode(key);
+		if (size > m_arena_limit)
+		{
+			auto logger = spdlog::get("EngineLogger");
+			logger->warn("Tick {0} needs {1} bytes, more than the whole rewind arena", tick, size);
+			this->Clear();
+			return;
+		}
+
+		// Making room can take the chain this delta refers to with it
+		offset = this->Allocate(size);
+		if (key || m_count > 0)
+		{
+			break;
+		}
+		key = true;
+	}
+
+	std::memcpy(m_arena.data() + offset, m_scratch.data(), size);
+	this->At(m_count) = Entry{ tick, offset, size, actors.GetLength(), actors.GetNextHandle(), key };
+	m_count++;
+	m_write = offset + size;
+	m_since_key = key ? 0 : m_since_key + 1;
+	std::swap(m_image, m_previous);
+	this->Account();
+}
+
+bool RewindBuffer::Rewind(std::uint64_t tick, Actors& actors)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("RewindBuffer::Rewind(std::uint64_t tick, Actors& actors)");
+
+	if (m_count == 0 || this->At(0).tick > tick)
+	{
+		logger->warn("Can't rewind to tick {0}, nothing that old is kept", tick);
+		return false;
+	}
+
+	size_t target = m_count - 1;
+	while (this->At(target).tick > tick)
+	{
+		target--;
+	}
+	size_t key = target;
+	while (!this->At(key).key)
+	{
+		key--;
+	}
+
+	for (size_t position = key; position <= target; ++position)
+	{
+		this->Decode(this->At(position));
+	}
+	const Entry& entry = this->At(target);
+	this->Unpack(actors, entry.count, entry.next_handle);
+
+	// The restored tick is the newest now, later captures deltas against it
+	m_count = target + 1;
+	m_write = entry.offset + entry.size;
+	m_since_key = target - key;
+
+	logger->info("Rewound to tick {0}", entry.tick);
+	return true;
+}
+
+void RewindBuffer::Clear()
+{
+	m_first = 0;
+	m_count = 0;
+	m_write = 0;
+	m_since_key = 0;
+}
+
+RewindBuffer::Stats RewindBuffer::GetStats() const
+{
+	Stats stats{ m_count, 0, 0, 0 };
+	for (size_t position = 0; position < m_count; ++position)
+	{
+		stats.bytes += this->At(position).size;
+	}
+	if (m_count > 0)
+	{
+		stats.oldest = this->At(0).tick;
+		stats.newest = this->At(m_count - 1).tick;
+	}
+	return stats;
+}
+
+void RewindBuffer::Pack(const Actors& actors)
+{
+	const size_t count = actors.GetLength();
+	m_image.resize(count * RecordBytes);
+
+	char* out = m_image.data();
+	std::memcpy(out, actors.m_pd.data(), count * sizeof(Actors::PositionData));
+	out += count * sizeof(Actors::PositionData);
+	std::memcpy(out, actors.m_md.data(), count * sizeof(Actors::MovementData));
+	out += count * sizeof(Actors::MovementData);
+	std::memcpy(out, actors.m_types.data(), count * sizeof(Actors::ActorType));
+	out += count * sizeof(Actors::ActorType);
+	std::memcpy(out, actors.m_attributes.data(), count * sizeof(std::bitset<32>));
+	out += count * sizeof(std::bitset<32>);
+	std::memcpy(out, actors.GetHandles(), count * sizeof(ActorHandle));
+}
+
+void RewindBuffer::Unpack(Actors& actors, size_t count, ActorHandle next_handle) const
+	// m_previous holds the decoded capture
+{
+	const char* in = m_previous.data();
+	const char* handles = in + count * (RecordBytes - sizeof(ActorHandle));
+	actors.Restore(count, reinterpret_cast<const ActorHandle*>(handles), next_handle);
+
+	std::memcpy(actors.m_pd.data(), in, count * sizeof(Actors::PositionData));
+	in += count * sizeof(Actors::PositionData);
+	std::memcpy(actors.m_md.data(), in, count * sizeof(Actors::MovementData));
+	in += count * sizeof(Actors::MovementData);
+	std::memcpy(actors.m_types.data(), in, count * sizeof(Actors::ActorType));
+	in += count * sizeof(Actors::ActorType);
+	std::memcpy(actors.m_attributes.data(), in, count * sizeof(std::bitset<32>));
+}
+
+size_t RewindBuffer::Encode(bool key)
+	// m_image XOR m_previous (or nothing for a keyframe) as pairs of
+	//	varint zero run, varint literal length, literal bytes
+{
+	const size_t size = m_image.size();
+	const size_t common = key ? 0 : std::min(size, m_previous.size());
+	const char* image = m_image.data();
+	const char* previous = m_previous.data();
+	if (m_scratch.size() < EncodeBound(size))
+	{
+		m_scratch.resize(EncodeBound(size));
+	}
+
+	auto delta = [&](size_t position) -> char
+	{
+		return (position < common) ? static_cast<char>(image[position] ^ previous[position]) : image[position];
+	};
+	auto same_word = [&](size_t position)
+	{
+		std::uint64_t now, before = 0;
+		std::memcpy(&now, image + position, sizeof(now));
+		if (position + sizeof(before) <= common)
+		{
+			std::memcpy(&before, previous + position, sizeof(before));
+		}
+		else if (position < common)
+		{
+			return false;
+		}
+		return now == before;
+	};
+
+	char* out = m_scratch.data();
+	size_t position = 0;
+	while (position < size)
+	{
+		const size_t zeros_start = position;
+		while (position + sizeof(std::uint64_t) <= size && same_word(position))
+		{
+			position += sizeof(std::uint64_t);
+		}
+		while (position < size && delta(position) == 0)
+		{
+			position++;
+		}
+		if (position == size)
+		{
+			break;
+		}
+
+		const size_t literal_start = position;
+		size_t literal_end = position;
+		while (position < size)
+		{
+			if (delta(position) != 0)
+			{
+				literal_end = ++position;
+				continue;
+			}
+			size_t run = position;
+			while (run < size && run - position < MinZeroRun && delta(run) == 0)
+			{
+				run++;
+			}
+			if (run == size || run - position == MinZeroRun)
+			{
+				break;
+			}
+			position = run;
+		}
+		position = literal_end;
+
+		out = PutVarint(literal_start - zeros_start, out);
+		out = PutVarint(literal_end - literal_start, out);
+		for (size_t k = literal_start; k < literal_end; ++k)
+		{
+			*out++ = delta(k);
+		}
+	}
+	return static_cast<size_t>(out - m_scratch.data());
+}
+
+void RewindBuffer::Decode(const Entry& entry)
+	// Applies entry to m_previous, which holds the capture before it
+{
+	const size_t size = entry.count * RecordBytes;
+	if (entry.key)
+	{
+		m_previous.assign(size, 0);
+	}
+	else
+	{
+		// Bytes the capture before didn't have were encoded against zero
+		const size_t kept = std::min(size, m_previous.size());
+		m_previous.resize(size);
+		std::fill(m_previous.begin() + kept, m_previous.end(), 0);
+	}
+
+	const char* in = m_arena.data() + entry.offset;
+	const char* end = in + entry.size;
+	size_t position = 0;
+	while (in < end)
+	{
+		std::uint64_t zeros, literal;
+		in = GetVarint(in, end, zeros);
+		in = GetVarint(in, end, literal);
+		position += zeros;
+		if (literal > static_cast<size_t>(end - in) || position + literal > size)
+		{
+			throw std::runtime_error("Rewind capture is damaged");
+		}
+		for (const char* stop = in + literal; in < stop; ++in)
+		{
+			m_previous[position++] ^= *in;
+		}
+	}
+}
+
+size_t RewindBuffer::Allocate(size_t size)
+	// Where the next capture goes, growing the arena while the live bytes
+	//	don't wrap, then dropping the oldest until it fits
+{
+	while (m_count > 0)
+	{
+		if (m_count < m_entries.size())
+		{
+			const size_t head = this->At(0).offset;
+			if (head < m_write)
+			{
+				// Live bytes are [head, m_write), free either side
+				this->Grow(m_write + size);
+				if (m_write + size <= m_arena.size())
+				{
+					return m_write;
+				}
+				if (size <= head)
+				{
+					return 0;
+				}
+			}
+			else if (m_write + size <= head)
+			{
+				// Live bytes wrap around, free is [m_write, head)
+				return m_write;
+			}
+		}
+		this->DropOldest();
+	}
+	this->Grow(size);
+	return 0;
+}
+
+void RewindBuffer::Grow(size_t needed)
+	// Offsets stay valid, the bytes past the old end are free
+{
+	if (needed > m_arena.size() && m_arena.size() < m_arena_limit)
+	{
+		m_arena.resize(std::min(m_arena_limit, std::max(needed, 2 * m_arena.size())));
+	}
+}
+
+void RewindBuffer::DropOldest()
+	// Deltas are useless without their keyframe, they go with it
+{
+	do
+	{
+		m_first = (m_first + 1) % m_entries.size();
+		m_count--;
+	} while (m_count > 0 && !this->At(0).key);
+
+	if (m_count == 0)
+	{
+		m_first = 0;
+		m_write = 0;
+		m_since_key = 0;
+	}
+}
+
+void RewindBuffer::Account()
+{
+	m_memory.Set(m_entries.capacity() * sizeof(Entry) + m_arena.capacity() +
+		m_image.capacity() + m_previous.capacity() + m_scratch.capacity());
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Model.h"
+
+/// The last few seconds of the Actors, for rewinding.  Every captured
+///  tick is packed into one record per actor and stored as the XOR against
+///  the tick before, with the runs of zeros that leaves squeezed out.  Every
+///  keyframe_interval captures (and whenever the chain was lost) a tick is
+///  stored against nothing instead, so the oldest ticks can be dropped.
+///
+///  Captures live in an arena used as a ring, the oldest are dropped to
+///  make room.  The arena starts at one keyframe's worth and doubles as
+///  captures need it, up to its limit, so a game that captures little
+///  holds little.  Nothing is allocated per capture once the arena and
+///  the working buffers have grown to what the actors need.
+///
+class RewindBuffer
+{
+public:
+	struct Stats
+	{
+		size_t frames;
+		size_t bytes;
+		std::uint64_t oldest;
+		std::uint64_t newest;
+	};
+
+	// Room for frames captures in at most arena_bytes, working buffers
+	//  reserved for expected_actors
+	RewindBuffer(size_t frames, size_t arena_bytes, size_t keyframe_interval, size_t expected_actors);
+
+	// Ticks must increase from one capture to the next
+	void Capture(std::uint64_t tick, const Actors& actors);
+
+	// Puts the actors back as they were on the newest capture no later than
+	//  tick and forgets every capture after it.  False, and actors
+	//  untouched, if tick is older than anything kept.
+	bool Rewind(std::uint64_t tick, Actors& actors);
+
+	void Clear();
+	Stats GetStats() const;
+
+private:
+	struct Entry
+	{
+		std::uint64_t tick;
+		size_t offset;
+		size_t size;
+		size_t count;
+		ActorHandle next_handle;
+		bool key;
+	};
+
+	void Pack(const Actors& actors);
+	void Unpack(Actors& actors, size_t count, ActorHandle next_handle) const;
+	size_t Encode(bool key);
+	void Decode(const Entry& entry);
+	size_t Allocate(size_t size);
+	void Grow(size_t needed);
+	void DropOldest();
+
+	Entry& At(size_t position) { return m_entries[(m_first + position) % m_entries.size()]; }
+	const Entry& At(size_t position) const { return m_entries[(m_first + position) % m_entries.size()]; }
+
+	// Ring of captures, oldest first
+	std::vector<Entry> m_entries;
+	size_t m_first;
+	size_t m_count;
+
+	std::vector<char> m_arena;
+	size_t m_arena_limit;
+	size_t m_write;
+
+	size_t m_keyframe_interval;
+	size_t m_since_key;
+
+	// Packed actors of this capture and the one before, and the encoding
+	std::vector<char> m_image;
+	std::vector<char> m_previous;
+	std::vector<char> m_scratch;
+
+	// The arena and the buffers around it, after every Capture
+	void Account();
+	MemoryAccount m_memory;
+};
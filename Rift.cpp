@@ -4,6 +4,8 @@
 
 #include "SDL.h"
 #include "Game.h"
+#include "Replication.h"
+#include "MemoryTelemetry.h"
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/basic_file_sink.h"
@@ -22,8 +24,110 @@ int main(int argc, char** argv)
 
 	console->info("Main engine start...");
 
+	// --record <file> saves the input of the session, --replay <file>
+	//  plays one back headless as fast as it goes
+	std::string record;
+	std::string replay;
+
+	// With --replay, --memory-report <file> writes what every subsystem held
+	//  and --memory-budget <MB> fails the run if they held more together
+	std::string memory_report;
+	size_t memory_budget = 0;
+
+	// --frame-stats <name> writes frame time percentiles to name.csv and
+	//  name.json every few seconds
+	std::string frame_stats;
+
+	// --serve <port> simulates headless for clients, --connect <host:port>
+	//  shows what a server simulates.  --loss <fraction>, --latency <ms>
+	//  and --jitter <ms> make the network worse on this end.
+	int serve = 0;
+	std::string connect;
+	LinkConditions conditions;
+	for (int k = 1; k + 1 < argc; ++k)
+	{
+		const std::string arg(argv[k]);
+		if (arg == "--record")
+		{
+			record = argv[++k];
+		}
+		else if (arg == "--replay")
+		{
+			replay = argv[++k];
+		}
+		else if (arg == "--memory-report")
+		{
+			memory_report = argv[++k];
+		}
+		else if (arg == "--memory-budget")
+		{
+			memory_budget = static_cast<size_t>(std::stoul(argv[++k])) * 1024 * 1024;
+		}
+		else if (arg == "--frame-stats")
+		{
+			frame_stats = argv[++k];
+		}
+		else if (arg == "--serve")
+		{
+			serve = std::stoi(argv[++k]);
+		}
+		else if (arg == "--connect")
+		{
+			connect = argv[++k];
+		}
+		else if (arg == "--loss")
+		{
+			conditions.loss = std::stof(argv[++k]);
+		}
+		else if (arg == "--latency")
+		{
+			conditions.latency = std::chrono::milliseconds(std::stoi(argv[++k]));
+		}
+		else if (arg == "--jitter")
+		{
+			conditions.jitter = std::chrono::milliseconds(std::stoi(argv[++k]));
+		}
+	}
+
+	if (!replay.empty())
+	{
+		Game::Game g(std::string("configfile.txt"), true, true);
+		if (!frame_stats.empty())
+		{
+			g.ExportFrameStats(frame_stats + ".csv", frame_stats + ".json");
+		}
+		bool passed = g.Replay(replay);
+		if (!memory_report.empty())
+		{
+			passed = MemoryTelemetry::WriteJson(memory_report) && passed;
+		}
+		const size_t high_water = MemoryTelemetry::GetTotal().high_water;
+		if (memory_budget > 0 && high_water > memory_budget)
+		{
+			console->error("Memory went up to {0} bytes, over the budget of {1}", high_water, memory_budget);
+			passed = false;
+		}
+		return passed ? 0 : 1;
+	}
+
 	// Instance of Game
-	Game::Game g(std::string("configfile.txt"), true);
+	Game::Game g(std::string("configfile.txt"), true, serve != 0);
+	if (!frame_stats.empty())
+	{
+		g.ExportFrameStats(frame_stats + ".csv", frame_stats + ".json");
+	}
+	if (!record.empty())
+	{
+		g.Record(record);
+	}
+	if (serve != 0)
+	{
+		g.Serve(static_cast<std::uint16_t>(serve), conditions);
+	}
+	else if (!connect.empty())
+	{
+		g.Connect(UdpAddress::Resolve(connect), ReplicationInterest{ 0, 0, 16 }, conditions);
+	}
 
 	// Set up main loop
 	console->info("Begin event loop");
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+#include "SimulationLod.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+SimulationLod::SimulationLod(const Settings& settings) :
+	m_settings(settings), m_length(0), m_stats{ { 0, 0, 0 }, 0, 0 }, m_memory(MemorySubsystem::Actors)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("SimulationLod::SimulationLod(const Settings& settings)");
+
+	if (settings.full_radius < 0 || settings.reduced_radius < settings.full_radius || settings.hysteresis < 0)
+	{
+		throw std::invalid_argument("Simulation LOD radii must be 0 <= full_radius <= reduced_radius");
+	}
+	if (settings.reduced_interval == 0 || settings.coarse_interval == 0)
+	{
+		throw std::invalid_argument("Simulation LOD intervals must be at least one tick");
+	}
+	m_focus.reserve(8);
+}
+
+void SimulationLod::ClearFocus()
+{
+	m_focus.clear();
+}
+
+void SimulationLod::AddFocus(int bx, int by, int width, int height)
+{
+	m_focus.push_back(Focus{ bx, by, bx + std::max(width, 1) - 1, by + std::max(height, 1) - 1 });
+}
+
+void SimulationLod::Reset()
+{
+	m_length = 0;
+}
+
+int SimulationLod::Distance(const Actors::PositionData& pd) const
+	// In blocks to the nearest focus, 0 inside one
+{
+	if (m_focus.empty())
+	{
+		return 0;
+	}
+	int distance = std::numeric_limits<int>::max();
+	for (const auto& focus : m_focus)
+	{
+		const int dx = std::max({ focus.x0 - pd.bx, 0, pd.bx - focus.x1 });
+		const int dy = std::max({ focus.y0 - pd.by, 0, pd.by - focus.y1 });
+		distance = std::min(distance, std::max(dx, dy));
+	}
+	return distance;
+}
+
+LodTier SimulationLod::Classify(int distance, LodTier previous) const
+	// Nearer straight away, further only past the hysteresis
+{
+	auto tier_at = [this](int d)
+	{
+		return (d <= m_settings.full_radius) ? LodTier::Full
+			: (d <= m_settings.reduced_radius) ? LodTier::Reduced : LodTier::Coarse;
+	};
+
+	const LodTier tier = tier_at(distance);
+	if (tier <= previous)
+	{
+		return tier;
+	}
+	return std::max(previous, tier_at(distance - m_settings.hysteresis));
+}
+
+unsigned int SimulationLod::Interval(LodTier tier) const
+{
+	switch (tier)
+	{
+	case LodTier::Reduced:
+		return m_settings.reduced_interval;
+	case LodTier::Coarse:
+		return m_settings.coarse_interval;
+	default:
+		return 1;
+	}
+}
+
+void SimulationLod::Update(const Actors& actors, std::uint64_t tick)
+{
+	const size_t length = actors.GetLength();
+	const size_t old_length = m_length;
+	if (m_handles.size() < length)
+	{
+		m_handles.resize(length);
+		m_tiers.resize(length);
+		m_stepped.resize(length);
+		m_ticks.resize(length);
+		m_due.reserve(length);
+		m_due_ticks.reserve(length);
+		m_memory.Set(m_handles.capacity() * (sizeof(ActorHandle) + sizeof(LodTier) + sizeof(std::uint64_t)
+			+ 2 * sizeof(std::uint32_t) + sizeof(size_t)));
+	}
+
+	m_due.clear();
+	m_due_ticks.clear();
+	std::fill(std::begin(m_stats.actors), std::end(m_stats.actors), 0);
+
+	for (size_t index = 0; index < length; ++index)
+	{
+		const ActorHandle handle = actors.GetHandle(index);
+		if (index >= old_length || m_handles[index] != handle)
+		{
+			// A removal swaps the last actor in, it was in the part that's
+			//  gone.  Anything else is new, and up to date as of last tick.
+			size_t from = length;
+			while (from < old_length && m_handles[from] != handle)
+			{
+				from++;
+			}
+			m_handles[index] = handle;
+			m_tiers[index] = (from < old_length) ? m_tiers[from] : LodTier::Coarse;
+			m_stepped[index] = (from < old_length) ? m_stepped[from] : tick - 1;
+		}
+
+		const LodTier previous = m_tiers[index];
+		const LodTier tier = this->Classify(this->Distance(actors.m_pd[index]), previous);
+		m_tiers[index] = tier;
+		m_stats.actors[static_cast<size_t>(tier)]++;
+
+		// Staggered by handle, and right away when moving nearer
+		const std::uint64_t owed = tick - m_stepped[index];
+		const unsigned int interval = this->Interval(tier);
+		const bool due = owed > 0 && (tier < previous || owed >= interval || (tick + handle) % interval == 0);
+		if (!due)
+		{
+			m_ticks[index] = 0;
+			continue;
+		}
+
+		if (tier < previous && owed > 1)
+		{
+			m_stats.caught_up++;
+		}
+		m_ticks[index] = static_cast<std::uint32_t>(std::min<std::uint64_t>(owed, std::numeric_limits<std::uint32_t>::max()));
+		m_stepped[index] = tick;
+		m_due.push_back(index);
+		m_due_ticks.push_back(m_ticks[index]);
+	}
+
+	m_length = length;
+	m_stats.due = m_due.size();
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Model.h"
+#include "MemoryTelemetry.h"
+
+enum class LodTier { Full, Reduced, Coarse };
+constexpr size_t LodTierCount = 3;
+
+/// How closely each actor is simulated, by how far it is from what is
+///  being looked at.  Focus areas are rectangles of blocks, e.g. what a
+///  view shows or what a client asked for.  Within full_radius blocks of
+///  one, actors are simulated every tick.  Further out, up to
+///  reduced_radius, every reduced_interval ticks.  Beyond that they are
+///  Coarse: they only coast along every coarse_interval ticks, their
+///  behaviors wait until they come back.  Without any focus everything
+///  is Full.
+///
+///  An actor that isn't due keeps a debt of ticks, and the tick it is
+///  due covers all of them at once, so moving nearer, which makes it due
+///  right away, leaves it where it would have been.  Tiers only go out
+///  once an actor is hysteresis blocks past the edge, actors on an edge
+///  don't flicker between rates.  Actors of a tier are spread over its
+///  interval by handle, each tick steps about the same number.
+///
+///  Works by index, like the scheduler.  Actors swapped in by a removal
+///  keep their debt, Reset forgets every debt, for when the actors are
+///  replaced as a whole.
+///
+class SimulationLod
+{
+public:
+	struct Settings
+	{
+		int full_radius;				// Blocks outside the focus
+		int reduced_radius;
+		unsigned int reduced_interval;	// Ticks
+		unsigned int coarse_interval;
+		int hysteresis;					// Blocks
+	};
+
+	struct Stats
+	{
+		size_t actors[LodTierCount];	// In each tier, last Update
+		size_t due;						// Stepped on the last Update
+		std::uint64_t caught_up;		// Moved nearer while owing more than a tick
+	};
+
+	// Throws std::invalid_argument for radii out of order or a zero interval
+	explicit SimulationLod(const Settings& settings = DefaultSettings);
+
+	void ClearFocus();
+	void AddFocus(int bx, int by, int width, int height);
+
+	// Once a tick, before anything is simulated.  Ticks count up by one
+	//  between calls, except after a Reset.
+	void Update(const Actors& actors, std::uint64_t tick);
+	void Reset();
+
+	// For the actors of the last Update
+	LodTier GetTier(size_t index) const { return m_tiers[index]; }
+	bool IsDue(size_t index) const { return m_ticks[index] != 0; }
+
+	// Ticks an actor covers this tick, 0 if it isn't due
+	std::uint32_t GetTicks(size_t index) const { return m_ticks[index]; }
+
+	// The actors that are due, in index order, and their ticks
+	const std::vector<size_t>& GetDue() const { return m_due; }
+	const std::vector<std::uint32_t>& GetDueTicks() const { return m_due_ticks; }
+
+	const Settings& GetSettings() const { return m_settings; }
+	const Stats& GetStats() const { return m_stats; }
+
+	static constexpr Settings DefaultSettings = { 8, 32, 4, 16, 2 };
+
+private:
+	struct Focus
+	{
+		int x0, y0, x1, y1;		// Inclusive
+	};
+
+	int Distance(const Actors::PositionData& pd) const;
+	LodTier Classify(int distance, LodTier previous) const;
+	unsigned int Interval(LodTier tier) const;
+
+	Settings m_settings;
+	std::vector<Focus> m_focus;
+
+	// Per actor index, as of the last Update
+	std::vector<ActorHandle> m_handles;
+	std::vector<LodTier> m_tiers;
+	std::vector<std::uint64_t> m_stepped;	// Last tick covered
+	std::vector<std::uint32_t> m_ticks;
+	size_t m_length;
+
+	std::vector<size_t> m_due;
+	std::vector<std::uint32_t> m_due_ticks;
+
+	Stats m_stats;
+	MemoryAccount m_memory;
+};
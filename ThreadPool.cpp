@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int num_threads) : m_stopping(false)
+{
+	// hardware_concurrency is allowed to say "don't know"
+	if (num_threads == 0)
+	{
+		num_threads = 1;
+	}
+
+	m_threads.reserve(num_threads);
+	for (unsigned int k = 0; k < num_threads; ++k)
+	{
+		m_threads.emplace_back(&ThreadPool::Worker, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& t : m_threads)
+	{
+		t.join();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	struct State
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		size_t count = 0;
+		std::function<void(size_t)> body;
+		std::exception_ptr error;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	auto state = std::make_shared<State>();
+	state->count = count;
+	state->body = body;
+
+	// Helpers that only get to run after everything is taken just return,
+	//	so nobody ever waits on a task that hasn't started
+	auto run = [state]()
+	{
+		for (size_t i = state->next++; i < state->count; i = state->next++)
+		{
+			try
+			{
+				state->body(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (!state->error)
+				{
+					state->error = std::current_exception();
+				}
+			}
+
+			if (++state->done == state->count)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	const size_t helpers = std::min(count - 1, m_threads.size());
+	for (size_t k = 0; k < helpers; ++k)
+	{
+		this->Enqueue(run);
+	}
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]() { return state->done == state->count; });
+
+	if (state->error)
+	{
+		std::rethrow_exception(state->error);
+	}
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_wake.notify_one();
+}
+
+void ThreadPool::Worker()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+			if (m_stopping && m_tasks.empty())
+			{
+				return;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
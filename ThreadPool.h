@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+/// Fixed set of worker threads fed from a single queue.  Submit hands
+///  back a future, ParallelFor splits an index range over the workers
+///  and lets the calling thread help, so it is safe to call from inside
+///  a task as well.
+///
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned int num_threads = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template <typename F>
+	auto Submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>>;
+
+	// Calls body(i) for every i in [0, count), returns when all are done.
+	//  The first exception thrown by body is rethrown here.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	size_t GetSize() const { return m_threads.size(); }
+
+private:
+	void Enqueue(std::function<void()> task);
+	void Worker();
+
+	std::vector<std::thread>			m_threads;
+	std::deque<std::function<void()>>	m_tasks;
+	std::mutex							m_mutex;
+	std::condition_variable				m_wake;
+	bool								m_stopping;
+};
+
+template <typename F>
+auto ThreadPool::Submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+{
+	using Result = std::invoke_result_t<std::decay_t<F>>;
+
+	// packaged_task is move only, std::function wants something copyable
+	auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+	auto result = packaged->get_future();
+	this->Enqueue([packaged]() { (*packaged)(); });
+
+	return result;
+}
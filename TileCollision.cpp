@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cmath>
+
+#include "TileCollision.h"
+#include "Model.h"
+
+namespace {
+
+	// Actors process in groups of this many lanes, wide enough for AVX
+	constexpr size_t Lanes = 8;
+
+	// Boxes are half open, a box touching a tile edge does not overlap it
+	constexpr float Skin = 1.0e-3f;
+
+	int TileOf(float v, float inv_tile)
+	{
+		return static_cast<int>(std::floor(v * inv_tile));
+	}
+
+	int Carry(float& offset, float tile, float inv_tile)
+		// Whole tiles out of an offset, leaving it in [0, tile).  Rounding can
+		//	land a small negative offset on tile itself, that carries one more.
+	{
+		int blocks = TileOf(offset, inv_tile);
+		offset -= blocks * tile;
+		if (offset >= tile)
+		{
+			offset -= tile;
+			blocks++;
+		}
+		return blocks;
+	}
+
+	void ResolveX(const SolidityMap& solidity, float tile, float inv_tile, int bx, int by,
+		float& lx, float ly, float w, float h, float dx, float& vx)
+		// Walks the columns the leading edge crosses, stops at the first solid one.
+		//	lx, ly are relative to tile (bx, by), tiles are looked up from there.
+	{
+		const int r0 = by + TileOf(ly, inv_tile);
+		const int r1 = by + TileOf(ly + h - Skin, inv_tile);
+
+		if (dx > 0.0f)
+		{
+			const int c_to = bx + TileOf(lx + w + dx - Skin, inv_tile);
+			for (int c = bx + TileOf(lx + w - Skin, inv_tile) + 1; c <= c_to; ++c)
+			{
+				if (solidity.AnyInRect(c, r0, c, r1))
+				{
+					lx = (c - bx) * tile - w;
+					vx = 0.0f;
+					return;
+				}
+			}
+		}
+		else if (dx < 0.0f)
+		{
+			const int c_to = bx + TileOf(lx + dx, inv_tile);
+			for (int c = bx + TileOf(lx, inv_tile) - 1; c >= c_to; --c)
+			{
+				if (solidity.AnyInRect(c, r0, c, r1))
+				{
+					lx = (c + 1 - bx) * tile;
+					vx = 0.0f;
+					return;
+				}
+			}
+		}
+		lx += dx;
+	}
+
+	void ResolveY(const SolidityMap& solidity, float tile, float inv_tile, int bx, int by,
+		float lx, float& ly, float w, float h, float dy, float& vy)
+		// Same as ResolveX, but walking rows
+	{
+		const int c0 = bx + TileOf(lx, inv_tile);
+		const int c1 = bx + TileOf(lx + w - Skin, inv_tile);
+
+		if (dy > 0.0f)
+		{
+			const int r_to = by + TileOf(ly + h + dy - Skin, inv_tile);
+			for (int r = by + TileOf(ly + h - Skin, inv_tile) + 1; r <= r_to; ++r)
+			{
+				if (solidity.AnyInRect(c0, r, c1, r))
+				{
+					ly = (r - by) * tile - h;
+					vy = 0.0f;
+					return;
+				}
+			}
+		}
+		else if (dy < 0.0f)
+		{
+			const int r_to = by + TileOf(ly + dy, inv_tile);
+			for (int r = by + TileOf(ly, inv_tile) - 1; r >= r_to; --r)
+			{
+				if (solidity.AnyInRect(c0, r, c1, r))
+				{
+					ly = (r + 1 - by) * tile;
+					vy = 0.0f;
+					return;
+				}
+			}
+		}
+		ly += dy;
+	}
+
+}
+
+SolidityMap::SolidityMap() : m_width(0), m_height(0), m_words_per_row(0)
+{}
+
+SolidityMap::SolidityMap(int width, int height) :
+	m_width(width), m_height(height), m_words_per_row((width + 63) / 64),
+	m_bits(static_cast<size_t>((width + 63) / 64) * height, 0)
+{}
+
+void SolidityMap::Set(int x, int y, bool solid)
+{
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return;
+	}
+
+	auto& word = m_bits[(x >> 6) + static_cast<size_t>(y) * m_words_per_row];
+	const std::uint64_t bit = std::uint64_t(1) << (x & 63);
+	word = solid ? (word | bit) : (word & ~bit);
+}
+
+bool SolidityMap::IsSolid(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return true;
+	}
+	return (m_bits[(x >> 6) + static_cast<size_t>(y) * m_words_per_row] >> (x & 63)) & 1;
+}
+
+bool SolidityMap::AnyInRect(int x0, int y0, int x1, int y1) const
+{
+	if (x1 < x0 || y1 < y0)
+	{
+		return false;
+	}
+	if (x0 < 0 || y0 < 0 || x1 >= m_width || y1 >= m_height)
+	{
+		return true;
+	}
+
+	const int w0 = x0 >> 6;
+	const int w1 = x1 >> 6;
+	const std::uint64_t first_mask = ~std::uint64_t(0) << (x0 & 63);
+	const std::uint64_t last_mask = ~std::uint64_t(0) >> (63 - (x1 & 63));
+
+	for (int y = y0; y <= y1; ++y)
+	{
+		const std::uint64_t* row = m_bits.data() + static_cast<size_t>(y) * m_words_per_row;
+		if (w0 == w1)
+		{
+			if (row[w0] & first_mask & last_mask)
+			{
+				return true;
+			}
+			continue;
+		}
+
+		std::uint64_t any = (row[w0] & first_mask) | (row[w1] & last_mask);
+		for (int k = w0 + 1; k < w1; ++k)
+		{
+			any |= row[k];
+		}
+		if (any)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+namespace {
+
+	template <typename IndexOf, typename StepOf>
+	void Sweep(Actors& actors, const SolidityMap& solidity, int tile_size, size_t length, IndexOf index_of, StepOf step_of)
+		// Lane k of a group is actor index_of(base + k), moved for step_of(base + k) seconds.
+		//	Positions stay relative to the actor's block, which is also its tile,
+		//	so floats only ever hold a few tiles however big the map is.
+	{
+		const float tile = static_cast<float>(tile_size);
+		const float inv_tile = 1.0f / tile;
+
+		alignas(32) float lx[Lanes], ly[Lanes], w[Lanes], h[Lanes];
+		alignas(32) float vx[Lanes], vy[Lanes], dx[Lanes], dy[Lanes], dt[Lanes];
+		alignas(32) int bx[Lanes], by[Lanes], tx0[Lanes], ty0[Lanes], tx1[Lanes], ty1[Lanes];
+		bool hit[Lanes];
+		size_t index[Lanes];
+
+		for (size_t base = 0; base < length; base += Lanes)
+		{
+			const size_t count = std::min(Lanes, length - base);
+
+			// Gather into lanes, unused lanes become empty boxes that never move
+			for (size_t k = 0; k < Lanes; ++k)
+			{
+				if (k < count)
+				{
+					index[k] = index_of(base + k);
+					const Actors::PositionData& pd = actors.m_pd[index[k]];
+					const Actors::MovementData& md = actors.m_md[index[k]];
+					bx[k] = pd.bx;
+					by[k] = pd.by;
+					lx[k] = pd.x;
+					ly[k] = pd.y;
+					w[k] = static_cast<float>(pd.w);
+					h[k] = static_cast<float>(pd.h);
+					vx[k] = md.vx;
+					vy[k] = md.vy;
+					dt[k] = step_of(base + k);
+				}
+				else
+				{
+					bx[k] = by[k] = 0;
+					lx[k] = ly[k] = w[k] = h[k] = vx[k] = vy[k] = dt[k] = 0.0f;
+				}
+			}
+
+			// Swept box of every lane, in tiles
+			for (size_t k = 0; k < Lanes; ++k)
+			{
+				dx[k] = vx[k] * dt[k];
+				dy[k] = vy[k] * dt[k];
+				tx0[k] = bx[k] + TileOf(lx[k] + std::min(dx[k], 0.0f), inv_tile);
+				ty0[k] = by[k] + TileOf(ly[k] + std::min(dy[k], 0.0f), inv_tile);
+				tx1[k] = bx[k] + TileOf(lx[k] + w[k] + std::max(dx[k], 0.0f) - Skin, inv_tile);
+				ty1[k] = by[k] + TileOf(ly[k] + h[k] + std::max(dy[k], 0.0f) - Skin, inv_tile);
+			}
+
+			for (size_t k = 0; k < count; ++k)
+			{
+				hit[k] = solidity.AnyInRect(tx0[k], ty0[k], tx1[k], ty1[k]);
+			}
+
+			// Lanes in the clear just move, the rest resolve one axis at a time
+			for (size_t k = 0; k < count; ++k)
+			{
+				if (!hit[k])
+				{
+					lx[k] += dx[k];
+					ly[k] += dy[k];
+				}
+				else
+				{
+					ResolveX(solidity, tile, inv_tile, bx[k], by[k], lx[k], ly[k], w[k], h[k], dx[k], vx[k]);
+					ResolveY(solidity, tile, inv_tile, bx[k], by[k], lx[k], ly[k], w[k], h[k], dy[k], vy[k]);
+				}
+			}
+
+			// Scatter back, offsets that left their block carry into it, so
+			//	offsets stay within a tile.  Actors standing still aren't
+			//	marked, views skip them.
+			for (size_t k = 0; k < count; ++k)
+			{
+				Actors::PositionData& pd = actors.m_pd[index[k]];
+				Actors::MovementData& md = actors.m_md[index[k]];
+				float x = lx[k];
+				float y = ly[k];
+				const int dbx = Carry(x, tile, inv_tile);
+				const int dby = Carry(y, tile, inv_tile);
+
+				Actors::ChangeMask fields = 0;
+				if (x != pd.x || y != pd.y || dbx != 0 || dby != 0)
+				{
+					fields |= Actors::PositionChanged;
+				}
+				if (vx[k] != md.vx || vy[k] != md.vy)
+				{
+					fields |= Actors::MovementChanged;
+				}
+
+				pd.bx += dbx;
+				pd.by += dby;
+				pd.x = x;
+				pd.y = y;
+				md.vx = vx[k];
+				md.vy = vy[k];
+				if (fields != 0)
+				{
+					actors.MarkChanged(index[k], fields);
+				}
+			}
+		}
+	}
+
+}
+
+void SweepActors(Actors& actors, const SolidityMap& solidity, int tile_size, float dt)
+{
+	Sweep(actors, solidity, tile_size, actors.GetLength(),
+		[](size_t k) { return k; },
+		[dt](size_t) { return dt; });
+}
+
+void SweepActors(Actors& actors, const SolidityMap& solidity, int tile_size, float dt,
+	const std::vector<size_t>& indices, const std::vector<std::uint32_t>& ticks)
+{
+	Sweep(actors, solidity, tile_size, indices.size(),
+		[&indices](size_t k) { return indices[k]; },
+		[dt, &ticks](size_t k) { return dt * ticks[k]; });
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class Actors;
+
+/// One bit per tile, set where actors cannot go.  Rows are padded to
+///  whole 64 bit words so a run of tiles is tested with a mask instead
+///  of tile by tile.  Everything outside of the map counts as solid.
+///
+class SolidityMap
+{
+public:
+	SolidityMap();
+	SolidityMap(int width, int height);
+
+	void Set(int x, int y, bool solid);
+	bool IsSolid(int x, int y) const;
+
+	// Any solid tile in the inclusive rectangle [x0, x1] x [y0, y1]?
+	bool AnyInRect(int x0, int y0, int x1, int y1) const;
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+
+private:
+	int m_width;
+	int m_height;
+	int m_words_per_row;
+
+	std::vector<std::uint64_t> m_bits;
+};
+
+/// Batch movement stage, moves every actor along its velocity for dt
+///  seconds and stops it against solid tiles.  Actors are processed in
+///  groups of lanes; a group only drops to the per-axis resolve for
+///  lanes whose swept box actually touches something solid.
+///  World position of an actor is (bx, by) * tile_size + (x, y), offsets
+///  that leave [0, tile_size) carry into the block.
+///
+void SweepActors(Actors& actors, const SolidityMap& solidity, int tile_size, float dt);
+
+// Only the actors at indices, each for its ticks of dt seconds, e.g. the
+//  ones a SimulationLod says are due
+void SweepActors(Actors& actors, const SolidityMap& solidity, int tile_size, float dt,
+	const std::vector<size_t>& indices, const std::vector<std::uint32_t>& ticks);
@@ -0,0 +1,270 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "UdpSocket.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+	using NativeSocket = SOCKET;
+	constexpr std::intptr_t NoSocket = static_cast<std::intptr_t>(INVALID_SOCKET);
+
+	void CloseNative(std::intptr_t s) { closesocket(static_cast<SOCKET>(s)); }
+	bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK || WSAGetLastError() == WSAECONNRESET; }
+#else
+	using NativeSocket = int;
+	constexpr std::intptr_t NoSocket = -1;
+
+	void CloseNative(std::intptr_t s) { close(static_cast<int>(s)); }
+	bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED; }
+#endif
+
+	sockaddr_in ToNative(const UdpAddress& address)
+	{
+		sockaddr_in native = {};
+		native.sin_family = AF_INET;
+		native.sin_addr.s_addr = htonl(address.ip);
+		native.sin_port = htons(address.port);
+		return native;
+	}
+
+}
+
+std::string UdpAddress::ToString() const
+{
+	return std::to_string((ip >> 24) & 0xff) + "." + std::to_string((ip >> 16) & 0xff) + "." +
+		std::to_string((ip >> 8) & 0xff) + "." + std::to_string(ip & 0xff) + ":" + std::to_string(port);
+}
+
+UdpAddress UdpAddress::Resolve(const std::string& host_port)
+{
+	const auto colon = host_port.rfind(':');
+	if (colon == std::string::npos || colon + 1 == host_port.size())
+	{
+		throw std::runtime_error("Expected host:port, got " + host_port);
+	}
+	const std::string host = host_port.substr(0, colon);
+	const unsigned long port = std::stoul(host_port.substr(colon + 1));
+	if (port == 0 || port > 65535)
+	{
+		throw std::runtime_error("Bad port in " + host_port);
+	}
+
+#ifdef _WIN32
+	WSADATA wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo* found = nullptr;
+	const int error = getaddrinfo(host.c_str(), nullptr, &hints, &found);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	if (error != 0 || found == nullptr)
+	{
+		throw std::runtime_error("Cannot resolve host: " + host);
+	}
+
+	UdpAddress address;
+	address.ip = ntohl(reinterpret_cast<sockaddr_in*>(found->ai_addr)->sin_addr.s_addr);
+	address.port = static_cast<std::uint16_t>(port);
+	freeaddrinfo(found);
+	return address;
+}
+
+UdpSocket::UdpSocket(std::uint16_t port) : m_socket(NoSocket), m_random(1), m_stats{}
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("UdpSocket::UdpSocket(std::uint16_t port)");
+
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+	{
+		throw std::runtime_error("Cannot start Winsock");
+	}
+#endif
+
+	const NativeSocket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	m_socket = static_cast<std::intptr_t>(s);
+	if (m_socket == NoSocket)
+	{
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		throw std::runtime_error("Cannot create UDP socket");
+	}
+
+	sockaddr_in local = ToNative(UdpAddress{ INADDR_ANY, port });
+#ifdef _WIN32
+	u_long non_blocking = 1;
+	const bool ready = ioctlsocket(s, FIONBIO, &non_blocking) == 0 &&
+		bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0;
+#else
+	const bool ready = fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0 &&
+		bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0;
+#endif
+	if (!ready)
+	{
+		CloseNative(m_socket);
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		throw std::runtime_error("Cannot bind UDP port " + std::to_string(port));
+	}
+
+	logger->debug("UDP socket on port {0}", this->GetPort());
+}
+
+UdpSocket::~UdpSocket()
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->trace("UdpSocket::~UdpSocket()");
+
+	CloseNative(m_socket);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+void UdpSocket::SetConditions(const LinkConditions& conditions, std::uint32_t seed)
+{
+	auto logger = spdlog::get("EngineLogger");
+	logger->info("Simulating {0:.1f}% loss, {1} ms latency, {2} ms jitter", conditions.loss * 100.0f,
+		conditions.latency.count(), conditions.jitter.count());
+
+	m_conditions = conditions;
+	m_random.seed(seed);
+}
+
+void UdpSocket::Send(const UdpAddress& to, const std::uint8_t* data, size_t size)
+{
+	if (m_conditions.loss > 0.0f && std::uniform_real_distribution<float>(0.0f, 1.0f)(m_random) < m_conditions.loss)
+	{
+		m_stats.dropped_packets++;
+		return;
+	}
+
+	auto delay = m_conditions.latency;
+	if (m_conditions.jitter.count() > 0)
+	{
+		delay += std::chrono::milliseconds(std::uniform_int_distribution<long long>(0, m_conditions.jitter.count())(m_random));
+	}
+	if (delay.count() == 0)
+	{
+		this->SendNow(to, data, size);
+		return;
+	}
+	m_delayed.push_back(Delayed{ std::chrono::steady_clock::now() + delay, to, std::vector<std::uint8_t>(data, data + size) });
+}
+
+size_t UdpSocket::Receive(UdpAddress& from, std::uint8_t* data, size_t capacity)
+{
+	for (;;)
+	{
+		sockaddr_in sender = {};
+#ifdef _WIN32
+		int sender_size = sizeof(sender);
+		const int received = recvfrom(static_cast<SOCKET>(m_socket), reinterpret_cast<char*>(data), static_cast<int>(capacity), 0,
+			reinterpret_cast<sockaddr*>(&sender), &sender_size);
+		if (received < 0 && WSAGetLastError() == WSAEMSGSIZE)
+		{
+			// Cut short, the start is still there
+			from = UdpAddress{ ntohl(sender.sin_addr.s_addr), ntohs(sender.sin_port) };
+			return capacity;
+		}
+#else
+		socklen_t sender_size = sizeof(sender);
+		const ssize_t received = recvfrom(static_cast<int>(m_socket), data, capacity, 0,
+			reinterpret_cast<sockaddr*>(&sender), &sender_size);
+#endif
+		if (received < 0)
+		{
+			if (!WouldBlock())
+			{
+				auto logger = spdlog::get("EngineLogger");
+				logger->warn("UDP receive failed on port {0}", this->GetPort());
+			}
+			return 0;
+		}
+		if (received == 0)
+		{
+			// Empty datagrams carry nothing, look for the next one
+			continue;
+		}
+
+		from = UdpAddress{ ntohl(sender.sin_addr.s_addr), ntohs(sender.sin_port) };
+		m_stats.received_packets++;
+		m_stats.received_bytes += static_cast<std::uint64_t>(received);
+		return static_cast<size_t>(received);
+	}
+}
+
+void UdpSocket::Pump()
+{
+	if (m_delayed.empty())
+	{
+		return;
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+	auto due = std::stable_partition(m_delayed.begin(), m_delayed.end(), [now](const Delayed& d) { return d.due > now; });
+	for (auto packet = due; packet != m_delayed.end(); ++packet)
+	{
+		this->SendNow(packet->to, packet->data.data(), packet->data.size());
+	}
+	m_delayed.erase(due, m_delayed.end());
+}
+
+std::uint16_t UdpSocket::GetPort() const
+{
+	sockaddr_in local = {};
+#ifdef _WIN32
+	int local_size = sizeof(local);
+	getsockname(static_cast<SOCKET>(m_socket), reinterpret_cast<sockaddr*>(&local), &local_size);
+#else
+	socklen_t local_size = sizeof(local);
+	getsockname(static_cast<int>(m_socket), reinterpret_cast<sockaddr*>(&local), &local_size);
+#endif
+	return ntohs(local.sin_port);
+}
+
+void UdpSocket::SendNow(const UdpAddress& to, const std::uint8_t* data, size_t size)
+{
+	const sockaddr_in native = ToNative(to);
+#ifdef _WIN32
+	const int sent = sendto(static_cast<SOCKET>(m_socket), reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+		reinterpret_cast<const sockaddr*>(&native), sizeof(native));
+#else
+	const ssize_t sent = sendto(static_cast<int>(m_socket), data, size, 0,
+		reinterpret_cast<const sockaddr*>(&native), sizeof(native));
+#endif
+	if (sent < 0)
+	{
+		// Full send buffers lose packets like the network would
+		m_stats.dropped_packets++;
+		return;
+	}
+	m_stats.sent_packets++;
+	m_stats.sent_bytes += size;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+
+/// IPv4 address and port, both in host byte order
+///
+struct UdpAddress
+{
+	std::uint32_t ip;
+	std::uint16_t port;
+
+	bool operator==(const UdpAddress& other) const { return ip == other.ip && port == other.port; }
+	bool operator!=(const UdpAddress& other) const { return !(*this == other); }
+
+	std::string ToString() const;
+
+	// "host:port", throws std::runtime_error if it can't be resolved
+	static UdpAddress Resolve(const std::string& host_port);
+};
+
+/// What a bad network would do to the packets one end sends, for testing
+///  over loopback.  Each packet is dropped with probability loss, the rest
+///  arrive latency plus up to jitter later, possibly out of order.
+///
+struct LinkConditions
+{
+	float loss = 0.0f;
+	std::chrono::milliseconds latency{ 0 };
+	std::chrono::milliseconds jitter{ 0 };
+};
+
+/// Non-blocking UDP socket.  Packets sent under LinkConditions are held
+///  back until they are due, Pump sends them.
+///
+class UdpSocket
+{
+public:
+	struct Stats
+	{
+		std::uint64_t sent_packets;
+		std::uint64_t sent_bytes;
+		std::uint64_t dropped_packets;
+		std::uint64_t received_packets;
+		std::uint64_t received_bytes;
+	};
+
+	// Bound to port on every interface, 0 for any free port.  Throws
+	//  std::runtime_error if the socket can't be set up.
+	explicit UdpSocket(std::uint16_t port = 0);
+	~UdpSocket();
+
+	UdpSocket(const UdpSocket&) = delete;
+	UdpSocket& operator=(const UdpSocket&) = delete;
+
+	// Same seed, same packets lost
+	void SetConditions(const LinkConditions& conditions, std::uint32_t seed = 1);
+
+	void Send(const UdpAddress& to, const std::uint8_t* data, size_t size);
+
+	// Size of the next waiting packet, 0 if there is none.  Packets longer
+	//  than capacity are cut short.
+	size_t Receive(UdpAddress& from, std::uint8_t* data, size_t capacity);
+
+	// Sends whatever is due of the packets held back
+	void Pump();
+
+	std::uint16_t GetPort() const;
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	struct Delayed
+	{
+		std::chrono::steady_clock::time_point due;
+		UdpAddress to;
+		std::vector<std::uint8_t> data;
+	};
+
+	void SendNow(const UdpAddress& to, const std::uint8_t* data, size_t size);
+
+	// SOCKET is pointer sized on Windows, an int elsewhere
+	std::intptr_t m_socket;
+
+	LinkConditions m_conditions;
+	std::mt19937 m_random;
+	std::vector<Delayed> m_delayed;
+
+	Stats m_stats;
+};
@@ -1,8 +1,10 @@
 #include "View.h"
 
-View::View(int block_size, size_t num_actors): m_blockx(0), m_blocky(0), m_block_size(block_size), m_offx(0.0), m_offy(0.0)
+View::View(int block_size, size_t num_actors): m_blockx(0), m_blocky(0), m_block_size(block_size), m_offx(0.0), m_offy(0.0), m_moved(false),
+	m_memory(MemorySubsystem::Views)
 {
 	m_screen.reserve(num_actors);
+	m_memory.Set(m_screen.capacity() * sizeof(ScreenData));
 }
 
 void View::Offset(int bx, int by, float dx, float dy)
@@ -11,17 +13,62 @@ void View::Offset(int bx, int by, float dx, float dy)
 	m_blocky += by;
 	m_offx += dx;
 	m_offy += dy;
+	m_moved = true;
 }
 
-void View::UpdateView(const Actors& modeldata)
+void View::UpdateView(const Actors& modeldata, const ActorDelta& delta)
 {
-	size_t length = modeldata.GetLength();
-	for (size_t index = 0; index < length; index++)
+	if (delta.reset)
+	{
+		m_screen.assign(delta.length, ScreenData{ { 0, 0, 0, 0 }, nullptr });
+	}
+	else
+	{
+		for (const auto& change : delta.structure)
+		{
+			switch (change.kind)
+			{
+			case ActorDelta::Structural::Kind::Added:
+				m_screen.resize(m_screen.size() + change.other, ScreenData{ { 0, 0, 0, 0 }, nullptr });
+				break;
+			case ActorDelta::Structural::Kind::Removed:
+				m_screen.pop_back();
+				break;
+			case ActorDelta::Structural::Kind::Swapped:
+				std::swap(m_screen[change.index], m_screen[change.other]);
+				break;
+			}
+		}
+	}
+	m_memory.Set(m_screen.capacity() * sizeof(ScreenData));
+
+	if (m_moved)
+	{
+		this->Refresh(modeldata, 0, m_screen.size());
+		m_moved = false;
+		return;
+	}
+
+	// Only positions and sizes show up here
+	for (const auto& range : delta.changed)
+	{
+		if ((range.fields & Actors::PositionChanged) != 0)
+		{
+			this->Refresh(modeldata, range.first, range.count);
+		}
+	}
+}
+
+void View::Refresh(const Actors& modeldata, size_t first, size_t count)
+{
+	for (size_t index = first; index < first + count; index++)
 	{
 		auto& sd = m_screen[index];
-		std::tie(sd.dest_rect.x, sd.dest_rect.y) = WorldToScreen(modeldata.m_pd[index]);
+		const auto& pd = modeldata.m_pd[index];
+		std::tie(sd.dest_rect.x, sd.dest_rect.y) = WorldToScreen(pd);
+		sd.dest_rect.w = pd.w;
+		sd.dest_rect.h = pd.h;
 	}
-	
 }
 
 std::tuple<int, int> View::WorldToScreen(const Actors::PositionData& pd)
@@ -33,16 +80,4 @@ std::tuple<int, int> View::WorldToScreen(const Actors::PositionData& pd)
 	sy += (pd.by - m_blocky)*m_block_size;
 
 	return std::make_tuple(sx, sy);
-}
-
-void View::AddActor(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib)
-{
-	ScreenData sd;
-	std::tie(sd.dest_rect.x, sd.dest_rect.y) = WorldToScreen(pd);
-	sd.dest_rect.w = pd.w;
-	sd.dest_rect.h = pd.h;
-
-	sd.anim = nullptr;
-
-	m_screen.push_back(sd);
 }
\ No newline at end of file
@@ -29,13 +29,14 @@ public:
 	~View();
 	
 	void Offset(int bx, int by, float dx, float dy);
-	void UpdateView(const Actors& modeldata);
 
-protected:
+	// Mirrors the structural changes, then refreshes what changed.  Moving
+	//  the view refreshes everything once.
+	void UpdateView(const Actors& modeldata, const ActorDelta& delta);
 
-	friend class Game;
-	void AddActor(const Actors::PositionData& pd, const Actors::MovementData& md, const Actors::ActorType& at, const std::bitset<32>& attrib);
-	void RemoveActor(const size_t index);
+	// Block at the top left of the view, and pixels per block
+	std::tuple<int, int> GetBlock() const { return std::make_tuple(m_blockx, m_blocky); }
+	int GetBlockSize() const { return m_block_size; }
 
 private:
 	int m_blockx;
@@ -43,9 +44,12 @@ private:
 	int m_block_size;
 	float m_offx;
 	float m_offy;
+	bool m_moved;
 
 	std::vector<ScreenData>		m_screen;
+	MemoryAccount				m_memory;
 
 	std::tuple<int, int> WorldToScreen(const Actors::PositionData& pd);
+	void Refresh(const Actors& modeldata, size_t first, size_t count);
 
 };
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "Visibility.h"
+#include "TileCollision.h"
+
+namespace {
+
+	// Transforms from octant space into map space
+	const int mult_xx[] = { 1,  0,  0, -1, -1,  0,  0,  1 };
+	const int mult_xy[] = { 0,  1, -1,  0,  0, -1,  1,  0 };
+	const int mult_yx[] = { 0,  1,  1,  0,  0, -1, -1,  0 };
+	const int mult_yy[] = { 1,  0,  0,  1, -1,  0,  0, -1 };
+
+}
+
+VisibilityMap::VisibilityMap(int width, int height) :
+	m_width(width), m_height(height),
+	m_chunks_x((width + ChunkSize - 1) / ChunkSize),
+	m_chunks_y((height + ChunkSize - 1) / ChunkSize),
+	m_changed(false)
+{
+	m_chunks.resize(static_cast<size_t>(m_chunks_x) * m_chunks_y);
+}
+
+VisibilityMap::~VisibilityMap() {}
+
+VisibilityMap::SourceId VisibilityMap::AddSource(int x, int y, int radius)
+{
+	Source source;
+	source.x = x;
+	source.y = y;
+	source.radius = std::max(radius, 0);
+	source.active = true;
+	source.dirty = true;
+	source.words_per_row = (2 * source.radius + 1 + 63) / 64;
+	source.bits.assign(static_cast<size_t>(source.words_per_row) * (2 * source.radius + 1), 0);
+
+	// Reuse a removed slot so ids stay small
+	for (SourceId id = 0; id < m_sources.size(); ++id)
+	{
+		if (!m_sources[id].active)
+		{
+			m_sources[id] = std::move(source);
+			m_changed = true;
+			return id;
+		}
+	}
+
+	m_sources.push_back(std::move(source));
+	m_changed = true;
+	return m_sources.size() - 1;
+}
+
+void VisibilityMap::MoveSource(SourceId id, int x, int y)
+{
+	auto& source = m_sources.at(id);
+	if (source.x == x && source.y == y)
+	{
+		// Still on the same tile, nothing can have changed
+		return;
+	}
+	source.x = x;
+	source.y = y;
+	source.dirty = true;
+	m_changed = true;
+}
+
+void VisibilityMap::RemoveSource(SourceId id)
+{
+	auto& source = m_sources.at(id);
+	source.active = false;
+	source.bits.clear();
+	m_changed = true;
+}
+
+void VisibilityMap::InvalidateTile(int x, int y)
+{
+	for (auto& source : m_sources)
+	{
+		if (source.active && std::abs(x - source.x) <= source.radius && std::abs(y - source.y) <= source.radius)
+		{
+			source.dirty = true;
+			m_changed = true;
+		}
+	}
+}
+
+void VisibilityMap::InvalidateAll()
+{
+	for (auto& source : m_sources)
+	{
+		source.dirty = source.active;
+	}
+	m_changed = true;
+}
+
+void VisibilityMap::Update(const SolidityMap& opacity)
+{
+	if (!m_changed)
+	{
+		return;
+	}
+
+	for (auto& source : m_sources)
+	{
+		if (source.active && source.dirty)
+		{
+			this->Cast(source, opacity);
+			source.dirty = false;
+		}
+	}
+
+	// Union of all sources, rebuilt from scratch since that's just a few ORs
+	for (size_t k : m_visible_chunks)
+	{
+		std::fill(std::begin(m_chunks[k]->visible), std::end(m_chunks[k]->visible), 0);
+		m_chunks[k]->listed = false;
+	}
+	m_visible_chunks.clear();
+
+	for (const auto& source : m_sources)
+	{
+		if (source.active)
+		{
+			this->Merge(source);
+		}
+	}
+
+	// Explored accumulates everything ever visible
+	for (size_t k : m_visible_chunks)
+	{
+		Chunk& chunk = *m_chunks[k];
+		for (int w = 0; w < ChunkSize; ++w)
+		{
+			chunk.explored[w] |= chunk.visible[w];
+		}
+	}
+
+	m_changed = false;
+}
+
+bool VisibilityMap::IsVisible(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return false;
+	}
+	const auto& chunk = m_chunks[(x / ChunkSize) + (y / ChunkSize) * m_chunks_x];
+	return chunk && ((chunk->visible[y % ChunkSize] >> (x % ChunkSize)) & 1);
+}
+
+bool VisibilityMap::IsExplored(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return false;
+	}
+	const auto& chunk = m_chunks[(x / ChunkSize) + (y / ChunkSize) * m_chunks_x];
+	return chunk && ((chunk->explored[y % ChunkSize] >> (x % ChunkSize)) & 1);
+}
+
+void VisibilityMap::Cast(Source& source, const SolidityMap& opacity)
+{
+	std::fill(source.bits.begin(), source.bits.end(), 0);
+
+	// The source always sees its own tile
+	if (source.x >= 0 && source.y >= 0 && source.x < m_width && source.y < m_height)
+	{
+		source.bits[(source.radius / 64) + static_cast<size_t>(source.radius) * source.words_per_row] |=
+			std::uint64_t(1) << (source.radius % 64);
+	}
+
+	for (int octant = 0; octant < 8; ++octant)
+	{
+		this->CastOctant(source, opacity, 1, 1.0f, 0.0f,
+			mult_xx[octant], mult_xy[octant], mult_yx[octant], mult_yy[octant]);
+	}
+}
+
+void VisibilityMap::CastOctant(Source& source, const SolidityMap& opacity, int row, float start, float end,
+	int xx, int xy, int yx, int yy)
+	// Recursive shadowcasting, scans one octant row by row and recurses
+	//	past every run of opaque tiles with a narrowed slope window
+{
+	if (start < end)
+	{
+		return;
+	}
+
+	const int radius = source.radius;
+	const int radius2 = radius * radius;
+	float new_start = 0.0f;
+
+	for (int j = row; j <= radius; ++j)
+	{
+		int dx = -j - 1;
+		const int dy = -j;
+		bool blocked = false;
+
+		while (dx <= 0)
+		{
+			dx += 1;
+			const int lx = dx * xx + dy * xy;
+			const int ly = dx * yx + dy * yy;
+			const int mx = source.x + lx;
+			const int my = source.y + ly;
+
+			const float l_slope = (dx - 0.5f) / (dy + 0.5f);
+			const float r_slope = (dx + 0.5f) / (dy - 0.5f);
+			if (start < r_slope)
+			{
+				continue;
+			}
+			else if (end > l_slope)
+			{
+				break;
+			}
+
+			if (dx * dx + dy * dy <= radius2 && mx >= 0 && my >= 0 && mx < m_width && my < m_height)
+			{
+				const int bx = lx + radius;
+				const int by = ly + radius;
+				source.bits[(bx / 64) + static_cast<size_t>(by) * source.words_per_row] |= std::uint64_t(1) << (bx % 64);
+			}
+
+			const bool opaque = opacity.IsSolid(mx, my);
+			if (blocked)
+			{
+				if (opaque)
+				{
+					new_start = r_slope;
+					continue;
+				}
+				blocked = false;
+				start = new_start;
+			}
+			else if (opaque && j < radius)
+			{
+				blocked = true;
+				this->CastOctant(source, opacity, j + 1, start, l_slope, xx, xy, yx, yy);
+				new_start = r_slope;
+			}
+		}
+
+		if (blocked)
+		{
+			break;
+		}
+	}
+}
+
+void VisibilityMap::Merge(const Source& source)
+	// ORs the source's box into the chunk bitsets a word at a time
+{
+	const int size = 2 * source.radius + 1;
+	const int gx0 = source.x - source.radius;
+	const int gy0 = source.y - source.radius;
+
+	for (int ly = 0; ly < size; ++ly)
+	{
+		const int gy = gy0 + ly;
+		if (gy < 0 || gy >= m_height)
+		{
+			continue;
+		}
+		const std::uint64_t* row = source.bits.data() + static_cast<size_t>(ly) * source.words_per_row;
+		for (int w = 0; w < source.words_per_row; ++w)
+		{
+			if (row[w] == 0)
+			{
+				continue;
+			}
+
+			const int gx = gx0 + w * 64;
+			if (gx >= 0)
+			{
+				this->OrWord(gx, gy, row[w]);
+			}
+			else if (gx > -64)
+			{
+				// Bits left of the map are never set, shift them away
+				this->OrWord(0, gy, row[w] >> (-gx));
+			}
+		}
+	}
+}
+
+void VisibilityMap::OrWord(int gx, int gy, std::uint64_t word)
+	// ORs 64 bits starting at map tile (gx, gy), spilling into the next chunk
+{
+	const int cx = gx / ChunkSize;
+	const int shift = gx % ChunkSize;
+	const int cy = gy / ChunkSize;
+	const int wy = gy % ChunkSize;
+
+	if (cx < m_chunks_x)
+	{
+		ChunkAt(cx, cy).visible[wy] |= word << shift;
+	}
+	if (shift != 0 && cx + 1 < m_chunks_x && (word >> (64 - shift)) != 0)
+	{
+		ChunkAt(cx + 1, cy).visible[wy] |= word >> (64 - shift);
+	}
+}
+
+VisibilityMap::Chunk& VisibilityMap::ChunkAt(int cx, int cy)
+{
+	const size_t k = cx + static_cast<size_t>(cy) * m_chunks_x;
+	auto& chunk = m_chunks[k];
+	if (!chunk)
+	{
+		chunk = std::make_unique<Chunk>();
+		std::fill(std::begin(chunk->visible), std::end(chunk->visible), 0);
+		std::fill(std::begin(chunk->explored), std::end(chunk->explored), 0);
+		chunk->listed = false;
+	}
+	if (!chunk->listed)
+	{
+		chunk->listed = true;
+		m_visible_chunks.push_back(k);
+	}
+	return *chunk;
+}
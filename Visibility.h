@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class SolidityMap;
+
+/// What one player can currently see and has ever seen.  Vision sources
+///  (units, towers, ...) cast light with recursive shadowcasting against
+///  the map's opaque tiles.  Results are kept as packed bitsets in 64x64
+///  tile chunks, one word per chunk row, allocated when first seen.
+///
+///  Nothing is recomputed unless a source moved to another tile, or an
+///  opaque tile inside its radius changed (see GameMap::AttachVisibility).
+///
+class VisibilityMap
+{
+public:
+	using SourceId = size_t;
+	static constexpr int ChunkSize = 64;
+
+	VisibilityMap(int width, int height);
+	~VisibilityMap();
+
+	SourceId AddSource(int x, int y, int radius);
+	void MoveSource(SourceId id, int x, int y);
+	void RemoveSource(SourceId id);
+
+	// An opaque tile appeared or disappeared at (x, y)
+	void InvalidateTile(int x, int y);
+	void InvalidateAll();
+
+	// Recast dirty sources and refresh the visible and explored sets
+	void Update(const SolidityMap& opacity);
+
+	bool IsVisible(int x, int y) const;
+	bool IsExplored(int x, int y) const;
+
+private:
+	struct Chunk
+	{
+		std::uint64_t visible[ChunkSize];
+		std::uint64_t explored[ChunkSize];
+		bool listed;
+	};
+
+	struct Source
+	{
+		int x, y, radius;
+		bool active;
+		bool dirty;
+		int words_per_row;
+		std::vector<std::uint64_t> bits;	// (2r+1)^2 box centred on (x, y)
+	};
+
+	void Cast(Source& source, const SolidityMap& opacity);
+	void CastOctant(Source& source, const SolidityMap& opacity, int row, float start, float end,
+		int xx, int xy, int yx, int yy);
+	void Merge(const Source& source);
+	void OrWord(int gx, int gy, std::uint64_t word);
+	Chunk& ChunkAt(int cx, int cy);
+
+	int m_width;
+	int m_height;
+	int m_chunks_x;
+	int m_chunks_y;
+
+	std::vector<std::unique_ptr<Chunk>> m_chunks;
+	std::vector<size_t> m_visible_chunks;
+
+	std::vector<Source> m_sources;
+	bool m_changed;
+};
@@ -0,0 +1,103 @@
+// Bakes images into an asset pack the engine maps instead of decoding.
+//
+//	PackAssets <pack> <pixel format> <image or directory>...
+//
+//	The pixel format is the one of the game window, e.g. RGB888 or
+//	ARGB8888, a pack built for another format is ignored at runtime.  Run
+//	it from the directory the game runs in, images are looked up by the
+//	names given here.  Directories add every .png, .bmp and .jpg in them.
+
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+
+#include "SDL.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "../AssetPack.h"
+
+namespace {
+
+	// The formats windows commonly end up with
+	const Uint32 KnownFormats[] = {
+		SDL_PIXELFORMAT_RGB888, SDL_PIXELFORMAT_BGR888, SDL_PIXELFORMAT_RGB565,
+		SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888, SDL_PIXELFORMAT_RGBA8888, SDL_PIXELFORMAT_BGRA8888
+	};
+
+	// 0 if the name isn't known, with or without the SDL_PIXELFORMAT_ prefix
+	Uint32 ParseFormat(std::string name)
+	{
+		if (name.compare(0, 16, "SDL_PIXELFORMAT_") != 0)
+		{
+			name = "SDL_PIXELFORMAT_" + name;
+		}
+		for (auto format : KnownFormats)
+		{
+			if (name == SDL_GetPixelFormatName(format))
+			{
+				return format;
+			}
+		}
+		return 0;
+	}
+
+	bool IsImage(const std::filesystem::path& path)
+	{
+		auto extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return extension == ".png" || extension == ".bmp" || extension == ".jpg";
+	}
+
+}
+
+int main(int argc, char** argv)
+{
+	auto console = spdlog::stdout_color_mt("EngineLogger");
+	console->set_level(spdlog::level::info);
+
+	if (argc < 4)
+	{
+		std::cerr << "Usage: PackAssets <pack> <pixel format> <image or directory>..." << std::endl;
+		return 2;
+	}
+
+	const Uint32 format = ParseFormat(argv[2]);
+	if (format == 0)
+	{
+		std::cerr << "Unknown pixel format: " << argv[2] << std::endl;
+		return 2;
+	}
+
+	std::vector<std::string> image_files;
+	for (int k = 3; k < argc; ++k)
+	{
+		std::error_code ec;
+		if (!std::filesystem::is_directory(argv[k], ec))
+		{
+			image_files.push_back(argv[k]);
+			continue;
+		}
+
+		// Sorted so the same images always make the same pack
+		std::vector<std::string> found;
+		for (const auto& entry : std::filesystem::directory_iterator(argv[k], ec))
+		{
+			if (entry.is_regular_file() && IsImage(entry.path()))
+			{
+				found.push_back(entry.path().string());
+			}
+		}
+		std::sort(found.begin(), found.end());
+		image_files.insert(image_files.end(), found.begin(), found.end());
+	}
+
+	if (!AssetPack::Write(argv[1], image_files, format))
+	{
+		return 1;
+	}
+	return 0;
+}
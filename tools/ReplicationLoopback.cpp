@@ -0,0 +1,201 @@
+// Runs a replication server or client without the game, for measuring
+// the replication over loopback with two processes.
+//
+//	ReplicationLoopback server <port> <actors> [options]
+//	ReplicationLoopback client <host:port> <bx> <by> <radius> [options]
+//
+//	The server spreads its actors over a 64 by 64 block world and moves
+//	them every tick, the client asks for the blocks within radius of
+//	(bx, by).  Both tick 60 times a second and report once a second: the
+//	server bandwidth and CPU time per client, the client what it holds
+//	and what it receives.  Options, for the end they are given to:
+//
+//	--loss <fraction>	drop that many of the packets sent
+//	--latency <ms>		hold every packet back that long
+//	--jitter <ms>		and up to that much longer, reordering them
+//	--seconds <n>		stop after n seconds instead of running on
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "../Model.h"
+#include "../Replication.h"
+
+namespace {
+
+	constexpr int WorldBlocks = 64;
+	constexpr int BlockSize = 32;
+	constexpr int TickRate = 60;
+
+	struct Options
+	{
+		LinkConditions conditions;
+		int seconds = 0;
+	};
+
+	// Everything from first on, false if something isn't an option
+	bool ParseOptions(int argc, char** argv, int first, Options& options)
+	{
+		for (int k = first; k < argc; ++k)
+		{
+			const std::string arg(argv[k]);
+			if (k + 1 == argc)
+			{
+				return false;
+			}
+			if (arg == "--loss")
+			{
+				options.conditions.loss = std::stof(argv[++k]);
+			}
+			else if (arg == "--latency")
+			{
+				options.conditions.latency = std::chrono::milliseconds(std::stoi(argv[++k]));
+			}
+			else if (arg == "--jitter")
+			{
+				options.conditions.jitter = std::chrono::milliseconds(std::stoi(argv[++k]));
+			}
+			else if (arg == "--seconds")
+			{
+				options.seconds = std::stoi(argv[++k]);
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Move(Actors& actors)
+		// Drift along, crossing into the next block, turning at the edge of the world
+	{
+		for (size_t index = 0; index < actors.GetLength(); ++index)
+		{
+			auto& pd = actors.m_pd[index];
+			auto& md = actors.m_md[index];
+			pd.x += md.vx;
+			pd.y += md.vy;
+			while (pd.x >= BlockSize) { pd.x -= BlockSize; pd.bx++; }
+			while (pd.x < 0) { pd.x += BlockSize; pd.bx--; }
+			while (pd.y >= BlockSize) { pd.y -= BlockSize; pd.by++; }
+			while (pd.y < 0) { pd.y += BlockSize; pd.by--; }
+
+			Actors::ChangeMask changed = Actors::PositionChanged;
+			if ((pd.bx == 0 && md.vx < 0) || (pd.bx == WorldBlocks - 1 && md.vx > 0))
+			{
+				md.vx = -md.vx;
+				changed |= Actors::MovementChanged;
+			}
+			if ((pd.by == 0 && md.vy < 0) || (pd.by == WorldBlocks - 1 && md.vy > 0))
+			{
+				md.vy = -md.vy;
+				changed |= Actors::MovementChanged;
+			}
+			actors.MarkChanged(index, changed);
+		}
+	}
+
+	template <typename Body>
+	void RunTicks(int seconds, Body body)
+	{
+		const auto tick_length = std::chrono::microseconds(1000000 / TickRate);
+		auto next = std::chrono::steady_clock::now();
+		for (std::uint64_t tick = 1; seconds == 0 || tick <= static_cast<std::uint64_t>(seconds) * TickRate; ++tick)
+		{
+			body(tick);
+			next += tick_length;
+			std::this_thread::sleep_until(next);
+		}
+	}
+
+	int Serve(std::uint16_t port, size_t count, const Options& options)
+	{
+		Actors actors(count);
+		std::mt19937 random(1);
+		std::uniform_int_distribution<int> block(0, WorldBlocks - 1);
+		std::uniform_real_distribution<float> offset(0.0f, BlockSize);
+		std::uniform_real_distribution<float> speed(-1.0f, 1.0f);
+		for (size_t k = 0; k < count; ++k)
+		{
+			actors.Push({ block(random), block(random), offset(random), offset(random), 16, 16 },
+				{ speed(random), speed(random), 0.0f, 0.0f }, Actors::ActorType::Rock, 0);
+		}
+		actors.ClearChanges();
+
+		ReplicationServer server(port, options.conditions);
+		RunTicks(options.seconds, [&](std::uint64_t tick)
+		{
+			Move(actors);
+			server.Update(actors);
+			actors.ClearChanges();
+
+			if (tick % TickRate == 0)
+			{
+				for (const auto& client : server.GetStats())
+				{
+					std::cout << client.address.ToString() << ": " << client.actors << " actors, "
+						<< static_cast<std::uint64_t>(client.bytes_per_second) << " bytes/s, "
+						<< client.cpu.count() << " us/s CPU (" << client.cpu.count() / TickRate << " us/tick)" << std::endl;
+				}
+			}
+		});
+		return 0;
+	}
+
+	int Connect(const UdpAddress& address, const ReplicationInterest& interest, const Options& options)
+	{
+		Actors actors(1024);
+		ReplicationClient client(address, interest, options.conditions);
+		RunTicks(options.seconds, [&](std::uint64_t tick)
+		{
+			client.Update(actors);
+			actors.ClearChanges();
+
+			if (tick % TickRate == 0)
+			{
+				const auto stats = client.GetStats();
+				std::cout << "snapshot " << stats.sequence << ": " << stats.actors << " actors, "
+					<< static_cast<std::uint64_t>(stats.bytes_per_second) << " bytes/s, "
+					<< stats.packets << " packets, " << stats.dropped << " unusable" << std::endl;
+			}
+		});
+		return 0;
+	}
+
+}
+
+int main(int argc, char** argv)
+{
+	auto console = spdlog::stdout_color_mt("EngineLogger");
+	console->set_level(spdlog::level::info);
+
+	const std::string mode = (argc > 1) ? argv[1] : "";
+	Options options;
+	try
+	{
+		if (mode == "server" && argc >= 4 && ParseOptions(argc, argv, 4, options))
+		{
+			return Serve(static_cast<std::uint16_t>(std::stoi(argv[2])), std::stoul(argv[3]), options);
+		}
+		if (mode == "client" && argc >= 6 && ParseOptions(argc, argv, 6, options))
+		{
+			const ReplicationInterest interest{ std::stoi(argv[3]), std::stoi(argv[4]), std::stoi(argv[5]) };
+			return Connect(UdpAddress::Resolve(argv[2]), interest, options);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cerr << "Usage: ReplicationLoopback server <port> <actors> [options]" << std::endl;
+	std::cerr << "       ReplicationLoopback client <host:port> <bx> <by> <radius> [options]" << std::endl;
+	return 2;
+}